@@ -1,3 +1,8 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
 #include <arm_const_structs.h>
 #include <arm_math.h>
 
@@ -10,8 +15,10 @@
 #include "debug/class.h"
 #include "debug/counter.h"
 #include "debug/macros.h"
+#include "debug/profile.h"
 #include "hw/volatile_buffer.h"
 #include "hw/volatile_triple_buffer.h"
+#include "math/fft.h"
 #include "math/math.h"
 #include "ui/canvas.h"
 
@@ -28,94 +35,923 @@ namespace app {
 // * Receive bin is still off-center. Therefore shift scale towards receive bin.
 //
 // Where:
-// * 1 column represents 1 bin.
+// * 1 column represents 48kHz / 512 (1 bin at the default FFT size).
 // * Sampling frequency is 48 kHz.
 // * Receive frequency is 8 kHz from center frequency.
-// * FFT size is 512 (complex inputs/outputs).
-// * 480 columns / bins are visible.
+// * 480 columns are visible.
 static unsigned int total_shift = 85;  // 8kHz/48kHz / 512 samples, result in px
 static unsigned int waterfall_shift = 16;  // Can only shift within 512 samples
 static unsigned int ui_shift = total_shift - waterfall_shift;
 
+// Grid columns, before ui_shift
+static const unsigned int grid_columns[] = {
+    27,   // -20kHz
+    80,   // -15kHz
+    133,  // -10kHz
+    187,  // -5kHz
+    239,  // Center
+    240,  // Center
+    293,  // +5kHz
+    347,  // +10kHz
+};
+
+// Grid columns for a real input, 50 Hz per column from 0 Hz
+static const unsigned int real_grid_columns[] = {
+    100,  // 5kHz
+    200,  // 10kHz
+    300,  // 15kHz
+    400,  // 20kHz
+};
+
+// Foreground grid color, and the color under it
+static const uint32_t grid_color = 0xFF333333;
+static const uint32_t transparent_color = 0x00000000;
+
+// Grid columns are dashed
+static inline bool is_grid_row(unsigned int y) {
+  return y % 6 >= 3;
+}
+
+// Color key on the left, menu bar at the bottom
+static const int key_width = 8;
+static const int menu_bar_height = 14;
+static const uint32_t menu_bg_color = 0xFF000000;
+static const uint32_t menu_text_color = 0xFFFFFFFF;
+
+// The colour scale was tuned for this FFT size. Powers from other sizes are
+// normalized to it (for carriers, i.e. noise gets darker with larger FFTs).
+static const int reference_fft_len_log2 = 9;
+
+// Default color range in log2 power, 22 colors per octave
+static const float32_t default_color_min_log2 = 28;
+static const float32_t default_color_max_log2 = 28 + 256 / 22.0f;
+
+// Automatic color range: the noise floor, tracked as the given percentile
+// of the averaged powers, is kept at agc_floor_color. The percentile moves by
+// up to agc_gain * 0.8 log2 per row. Rebuilding the color table (8192
+// entries, a few cycles each) is only done when the range moved by more than
+// agc_hysteresis_log2 (about 1.4 colors).
+static const float32_t agc_percentile = 0.2f;
+static const float32_t agc_gain = 0.25f;
+static const float32_t agc_floor_color = 32;
+static const float32_t agc_hysteresis_log2 = 1.0f / 16;
+
+// Powers are floored well below the displayed range, so that empty bins of
+// the fixed point engines don't end up near log2(0) in GetColumnPowers().
+static const float32_t min_power = 2.0f;
+
+// Polynomial order of GetColumnPowers()'s log2, within 0.0077 (1/6 color)
+static const unsigned int column_log2_order = 2;
+
+// Peak hold decay per row, about 12 dB/s at the default 94 rows/s
+static const float32_t trace_peak_decay = 0.97f;
+
+// Long term average weight per row, i.e. a time constant of 64 rows
+static const float32_t trace_average_alpha = 1.0f / 64;
+
+// Trace colors (ARGB), by trace index
+static const uint32_t trace_argb[num_traces] = {
+    0xFFFFFF00,  // Peak: yellow
+    0xFF00FFFF,  // Min: cyan
+    0xFFFFFFFF,  // Average: white
+};
+
+static const uint16_t trace_none = 0xFFFF;
+
+// Gap rows are dashed at full color
+static const unsigned int gap_dash_columns = 8;
+
 enum ApplicationEventFlags {
   WakeupProcessAudioThread = 0x01,
   WakeupRenderThread = 0x02,
+  WakeupDemodThread = 0x04,
 };
 
+static_assert(
+    app::math::demod_block_len == app::hw::recorder_block_samples &&
+        app::math::demod_block_len == app::hw::player_block_samples,
+    "The demodulator takes one recorder block per player block");
+
+const char *fft_engine_name(FftEngine engine) {
+  switch (engine) {
+    case FftEngine::Float32:
+      return "f32";
+    case FftEngine::Q15:
+      return "q15";
+    case FftEngine::Q31:
+      return "q31";
+    case FftEngine::Polyphase:
+      return "pfb";
+  }
+  return "?";
+}
+
+const char *catch_up_name(CatchUp catch_up) {
+  switch (catch_up) {
+    case CatchUp::All:
+      return "all";
+    case CatchUp::Newest:
+      return "newest";
+    case CatchUp::Batch:
+      return "batch";
+  }
+  return "?";
+}
+
+const char *waterfall_scroll_name(WaterfallScroll scroll) {
+  switch (scroll) {
+    case WaterfallScroll::Copy:
+      return "copy";
+    case WaterfallScroll::Hardware:
+      return "hardware";
+  }
+  return "?";
+}
+
 Application::Application(
     app::debug::Debug &dbg,
+    app::debug::Profile &profile,
     app::hw::Display &display,
     app::ui::Canvas &canvas,
     app::hw::Recorder &recorder,
-    app::ui::Waterfall &waterfall)
+    app::hw::Player &player,
+    app::ui::Waterfall &waterfall,
+    app::hw::VolatileBuffer<app::structs::Complex<float32_t>> &zoom_buffer,
+    app::hw::DmaManager &dma)
     : event_queue(32 * EVENTS_EVENT_SIZE),
       event_flags(),
       process_audio_thread(osPriorityHigh),
       render_thread(osPriorityAboveNormal),
+      // Below rendering, so that the frame rate doesn't drop: the player's
+      // queue covers rendering times
+      demod_thread(osPriorityNormal),
       dbg(dbg),
+      profile(profile),
+      stage_process(profile.Add("process")),
+      stage_read(profile.Add("read")),
+      stage_zoom(profile.Add("zoom")),
+      stage_fft(profile.Add("fft")),
+      stage_power(profile.Add("power")),
+      stage_accumulate(profile.Add("accumulate")),
+      stage_agc(profile.Add("agc")),
+      stage_columns(profile.Add("columns")),
+      stage_render_background(profile.Add("render_bg")),
+      stage_render_foreground(profile.Add("render_fg")),
+      stage_render_wait(profile.Add("render_wait")),
+      stage_demod(profile.Add("demod")),
+      skipped_counter(dbg, "catch_up_skipped"),
+      batched_counter(dbg, "catch_up_batched"),
+      gap_row_counter(dbg, "gap_rows"),
+      held_counter(dbg, "waterfall_held"),
+      latency_histogram(dbg, "latency"),
+      zoom(zoom_buffer),
+      color_scale(default_color_min_log2, default_color_max_log2),
+      noise_floor(
+          agc_percentile,
+          default_color_min_log2 +
+              agc_floor_color / 256 *
+                  (default_color_max_log2 - default_color_min_log2)),
       display(display),
       canvas(canvas),
       recorder(recorder),
-      waterfall(waterfall) {
+      player(player),
+      waterfall(waterfall),
+      dma(dma) {
 }
 
 int Application::Init() {
+  BuildColumnMap();
+  for (ForegroundCache &cache : foreground_caches) {
+    cache.buffer = nullptr;
+    cache.dirty.Clear();
+    cache.dirty.Add({0, 0, (int)canvas.SizeX(), (int)canvas.SizeY()});
+    memset(cache.trace_y, 0xFF, sizeof(cache.trace_y));  // trace_none
+  }
+  layout_valid = false;
+  for (unsigned int x = 0; x < 480; x++) {
+    gap_colors[x] = (x / gap_dash_columns) % 2 ? 0 : 255;
+  }
+  if (0 != zoom.Init()) {
+    return 1;
+  }
+  if (0 != recorder.AddConsumer(&demod_consumer)) {
+    return 1;
+  }
   return 0;
 }
 
 void Application::Run() {
   process_audio_thread.start(callback(this, &Application::ProcessAudioThread));
   render_thread.start(callback(this, &Application::RenderThread));
+  demod_thread.start(callback(this, &Application::DemodThread));
   event_flags.set(ApplicationEventFlags::WakeupRenderThread);
+  event_queue.call_every(10000, callback(this, &Application::Report));
   event_queue.dispatch_forever();
 }
 
 void Application::ProcessAudioThread() {
   while (true) {
     event_flags.wait_all(ApplicationEventFlags::WakeupProcessAudioThread);
-    ProcessAudio();
+    // Each call takes the oldest segment, so catch up after being delayed
+    do {
+      ProcessAudio();
+    } while (recorder.HasPending());
+  }
+}
+
+// Columns keep their frequency for all FFT sizes, so the scale stays valid.
+// Larger FFTs show the strongest of the bins per column, smaller ones are
+// interpolated. When zoomed, the centre column shows the zoom centre.
+// A real input's positive half spans all columns, from 0 Hz on the left.
+void Application::BuildColumnMap() {
+  const unsigned int fft_size = GetFftSize();
+  if (IsRealInput()) {
+    const double bins_per_column = fft_size / 480.0;
+    crash_if(
+        dbg,
+        0 != resampler.Configure(
+                 fft_size,
+                 480,
+                 bins_per_column / 2,
+                 bins_per_column,
+                 false));
+    return;
+  }
+
+  const unsigned int shift = IsZoomed() ? 0 : waterfall_shift;
+
+  // Column 0 in bins of the reference FFT size (512), then one bin less per
+  // column
+  unsigned int origin = 480;  // Cancel FFT's frequency inversion
+  origin += 512 - 240;        // Shift zero bin to center column
+  origin -= shift;            // Cancel KX3's 8kHz shift
+  const double bins_per_column = fft_size / 512.0;  // Scale to FFT size
+  crash_if(
+      dbg,
+      0 != resampler.Configure(
+               fft_size,
+               480,
+               origin * bins_per_column,
+               -bins_per_column,
+               true));
+}
+
+void Application::ApplySettings() {
+  unsigned int fft_size = __sync_lock_test_and_set(&pending_fft_size, 0);
+  unsigned int overlap = __sync_lock_test_and_set(&pending_overlap, 0);
+  unsigned int new_frames_per_row =
+      __sync_lock_test_and_set(&pending_frames_per_row, 0);
+  if (new_frames_per_row) {
+    frames_per_row = new_frames_per_row;
+    row_frames = 0;
+    row_scale = 1.0f / frames_per_row;
+  }
+  const unsigned int new_traces = requested_traces;
+  for (unsigned int i = 0; i < num_traces; i++) {
+    if ((new_traces & ~traces) & (1 << i)) {
+      arm_copy_f32(powers, trace_powers[i], 480);
+    }
+  }
+  traces = new_traces;
+  if (__sync_lock_test_and_set(&pending_color_scale, 0)) {
+    crash_if(
+        dbg, 0 != color_scale.Set(pending_color_min, pending_color_max));
+  }
+  unsigned int new_zoom_factor =
+      __sync_lock_test_and_set(&pending_zoom_factor, 0);
+  if (new_zoom_factor) {
+    zoom_factor = new_zoom_factor;
+    zoom_offset = pending_zoom_offset;
+  }
+  const unsigned int new_input = __sync_lock_test_and_set(&pending_input, 0);
+  const unsigned int polyphase =
+      __sync_lock_test_and_set(&pending_polyphase, 0);
+  if (fft_size || overlap || new_zoom_factor || new_input || polyphase) {
+    if (!fft_size) {
+      fft_size = GetFftSize();
+    }
+    if (!overlap) {
+      overlap = recorder.GetOverlap();
+    }
+    const app::hw::RecorderInput input =
+        new_input ? (app::hw::RecorderInput)(new_input - 1)
+                  : recorder.GetInput();
+
+    // A real input is recorded at twice the FFT size, within the recorder's
+    // maximum
+    const bool real = input != app::hw::RecorderInput::IQ;
+    if (real && fft_size > app::math::max_fft_len / 2) {
+      fft_size = app::math::max_fft_len / 2;
+    }
+    const unsigned int num_samples = real ? 2 * fft_size : fft_size;
+
+    // The polyphase engine takes as many taps as frames can hold
+    int taps = 1;
+    if (fft_engine == FftEngine::Polyphase && !real && zoom_factor == 1) {
+      taps = app::hw::recorder_max_num_samples / num_samples;
+      taps = taps < app::hw::recorder_max_taps ? taps
+                                               : app::hw::recorder_max_taps;
+    }
+    crash_if(
+        dbg, 0 != recorder.Configure(num_samples, overlap, input, taps));
+    crash_if(dbg, 0 != player.Unmute());  // Restarting muted the codec
+    crash_if(dbg, 0 != player.SetBurst(recorder.GetHopSamples()));
+    lost_segments = 0;
+
+    if (real) {
+      crash_if(
+          dbg,
+          ARM_MATH_SUCCESS !=
+              arm_rfft_fast_init_f32(&rfft_instance, num_samples));
+    } else if (zoom_factor > 1) {
+      crash_if(
+          dbg,
+          0 != zoom.Configure(
+                   zoom_factor,
+                   zoom_offset,
+                   app::hw::recorder_sample_rate,
+                   fft_size,
+                   overlap));
+    }
+    BuildColumnMap();
+  }
+}
+
+bool Application::ComputeFramePowers() {
+  if (IsRealInput()) {
+    return ComputeFramePowersReal();
+  }
+  if (IsZoomed()) {
+    return ComputeFramePowersZoom();
+  }
+
+  // Polyphase frames only have a float path. Also covers switching engines
+  // before the recorder was reconfigured.
+  if (recorder.GetTaps() > 1) {
+    return ComputeFramePowersFloat32();
+  }
+
+  switch (fft_engine) {
+    case FftEngine::Q15:
+      return ComputeFramePowersQ15();
+    case FftEngine::Q31:
+      return ComputeFramePowersQ31();
+    case FftEngine::Polyphase:  // With a single tap, i.e. plain f32
+    case FftEngine::Float32:
+    default:
+      return ComputeFramePowersFloat32();
   }
 }
 
 void Application::ProcessAudio() {
+  const uint32_t start = profile.Now();
+
+  ApplySettings();
+
+  // Behind: only the newest segment is still worth showing. It's read with
+  // the skipped ones as its overlap. The zoom isn't reset, as refilling it
+  // takes factor * overlap segments, so it splices (marked by the gap row).
+  if (catch_up == CatchUp::Newest) {
+    skipped_counter.Add(recorder.Skip(1));
+  }
+
+  // No frame if nothing is pending, and with overlap or zoom until enough
+  // segments were read without a gap
+  if (!ComputeFramePowers()) {
+    profile.Lap(stage_process, start);
+    return;
+  }
+
+  uint32_t t = profile.Now();
+
+  // Batching while behind extends the row by up to frames_per_row frames,
+  // which are already waiting
+  const bool batch = catch_up == CatchUp::Batch && recorder.HasPending() &&
+                     row_frames + 1 < 2 * frames_per_row;
+
+  // Past the waterfall's spare lines, a row (or a gap row and the row) would
+  // overwrite lines the display may still be scanning out. The frames go
+  // into the row until the display reloads with a newer view.
+  const bool hold = GetWaterfallFreeLines() < 2;
+
+  // Welch averaging: sum linear powers over the row
+  const float32_t *sum_powers = frame_powers;
+  float32_t scale = row_scale;
+  if (frames_per_row > 1 || row_frames > 0 || batch || hold) {
+    if (row_frames == 0) {
+      arm_copy_f32(frame_powers, row_powers, 480);
+    } else {
+      arm_add_f32(row_powers, frame_powers, row_powers, 480);
+    }
+    t = profile.Lap(stage_accumulate, t);
+
+    if (++row_frames > frames_per_row) {
+      if (batch) {
+        batched_counter.Increment();
+      } else {
+        held_counter.Increment();
+      }
+    }
+    if (row_frames < frames_per_row || batch || hold) {
+      profile.Lap(stage_process, start);
+      return;
+    }
+    if (row_frames != frames_per_row) {
+      scale = 1.0f / row_frames;
+    }
+    row_frames = 0;
+    sum_powers = row_powers;
+  }
+
+  // Audio lost since the last row gets a row of its own, so that gaps in
+  // time show as such
+  const uint32_t lost =
+      recorder.GetSegmentsDropped() + recorder.GetSegmentsSkipped();
+  if (lost != lost_segments) {
+    lost_segments = lost;
+    gap_row_counter.Increment();
+    waterfall.Shift();
+    waterfall.SetLine(gap_colors);
+  }
+
+  // Automatic color range, from the last row's averaged powers
+  if (agc) {
+    noise_floor.Update(powers, 480, agc_gain);
+    const float32_t span = color_scale.GetMax() - color_scale.GetMin();
+    const float32_t min = noise_floor.Get() - agc_floor_color / 256 * span;
+    if (fabsf(min - color_scale.GetMin()) > agc_hysteresis_log2) {
+      color_scale.Set(min, min + span);
+    }
+    t = profile.Lap(stage_agc, t);
+  }
+
+  // Mean power of the row, display averaging and the enabled traces, all in
+  // linear power, in one pass. Then a table lookup per color (no log).
+  // Disabled traces are left alone, SetTraces() seeds them when enabled.
+  const float32_t alpha = 0.33f;
+  float32_t *peak_powers = trace_powers[0];
+  float32_t *min_powers = trace_powers[1];
+  float32_t *average_powers = trace_powers[2];
+  const bool peak_enabled = traces & TracePeak;
+  const bool min_enabled = traces & TraceMin;
+  const bool average_enabled = traces & TraceAverage;
+  for (unsigned int i = 0; i < 480; i++) {
+    const float32_t power = sum_powers[i] * scale;
+    column_powers[i] = power;
+    powers[i] += alpha * (power - powers[i]);
+
+    if (peak_enabled) {
+      const float32_t peak = peak_powers[i] * trace_peak_decay;
+      peak_powers[i] = power > peak ? power : peak;
+    }
+    if (min_enabled) {
+      min_powers[i] = power < min_powers[i] ? power : min_powers[i];
+    }
+    if (average_enabled) {
+      average_powers[i] += trace_average_alpha * (power - average_powers[i]);
+    }
+  }
+  color_scale.Map(powers, colors, 480);
+  for (unsigned int i = 0; i < num_traces; i++) {
+    if (traces & (1 << i)) {
+      color_scale.Map(trace_powers[i], trace_colors[i], 480);
+    }
+  }
+
+  waterfall.Shift();
+  waterfall.SetLine(colors);
+  row_stamp = recorder.GetLastReadStamp();
+  row_count = row_count + 1;
+  profile.Lap(stage_columns, t);
+  profile.Lap(stage_process, start);
+
+  event_flags.set(ApplicationEventFlags::WakeupRenderThread);
+}
+
+bool Application::ComputeFramePowersFloat32() {
+  uint32_t t = profile.Now();
+
   app::structs::Complex<float32_t> *sig_buffer = recorder.Read();
   if (!sig_buffer) {
-    return;  // Should never happen
+    return false;
+  }
+  profile.Lap(stage_read, t);
+
+  TransformFloat32(sig_buffer);
+  return true;
+}
+
+bool Application::ComputeFramePowersZoom() {
+  uint32_t t = profile.Now();
+
+  bool contiguous;
+  const app::structs::Complex<int16_t> *raw = recorder.ReadRaw(&contiguous);
+  if (!raw) {
+    return false;
   }
+  t = profile.Lap(stage_read, t);
 
-  const arm_cfft_instance_f32 *fft_instance = &arm_cfft_sR_f32_len512;
-  crash_if(dbg, fft_instance->fftLen != recorder.num_samples);
+  if (!contiguous) {
+    zoom.Reset();
+  }
+  // raw is in the frame buffer too, but consumed before the frame is built
+  zoom.Process(raw, recorder.GetHopSamples());
+  app::structs::Complex<float32_t> *sig_buffer =
+      zoom.Frame(recorder.GetWindowTable(), recorder.GetFrameBuffer());
+  profile.Lap(stage_zoom, t);
+  if (!sig_buffer) {
+    return false;
+  }
+
+  TransformFloat32(sig_buffer);
+  return true;
+}
+
+void Application::TransformFloat32(
+    app::structs::Complex<float32_t> *sig_buffer) {
+  uint32_t t = profile.Now();
+
+  const arm_cfft_instance_f32 *fft_instance =
+      app::math::cfft_instance_f32(recorder.GetNumSamples());
+  crash_if(dbg, !fft_instance);
   arm_cfft_f32(fft_instance, (float32_t *)sig_buffer, 0, 1);
+  t = profile.Lap(stage_fft, t);
 
-  waterfall.Shift();
+  const int fft_len_log2 = 31 - __builtin_clz(fft_instance->fftLen);
+  const float32_t scale =
+      ldexpf(1.0f, 2 * (reference_fft_len_log2 - fft_len_log2));
 
-  for (unsigned int i = 0; i < 480; i++) {
-    // Convert column to bin
-    unsigned int bin = i;  // Note: all intermediate values must be non-negative
-    bin = 480 - bin;       // Cancel FFT's frequency inversion
-    bin += 512 - 240;      // Shift zero bin to center column
-    bin -= waterfall_shift;  // Cancel KX3's 8kHz shift
-    bin %= 512;              // Get array index
+  // Power per bin, mapped onto the columns, then scaled (commutes with both
+  // max and interpolation, and is cheaper per column)
+  arm_cmplx_mag_squared_f32(
+      (float32_t *)sig_buffer, bin_powers, fft_instance->fftLen);
+  resampler.Process(bin_powers, frame_powers);
+  arm_scale_f32(frame_powers, scale, frame_powers, 480);
+  profile.Lap(stage_power, t);
+}
 
+bool Application::ComputeFramePowersReal() {
+  uint32_t t = profile.Now();
+
+  float32_t *samples = recorder.ReadReal();
+  if (!samples) {
+    return false;
+  }
+  t = profile.Lap(stage_read, t);
+
+  // Output is packed: DC and Nyquist (both real), then bins 1 to N - 1 of
+  // the positive half. The input is used as scratch.
+  arm_rfft_fast_f32(&rfft_instance, samples, bin_powers, 0);
+  t = profile.Lap(stage_fft, t);
+
+  // A real carrier of amplitude A gives A * N in a real FFT of 2 N, like a
+  // complex one of A in a complex FFT of N, so it's normalized the same.
+  const unsigned int num_bins = rfft_instance.fftLenRFFT / 2;
+  const int fft_len_log2 = 31 - __builtin_clz(num_bins);
+  const float32_t scale =
+      ldexpf(1.0f, 2 * (reference_fft_len_log2 - fft_len_log2));
+
+  // In place, each power is stored after its bin was read. The Nyquist bin
+  // goes after the last one, for interpolating the rightmost column.
+  const float32_t nyquist = bin_powers[1];
+  bin_powers[1] = 0;
+  arm_cmplx_mag_squared_f32(bin_powers, bin_powers, num_bins);
+  bin_powers[num_bins] = nyquist * nyquist;
+  resampler.Process(bin_powers, frame_powers);
+  arm_scale_f32(frame_powers, scale, frame_powers, 480);
+  profile.Lap(stage_power, t);
+
+  return true;
+}
+
+bool Application::ComputeFramePowersQ15() {
+  uint32_t t = profile.Now();
+
+  int exponent;
+  app::structs::Complex<q15_t> *sig_buffer = recorder.ReadQ15(&exponent);
+  if (!sig_buffer) {
+    return false;
+  }
+  t = profile.Lap(stage_read, t);
+
+  const arm_cfft_instance_q15 *fft_instance =
+      app::math::cfft_instance_q15(recorder.GetNumSamples());
+  crash_if(dbg, !fft_instance);
+  arm_cfft_q15(fft_instance, (q15_t *)sig_buffer, 0, 1);
+  t = profile.Lap(stage_fft, t);
+
+  // The FFT output is scaled by 2^exponent (block scaling) and 1/N (CMSIS
+  // fixed point FFTs), which is undone when converting to float.
+  // Normalizing to the reference FFT size cancels the 1/N term:
+  // 2 * (log2(N) - exponent) - 2 * (log2(N) - reference) = 2 * (ref - exp)
+  const float32_t scale =
+      ldexpf(1.0f, 2 * (reference_fft_len_log2 - exponent));
+
+  const unsigned int fft_len = fft_instance->fftLen;
+  for (unsigned int i = 0; i < fft_len; i++) {
     // Convert to power
-    float32_t real = sig_buffer[bin].real;
-    float32_t imag = sig_buffer[bin].imag;
-    float32_t mag_unscaled_squared = real * real + imag * imag;
-    float32_t power = app::math::fast_log2(mag_unscaled_squared);
+    int32_t real = sig_buffer[i].real;
+    int32_t imag = sig_buffer[i].imag;
+    uint32_t mag_squared = (uint32_t)(real * real) + (uint32_t)(imag * imag);
+    bin_powers[i] = mag_squared;
+  }
+  resampler.Process(bin_powers, frame_powers);
+  arm_scale_f32(frame_powers, scale, frame_powers, 480);
+  profile.Lap(stage_power, t);
 
-    // Average
-    float32_t alpha = 0.33;
-    float32_t avg_power = powers[i] = power * alpha + powers[i] * (1.0 - alpha);
+  return true;
+}
 
-    // Offset and scale
-    float32_t disp_power = (avg_power - 28) * 22;
+bool Application::ComputeFramePowersQ31() {
+  uint32_t t = profile.Now();
 
-    // Store
-    uint8_t color = app::math::limit<int32_t, 0, 255>(disp_power);
-    waterfall.Set(i, color);
+  int exponent;
+  app::structs::Complex<q31_t> *sig_buffer = recorder.ReadQ31(&exponent);
+  if (!sig_buffer) {
+    return false;
   }
+  t = profile.Lap(stage_read, t);
 
-  event_flags.set(ApplicationEventFlags::WakeupRenderThread);
+  const arm_cfft_instance_q31 *fft_instance =
+      app::math::cfft_instance_q31(recorder.GetNumSamples());
+  crash_if(dbg, !fft_instance);
+  arm_cfft_q31(fft_instance, (q31_t *)sig_buffer, 0, 1);
+  t = profile.Lap(stage_fft, t);
+
+  // See ComputeFramePowersQ15()
+  const float32_t scale =
+      ldexpf(1.0f, 2 * (reference_fft_len_log2 - exponent));
+
+  const unsigned int fft_len = fft_instance->fftLen;
+  for (unsigned int i = 0; i < fft_len; i++) {
+    // Convert to power
+    int64_t real = sig_buffer[i].real;
+    int64_t imag = sig_buffer[i].imag;
+    uint64_t mag_squared = (uint64_t)(real * real) + (uint64_t)(imag * imag);
+    bin_powers[i] = mag_squared;
+  }
+  resampler.Process(bin_powers, frame_powers);
+  arm_scale_f32(frame_powers, scale, frame_powers, 480);
+  profile.Lap(stage_power, t);
+
+  return true;
+}
+
+int Application::SetFftSize(unsigned int fft_size) {
+  if (!app::math::is_valid_fft_len(fft_size)) {
+    return 1;
+  }
+  pending_fft_size = fft_size;
+  return 0;
+}
+
+unsigned int Application::GetFftSize() {
+  return IsRealInput() ? recorder.GetNumSamples() / 2
+                       : recorder.GetNumSamples();
+}
+
+int Application::SetOverlap(unsigned int overlap) {
+  if (overlap < 1 || overlap > app::hw::recorder_max_overlap ||
+      (overlap & (overlap - 1)) != 0) {
+    return 1;
+  }
+  pending_overlap = overlap;
+  return 0;
+}
+
+unsigned int Application::GetOverlap() {
+  return recorder.GetOverlap();
+}
+
+int Application::SetFramesPerRow(unsigned int new_frames_per_row) {
+  if (new_frames_per_row < 1 || new_frames_per_row > max_frames_per_row) {
+    return 1;
+  }
+  pending_frames_per_row = new_frames_per_row;
+  return 0;
+}
+
+unsigned int Application::GetFramesPerRow() {
+  return frames_per_row;
+}
+
+void Application::SetInput(app::hw::RecorderInput input) {
+  pending_input = (unsigned int)input + 1;
+}
+
+app::hw::RecorderInput Application::GetInput() {
+  return recorder.GetInput();
+}
+
+bool Application::IsRealInput() {
+  return recorder.GetInput() != app::hw::RecorderInput::IQ;
+}
+
+bool Application::IsZoomed() {
+  return zoom_factor > 1 && !IsRealInput();
+}
+
+int Application::SetZoom(unsigned int factor, int32_t offset_hz) {
+  if (factor < 1 || factor > app::math::zoom_max_factor ||
+      (factor & (factor - 1)) != 0) {
+    return 1;
+  }
+  const int32_t max_offset = app::hw::recorder_sample_rate / 2;
+  if (offset_hz < -max_offset || offset_hz > max_offset) {
+    return 1;
+  }
+  pending_zoom_offset = offset_hz;
+  pending_zoom_factor = factor;
+  return 0;
+}
+
+unsigned int Application::GetZoomFactor() {
+  return zoom_factor;
+}
+
+int32_t Application::GetZoomOffset() {
+  return zoom_offset;
+}
+
+int Application::SetDemod(app::math::DemodMode mode, int32_t offset_hz) {
+  if (mode > app::math::DemodMode::CW) {
+    return 1;
+  }
+  const int32_t max_offset = app::hw::recorder_sample_rate / 2;
+  if (offset_hz < -max_offset || offset_hz > max_offset) {
+    return 1;
+  }
+  pending_demod_offset = offset_hz;
+  pending_demod_mode = (unsigned int)mode + 1;
+  return 0;
+}
+
+app::math::DemodMode Application::GetDemodMode() {
+  return demod.GetMode();
+}
+
+int32_t Application::GetDemodOffset() {
+  return demod_offset;
+}
+
+uint32_t Application::GetDemodBudget() {
+  return (uint64_t)SystemCoreClock * app::math::demod_block_len /
+         app::hw::recorder_sample_rate;
+}
+
+uint32_t Application::GetHopBudget() {
+  return (uint64_t)SystemCoreClock * recorder.GetHopSamples() /
+         app::hw::recorder_sample_rate;
+}
+
+void Application::SetFftEngine(FftEngine engine) {
+  if ((engine == FftEngine::Polyphase) !=
+      (fft_engine == FftEngine::Polyphase)) {
+    pending_polyphase = 1;
+  }
+  fft_engine = engine;
+}
+
+FftEngine Application::GetFftEngine() {
+  return fft_engine;
+}
+
+void Application::SetCatchUp(CatchUp new_catch_up) {
+  catch_up = new_catch_up;
+}
+
+CatchUp Application::GetCatchUp() {
+  return catch_up;
+}
+
+void Application::SetWaterfallScroll(WaterfallScroll scroll) {
+  waterfall_scroll = scroll;
+}
+
+WaterfallScroll Application::GetWaterfallScroll() {
+  return waterfall_scroll;
+}
+
+uint32_t Application::GetSkippedSegments() {
+  return skipped_counter.GetValue();
+}
+
+uint32_t Application::GetBatchedFrames() {
+  return batched_counter.GetValue();
+}
+
+uint32_t Application::GetGapRows() {
+  return gap_row_counter.GetValue();
+}
+
+uint32_t Application::GetHeldFrames() {
+  return held_counter.GetValue();
+}
+
+// Both views the display may be scanning out constrain the rows
+unsigned int Application::GetWaterfallFreeLines() {
+  const unsigned int shown =
+      waterfall.GetFreeLines(display.GetShownBackgroundView());
+  const unsigned int flipped =
+      waterfall.GetFreeLines(display.GetFlippedBackgroundView());
+  return shown < flipped ? shown : flipped;
+}
+
+app::debug::Histogram &Application::GetLatencyHistogram() {
+  return latency_histogram;
+}
+
+int Application::SetColorRange(float32_t min_log2, float32_t max_log2) {
+  if (!(max_log2 > min_log2)) {
+    return 1;
+  }
+  pending_color_min = min_log2;
+  pending_color_max = max_log2;
+  pending_color_scale = 1;
+  return 0;
+}
+
+float32_t Application::GetColorMin() {
+  return color_scale.GetMin();
+}
+
+float32_t Application::GetColorMax() {
+  return color_scale.GetMax();
+}
+
+void Application::SetAutoColorRange(bool enabled) {
+  agc = enabled;
+}
+
+bool Application::GetAutoColorRange() {
+  return agc;
+}
+
+float32_t Application::GetNoiseFloor() {
+  return noise_floor.Get();
+}
+
+void Application::SetTraces(unsigned int new_traces) {
+  requested_traces = new_traces & ((1 << num_traces) - 1);
+}
+
+unsigned int Application::GetTraces() {
+  return traces;
+}
+
+const float32_t *Application::GetColumnPowers() {
+  for (unsigned int i = 0; i < 480; i++) {
+    float32_t power = column_powers[i];
+    column_log2_powers[i] = power > min_power ? power : min_power;
+  }
+  app::math::fast_log2_array<column_log2_order>(
+      column_log2_powers, column_log2_powers, 480, 0);
+  return column_log2_powers;
+}
+
+void Application::Report() {
+  const app::debug::Profile::Stage &process = profile.GetStage(stage_process);
+  const uint32_t budget = GetHopBudget();
+  const uint32_t avg =
+      process.count ? (uint32_t)(process.total_cycles / process.count) : 0;
+  dbg.printf(
+      "fft %u, overlap %u, frames/row %u, hop budget %" PRIu32
+      " cycles, used %" PRIu32 "%% avg, %" PRIu32 "%% max\n",
+      GetFftSize(),
+      GetOverlap(),
+      GetFramesPerRow(),
+      budget,
+      (uint32_t)((uint64_t)avg * 100 / budget),
+      (uint32_t)((uint64_t)process.max_cycles * 100 / budget));
+  dbg.printf(
+      "catch-up %s: %" PRIu32 " skipped, %" PRIu32 " batched, %" PRIu32
+      " gap rows, %" PRIu32 " held\n",
+      catch_up_name(catch_up),
+      skipped_counter.GetValue(),
+      batched_counter.GetValue(),
+      gap_row_counter.GetValue(),
+      held_counter.GetValue());
+  if (demod.GetMode() != app::math::DemodMode::Off) {
+    const app::debug::Profile::Stage &stage = profile.GetStage(stage_demod);
+    const uint32_t demod_budget = GetDemodBudget();
+    const uint32_t demod_avg =
+        stage.count ? (uint32_t)(stage.total_cycles / stage.count) : 0;
+    dbg.printf(
+        "demod %s at %" PRId32 " Hz, block budget %" PRIu32
+        " cycles, used %" PRIu32 "%% avg, %" PRIu32 "%% max, %" PRIu32
+        " underruns, %" PRIu32 " overruns\n",
+        app::math::demod_mode_name(demod.GetMode()),
+        demod_offset,
+        demod_budget,
+        (uint32_t)((uint64_t)demod_avg * 100 / demod_budget),
+        (uint32_t)((uint64_t)stage.max_cycles * 100 / demod_budget),
+        player.GetUnderruns(),
+        player.GetOverruns());
+  }
+  latency_histogram.Report();
+  profile.Report();
+  dma.Report();
+  dma.ResetStats();
 }
 
 void Application::RenderThread() {
@@ -125,82 +961,307 @@ void Application::RenderThread() {
   }
 }
 
+void Application::DemodThread() {
+  while (true) {
+    event_flags.wait_all(ApplicationEventFlags::WakeupDemodThread);
+    ProcessDemod();
+  }
+}
+
+void Application::ProcessDemod() {
+  const unsigned int new_mode =
+      __sync_lock_test_and_set(&pending_demod_mode, 0);
+  if (new_mode) {
+    demod_offset = pending_demod_offset;
+    crash_if(
+        dbg,
+        0 != demod.Configure(
+                 (app::math::DemodMode)(new_mode - 1),
+                 demod_offset,
+                 app::hw::recorder_sample_rate));
+  }
+
+  // While off, blocks aren't converted at all, so the consumer falls behind
+  // and drops them when turned on. Blocks after such a gap (or a restart of
+  // the recorder) start from a clean filter.
+  if (demod.GetMode() == app::math::DemodMode::Off ||
+      recorder.GetInput() != app::hw::RecorderInput::IQ) {
+    return;
+  }
+  const app::hw::RecorderBlock *block;
+  while (nullptr != (block = recorder.AcquireBlock(demod_consumer))) {
+    const uint32_t start = profile.Now();
+    if (block->seq != demod_seq) {
+      demod.Reset();
+    }
+    demod_seq = block->seq + 1;
+    demod.Process(block->samples, demod_audio);
+    recorder.ReleaseBlock(block);
+    player.Write(demod_audio);
+    profile.Lap(stage_demod, start);
+  }
+}
+
 void Application::Render() {
-  app::ui::Canvas &cv = canvas;
+  uint32_t t = profile.Now();
+
+  // Newest row drawn, for its latency once shown
+  const uint32_t row = row_count;
+  const uint32_t stamp = row_stamp;
 
-  // Background
-  waterfall.Render(display.GetBackground());
+  // Background: the waterfall's view, shown in place or copied by DMA
+  // while the CPU draws the foreground
+  const bool copy = waterfall_scroll != WaterfallScroll::Hardware;
+  if (copy) {
+    display.SetBackgroundView(nullptr);
+    waterfall.Render(display.GetBackground());
+  } else {
+    display.SetBackgroundView(waterfall.GetView());
+  }
+  t = profile.Lap(stage_render_background, t);
 
-  // Foreground
+  // Foreground: static content where it changed, then traces
   canvas.SetBuffer(display.GetForeground());
+  ForegroundCache *cache = GetForegroundCache(&display.GetForeground());
+  UpdateLayout();
+  for (int i = 0; i < cache->dirty.Size(); i++) {
+    DrawStatic(cache->dirty.Get(i), cache);
+  }
+  cache->dirty.Clear();
+  DrawTraces(cache);
+  t = profile.Lap(stage_render_foreground, t);
 
-  // Foreground: grid
-  const uint32_t grid_color = 0xFF333333;
-  for (unsigned int y = 0; y < cv.SizeY(); y++) {
-    if (y % 6 < 3) {
-      continue;
+  if (copy) {
+    waterfall.WaitRendered();
+    profile.Lap(stage_render_wait, t);
+  }
+
+  flipped_row = row;
+  flipped_stamp = stamp;
+  display.Flip();
+}
+
+// For the layout last drawn. When zoomed, only the zoom centre.
+bool Application::IsGridColumn(unsigned int x) {
+  if (layout_real_input) {
+    for (unsigned int column : real_grid_columns) {
+      if (x == column) {
+        return true;
+      }
     }
-    cv.DrawPixel(27 + ui_shift, y, grid_color);   // -20kHz
-    cv.DrawPixel(80 + ui_shift, y, grid_color);   // -15kHz
-    cv.DrawPixel(133 + ui_shift, y, grid_color);  // -10kHz
-    cv.DrawPixel(187 + ui_shift, y, grid_color);  // -5kHz
-    cv.DrawPixel(239 + ui_shift, y, grid_color);  // Center
-    cv.DrawPixel(240 + ui_shift, y, grid_color);  // Center
-    cv.DrawPixel(293 + ui_shift, y, grid_color);  // +5kHz
-    cv.DrawPixel(347 + ui_shift, y, grid_color);  // +10kHz
+    return false;
   }
+  if (layout_zoom_factor > 1) {
+    return x == 239 || x == 240;
+  }
+  for (unsigned int column : grid_columns) {
+    if (x == column + ui_shift) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  // Foreground: color key
-  for (unsigned int x = 0; x < 8; x++) {
-    cv.DrawPixel(x, 0, 0xFFFFFFFF);
-    for (unsigned int y = 0; y < 256; y++) {
-      cv.DrawPixel(x, y, app::data::GRADIENT[255 - y]);
+Application::ForegroundCache *Application::GetForegroundCache(
+    const void *buffer) {
+  ForegroundCache *cache = nullptr;
+  for (ForegroundCache &c : foreground_caches) {
+    if (c.buffer == buffer || (!cache && !c.buffer)) {
+      cache = &c;
     }
-    for (unsigned int y = 256; y < cv.SizeY(); y++) {
-      cv.DrawPixel(x, y, 0xFF000000);
+  }
+  crash_if(dbg, !cache);
+  cache->buffer = buffer;
+  return cache;
+}
+
+// Marks a rectangle for redrawing in every foreground buffer.
+void Application::InvalidateForeground(const app::ui::Rect &rect) {
+  for (ForegroundCache &cache : foreground_caches) {
+    cache.dirty.Add(rect);
+  }
+}
+
+// Takes the settings that the static foreground depends on. If they
+// changed, invalidates what moved: grid columns that appeared or went away,
+// and the menu bar.
+void Application::UpdateLayout() {
+  const bool real = IsRealInput();
+  const unsigned int factor = IsZoomed() ? zoom_factor : 1;
+  const int32_t offset = factor > 1 ? zoom_offset : 0;
+  if (layout_valid && real == layout_real_input &&
+      factor == layout_zoom_factor && offset == layout_zoom_offset) {
+    return;
+  }
+  layout_real_input = real;
+  layout_zoom_factor = factor;
+  layout_zoom_offset = offset;
+
+  // All of the foreground is dirty before the first layout
+  const int size_x = canvas.SizeX();
+  const int menu_y = canvas.SizeY() - menu_bar_height;
+  for (int x = 0; x < size_x; x++) {
+    const bool grid = IsGridColumn(x);
+    if (layout_valid && grid != grid_column_map[x]) {
+      InvalidateForeground({x, 0, x + 1, menu_y});
     }
+    grid_column_map[x] = grid;
   }
+  InvalidateForeground({0, menu_y, size_x, (int)canvas.SizeY()});
+  layout_valid = true;
+}
+
+// Redraws the static content within a rectangle of the current buffer.
+// Traces there are painted over, and left to DrawTraces() to redraw.
+void Application::DrawStatic(
+    const app::ui::Rect &rect, ForegroundCache *cache) {
+  app::ui::Canvas &cv = canvas;
+  const int menu_y = cv.SizeY() - menu_bar_height;
+
+  cv.FillRect(rect, transparent_color);
 
-  // Foreground: menu bar
-  const uint32_t menu_bg_color = 0xFF000000;
-  for (unsigned int x = 0; x < cv.SizeX(); x++) {
-    for (unsigned int y = cv.SizeY() - 14; y < cv.SizeY(); y++) {
-      cv.DrawPixel(x, y, 0xFF000000);
+  // Grid
+  const int grid_y1 = rect.y1 < menu_y ? rect.y1 : menu_y;
+  for (int x = rect.x0; x < rect.x1; x++) {
+    if (!grid_column_map[x]) {
+      continue;
+    }
+    for (int y = rect.y0; y < grid_y1; y++) {
+      if (is_grid_row(y)) {
+        cv.DrawPixel(x, y, grid_color);
+      }
     }
   }
 
-  // Foreground: menu bar, scale
-  const uint32_t menu_text_color = 0xFFFFFFFF;
-  cv.DrawText(27 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "-20");
-  cv.DrawText(80 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "-15");
-  cv.DrawText(133 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "-10");
-  cv.DrawText(187 - 7 + ui_shift, 260, menu_text_color, menu_bg_color, "-5");
-  cv.DrawText(240 - 3 + ui_shift, 260, menu_text_color, menu_bg_color, "0");
-  cv.DrawText(293 - 7 + ui_shift, 260, menu_text_color, menu_bg_color, "+5");
-  cv.DrawText(347 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "+10");
-  display.Flip();
+  // Color key
+  for (int x = rect.x0; x < rect.x1 && x < key_width; x++) {
+    for (int y = rect.y0; y < rect.y1; y++) {
+      cv.DrawPixel(x, y, y < 256 ? app::data::GRADIENT[255 - y] : 0xFF000000);
+    }
+  }
+
+  // Menu bar. The text is drawn whole, the menu bar is only invalidated as
+  // a whole.
+  if (rect.y1 > menu_y) {
+    cv.FillRect(
+        {rect.x0, rect.y0 > menu_y ? rect.y0 : menu_y, rect.x1, rect.y1},
+        menu_bg_color);
+    DrawMenuBarText();
+  }
+
+  for (int x = rect.x0; x < rect.x1; x++) {
+    for (unsigned int i = 0; i < num_traces; i++) {
+      const int y = cache->trace_y[i][x];
+      if (y >= rect.y0 && y < rect.y1) {
+        cache->trace_y[i][x] = trace_none;
+      }
+    }
+  }
+}
+
+// Scale (kHz relative to receive frequency, or absolute for a real input),
+// or zoom settings (the kHz scale doesn't apply)
+void Application::DrawMenuBarText() {
+  app::ui::Canvas &cv = canvas;
+  if (layout_real_input) {
+    cv.DrawText(100 - 3, 260, menu_text_color, menu_bg_color, "5");
+    cv.DrawText(200 - 7, 260, menu_text_color, menu_bg_color, "10");
+    cv.DrawText(300 - 7, 260, menu_text_color, menu_bg_color, "15");
+    cv.DrawText(400 - 7, 260, menu_text_color, menu_bg_color, "20");
+  } else if (layout_zoom_factor > 1) {
+    char text[48];
+    snprintf(
+        text,
+        sizeof(text),
+        "zoom x%u at %+ld Hz",
+        layout_zoom_factor,
+        (long)layout_zoom_offset);
+    cv.DrawText(240 - 3 * 7, 260, menu_text_color, menu_bg_color, text);
+  } else {
+    cv.DrawText(27 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "-20");
+    cv.DrawText(80 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "-15");
+    cv.DrawText(
+        133 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "-10");
+    cv.DrawText(187 - 7 + ui_shift, 260, menu_text_color, menu_bg_color, "-5");
+    cv.DrawText(240 - 3 + ui_shift, 260, menu_text_color, menu_bg_color, "0");
+    cv.DrawText(293 - 7 + ui_shift, 260, menu_text_color, menu_bg_color, "+5");
+    cv.DrawText(
+        347 - 10 + ui_shift, 260, menu_text_color, menu_bg_color, "+10");
+  }
+}
+
+// Draws one pixel per trace and column, where color c is row 255 - c like
+// the color key. Pixels stay in the buffer, so only columns where a trace
+// moved since this buffer was last drawn are redrawn: old pixels are
+// restored (to the grid, which stays in the buffer too), then all traces of
+// the column are drawn (they may overlap).
+void Application::DrawTraces(ForegroundCache *cache) {
+  app::ui::Canvas &cv = canvas;
+
+  const unsigned int shown = traces;
+  for (unsigned int x = key_width; x < cv.SizeX(); x++) {
+    uint16_t y[num_traces];
+    bool moved = false;
+    for (unsigned int i = 0; i < num_traces; i++) {
+      y[i] = shown & (1 << i) ? 255 - trace_colors[i][x] : trace_none;
+      moved |= y[i] != cache->trace_y[i][x];
+    }
+    if (!moved) {
+      continue;
+    }
+
+    for (unsigned int i = 0; i < num_traces; i++) {
+      const uint16_t old_y = cache->trace_y[i][x];
+      if (old_y != trace_none) {
+        const bool grid = grid_column_map[x] && is_grid_row(old_y);
+        cv.DrawPixel(x, old_y, grid ? grid_color : transparent_color);
+      }
+    }
+    for (unsigned int i = 0; i < num_traces; i++) {
+      if (y[i] != trace_none) {
+        cv.DrawPixel(x, y[i], trace_argb[i]);
+      }
+      cache->trace_y[i][x] = y[i];
+    }
+  }
 }
 
 void Application::HandleAudioInHalfTransferComplete() {
-  recorder.HandleHalfTransferComplete();
-  event_flags.set(ApplicationEventFlags::WakeupProcessAudioThread);
+  recorder.HandleHalfTransferComplete(profile.Now());
+  event_flags.set(
+      ApplicationEventFlags::WakeupProcessAudioThread |
+      ApplicationEventFlags::WakeupDemodThread);
 }
 
 void Application::HandleAudioInTransferComplete() {
-  recorder.HandleTransferComplete();
-  event_flags.set(ApplicationEventFlags::WakeupProcessAudioThread);
+  recorder.HandleTransferComplete(profile.Now());
+  event_flags.set(
+      ApplicationEventFlags::WakeupProcessAudioThread |
+      ApplicationEventFlags::WakeupDemodThread);
 }
 
 void Application::HandleAudioInError() {
   recorder.HandleAudioInError();
 }
 
+void Application::HandleAudioOutHalfTransferComplete() {
+  player.HandleHalfTransferComplete();
+}
+
+void Application::HandleAudioOutTransferComplete() {
+  player.HandleTransferComplete();
+}
+
 void Application::HandleLtdcUnderrun() {
   display.HandleUnderrun();
 }
 
 void Application::HandleLtdcReload() {
-  display.HandleReload();
+  const uint32_t now = profile.Now();
+  if (display.HandleReload() && flipped_row != shown_row) {
+    shown_row = flipped_row;
+    latency_histogram.Add(now - flipped_stamp);
+  }
 }
 
 void Application::HandleLtdcIRQ() {
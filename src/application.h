@@ -3,52 +3,386 @@
 #include <mbed.h>
 #include <mbed_events.h>
 
+#include "debug/counter.h"
+#include "debug/histogram.h"
+#include "debug/profile.h"
 #include "hw/display.h"
+#include "hw/dma.h"
+#include "hw/player.h"
 #include "hw/recorder.h"
 #include "hw/volatile_buffer.h"
+#include "math/demodulator.h"
+#include "math/fft.h"
+#include "math/noise_floor.h"
+#include "math/resampler.h"
+#include "math/zoom.h"
 #include "ui/canvas.h"
+#include "ui/color_scale.h"
+#include "ui/dirty_region.h"
 #include "ui/waterfall.h"
 
 namespace app {
 
+enum class FftEngine {
+  Float32,  // arm_cfft_f32
+  Q15,      // arm_cfft_q15, block scaled, integer magnitude
+  Q31,      // arm_cfft_q31, block scaled, integer magnitude
+  // arm_cfft_f32 of polyphase filter bank frames: up to
+  // app::hw::recorder_max_taps times the FFT size, folded by a prototype
+  // filter (see Recorder::Configure()). Flat, isolated bins.
+  Polyphase,
+};
+
+static const unsigned int max_frames_per_row = 64;
+
+// What ProcessAudio() does with segments that are pending because processing
+// fell behind (e.g. a load spike). Audio lost either way (overwritten, or
+// skipped) is marked by a gap row in the waterfall.
+enum class CatchUp {
+  All,     // Process all in order, dropping the oldest when the ring is full
+  Newest,  // Skip to the newest segment
+  Batch,   // Average up to twice the frames per row into one row
+};
+
+// How the waterfall gets to the screen
+enum class WaterfallScroll {
+  Copy,      // Copied into the background buffer by DMA per frame
+  Hardware,  // Shown in place, scrolled by the display's start address
+};
+
+// Spectrum traces drawn over the waterfall, combined for SetTraces()
+enum TraceFlags {
+  TracePeak = 0x01,     // Peak hold, decaying
+  TraceMin = 0x02,      // Min hold
+  TraceAverage = 0x04,  // Long term average
+};
+
+static const unsigned int num_traces = 3;  // Trace i has flag 1 << i
+
+const char *fft_engine_name(FftEngine engine);
+const char *catch_up_name(CatchUp catch_up);
+const char *waterfall_scroll_name(WaterfallScroll scroll);
+
 class Application {
  private:
   EventQueue event_queue;
   EventFlags event_flags;
   Thread process_audio_thread;
   Thread render_thread;
+  Thread demod_thread;
 
   app::debug::Debug &dbg;
+  app::debug::Profile &profile;
+
+  // Profile stages
+  const unsigned int stage_process;  // All of ProcessAudio(), i.e. per hop
+  const unsigned int stage_read;
+  const unsigned int stage_zoom;
+  const unsigned int stage_fft;
+  const unsigned int stage_power;
+  const unsigned int stage_accumulate;
+  const unsigned int stage_agc;
+  const unsigned int stage_columns;
+  const unsigned int stage_render_background;
+  const unsigned int stage_render_foreground;
+  const unsigned int stage_render_wait;  // For the background copy
+  const unsigned int stage_demod;  // Per block of demod_block_len samples
+
+  FftEngine fft_engine = FftEngine::Float32;
+
+  volatile CatchUp catch_up = CatchUp::All;
+
+  volatile WaterfallScroll waterfall_scroll = WaterfallScroll::Hardware;
+
+  // Catch-up outcomes
+  app::debug::Counter skipped_counter;  // Segments skipped (Newest)
+  app::debug::Counter batched_counter;  // Frames added to rows (Batch)
+  app::debug::Counter gap_row_counter;  // Gap rows, for any lost audio
+  app::debug::Counter held_counter;     // Frames added to rows held back
+
+  // Segments dropped or skipped as of the last row, to detect new gaps
+  uint32_t lost_segments = 0;
+
+  // Capture to display latency: rows are stamped with the capture time of
+  // their newest segment, which is carried through Render() to the reload
+  // showing it. Rows are counted to measure each shown row once.
+  volatile uint32_t row_count = 0;
+  volatile uint32_t row_stamp = 0;
+  volatile uint32_t flipped_row = 0;  // Row count and stamp of the last Flip()
+  volatile uint32_t flipped_stamp = 0;
+  uint32_t shown_row = 0;
+  app::debug::Histogram latency_histogram;
 
+  // Settings changes requested, applied by the audio thread (0 = none)
+  volatile unsigned int pending_fft_size = 0;
+  volatile unsigned int pending_overlap = 0;
+  volatile unsigned int pending_frames_per_row = 0;
+  volatile unsigned int pending_zoom_factor = 0;
+  volatile int32_t pending_zoom_offset = 0;
+  volatile unsigned int pending_input = 0;  // RecorderInput + 1
+  volatile unsigned int pending_polyphase = 0;  // Engine switched to or from
+  volatile unsigned int pending_color_scale = 0;  // Range below is valid
+  volatile float32_t pending_color_min = 0;
+  volatile float32_t pending_color_max = 0;
+
+  // Demodulator settings requested, applied by the demod thread
+  volatile unsigned int pending_demod_mode = 0;  // DemodMode + 1
+  volatile int32_t pending_demod_offset = 0;
+
+  // Real FFT, for a real input
+  arm_rfft_fast_instance_f32 rfft_instance;
+
+  // Zoom FFT, if factor > 1. Its frames are built in the recorder's frame
+  // buffer.
+  app::math::Zoom zoom;
+  unsigned int zoom_factor = 1;
+  int32_t zoom_offset = 0;
+
+  // Frames averaged (Welch) per waterfall row, and frames in the current row
+  unsigned int frames_per_row = 1;
+  unsigned int row_frames = 0;
+  float32_t row_scale = 1;  // 1 / frames_per_row
+
+  // Demodulator, fed with the recorder's shared blocks as consumer
+  // demod_consumer. Reset when the next block isn't demod_seq.
+  app::math::Demodulator demod;
+  int32_t demod_offset = 0;
+  int demod_consumer = 0;
+  uint32_t demod_seq = 0;
+  float32_t demod_audio[app::math::demod_block_len];
+
+  // Maps FFT bins onto columns. Rebuilt when the FFT size or the span
+  // (zoom) changes.
+  app::math::Resampler resampler;
+
+  // Unscaled power per FFT bin, plus the resampler's padding
+  float32_t bin_powers[app::math::max_fft_len + app::math::resampler_padding];
+
+  // Linear power per column of the last frame, as the squared magnitude of
+  // the unscaled FFT of the windowed input (regardless of engine), normalized
+  // to the reference FFT size.
+  float32_t frame_powers[480];
+
+  // Sum of frame_powers over the current row
+  float32_t row_powers[480];
+
+  // Mean power per column of the last row
+  float32_t column_powers[480] = {0};
+
+  // log2 of column_powers, computed on request only
+  float32_t column_log2_powers[480];
+
+  // Averaged column powers, in linear power
   float32_t powers[480] = {0};
 
+  // Maps powers to colors without taking the log
+  app::ui::ColorScale color_scale;
+
+  // Automatic color range, following the noise floor of the averaged powers
+  volatile bool agc = true;
+  app::math::NoiseFloor noise_floor;
+
+  // Traces requested by SetTraces(), and those shown
+  volatile unsigned int requested_traces = 0;
+  volatile unsigned int traces = 0;
+
+  // Trace powers (linear), updated with the display averaging, and their
+  // colors, i.e. 255 - pixel row
+  float32_t trace_powers[num_traces][480];
+  uint8_t trace_colors[num_traces][480];
+
+  // Retained state of each foreground buffer (triple buffered). The static
+  // content (grid, color key, menu bar) is only redrawn within the dirty
+  // region, i.e. where it changed since the buffer was last drawn. Traces
+  // keep their pixel rows, so that only columns whose trace pixel moved are
+  // redrawn (trace_none if not drawn).
+  struct ForegroundCache {
+    const void *buffer;
+    app::ui::DirtyRegion dirty;
+    uint16_t trace_y[num_traces][480];
+  };
+  ForegroundCache foreground_caches[3];
+
+  // Static foreground layout last drawn, and its grid columns. Only used by
+  // Render().
+  bool layout_valid = false;
+  bool layout_real_input = false;
+  unsigned int layout_zoom_factor = 1;  // 1 unless zoomed
+  int32_t layout_zoom_offset = 0;
+  bool grid_column_map[480];
+
+  // Waterfall row being built
+  uint8_t colors[480];
+
+  // Waterfall row marking lost audio
+  uint8_t gap_colors[480];
+
+  void BuildColumnMap();
+  void ApplySettings();
+  bool ComputeFramePowers();
+
+  bool ComputeFramePowersFloat32();
+  bool ComputeFramePowersQ15();
+  bool ComputeFramePowersQ31();
+  bool ComputeFramePowersZoom();
+  bool ComputeFramePowersReal();
+  void TransformFloat32(app::structs::Complex<float32_t> *sig_buffer);
+
+  bool IsRealInput();
+  bool IsZoomed();
+  unsigned int GetWaterfallFreeLines();
+
+  bool IsGridColumn(unsigned int x);
+  ForegroundCache *GetForegroundCache(const void *buffer);
+  void InvalidateForeground(const app::ui::Rect &rect);
+  void UpdateLayout();
+  void DrawStatic(const app::ui::Rect &rect, ForegroundCache *cache);
+  void DrawMenuBarText();
+  void DrawTraces(ForegroundCache *cache);
+
   void ProcessAudioThread();
-  void ProcessAudio();
   void RenderThread();
-  void Render();
+  void DemodThread();
 
  public:
   app::hw::Display &display;
   app::ui::Canvas &canvas;
   app::hw::Recorder &recorder;
+  app::hw::Player &player;
 
   app::ui::Waterfall &waterfall;
+  app::hw::DmaManager &dma;
 
   Application(
       app::debug::Debug &dbg,
+      app::debug::Profile &profile,
       app::hw::Display &display,
       app::ui::Canvas &canvas,
       app::hw::Recorder &recorder,
-      app::ui::Waterfall &waterfall);
+      app::hw::Player &player,
+      app::ui::Waterfall &waterfall,
+      app::hw::VolatileBuffer<app::structs::Complex<float32_t>> &zoom_buffer,
+      app::hw::DmaManager &dma);
   int Init();
   void Run();
 
+  // Single pipeline steps. Normally called by the threads started by Run(),
+  // but may be called directly when driving the pipeline synchronously.
+  void ProcessAudio();
+  void Render();
+  void ProcessDemod();
+
+  // Takes effect with the next ProcessAudio(), discarding audio in flight.
+  int SetFftSize(unsigned int fft_size);
+  unsigned int GetFftSize();
+
+  // Frames per FFT size, i.e. 1 (no overlap), 2 (50%), 4 (75%) or 8.
+  // Takes effect with the next ProcessAudio(), discarding audio in flight.
+  int SetOverlap(unsigned int overlap);
+  unsigned int GetOverlap();
+
+  // Frames averaged per waterfall row (1 to max_frames_per_row), in linear
+  // power. Sets the scroll speed. Takes effect with the next ProcessAudio(),
+  // starting a new row.
+  int SetFramesPerRow(unsigned int frames_per_row);
+  unsigned int GetFramesPerRow();
+
+  // I/Q (default) or a real signal on one channel. A real input is
+  // transformed at twice the FFT size, of which the positive half (the FFT
+  // size in bins) spans the display, i.e. the resolution doubles for the
+  // same cost. FFT sizes above app::math::max_fft_len / 2 are reduced to it.
+  // Zoom and the fixed point engines only apply to I/Q. Takes effect with
+  // the next ProcessAudio(), discarding audio in flight.
+  void SetInput(app::hw::RecorderInput input);
+  app::hw::RecorderInput GetInput();
+
+  // Zooms into sample_rate / factor around a centre offset in Hz (input
+  // frequency, i.e. before the display's inversion). Factor 1 is off, else
+  // a power of two up to app::math::zoom_max_factor. Zoom always uses the
+  // f32 engine. Takes effect with the next ProcessAudio().
+  int SetZoom(unsigned int factor, int32_t offset_hz);
+  unsigned int GetZoomFactor();
+  int32_t GetZoomOffset();
+
+  // What to do when processing falls behind, see CatchUp. Takes effect with
+  // the next ProcessAudio().
+  void SetCatchUp(CatchUp catch_up);
+  CatchUp GetCatchUp();
+
+  // Takes effect with the next Render().
+  void SetWaterfallScroll(WaterfallScroll scroll);
+  WaterfallScroll GetWaterfallScroll();
+
+  // Catch-up outcomes so far.
+  uint32_t GetSkippedSegments();
+  uint32_t GetBatchedFrames();
+  uint32_t GetGapRows();
+
+  // Frames added to rows held back until the display showed a newer view of
+  // the waterfall, as the next row would have overwritten lines still shown.
+  uint32_t GetHeldFrames();
+
+  // Cycles from capturing a row's newest segment to showing the row, for
+  // rows shown. Written by the LTDC ISR.
+  app::debug::Histogram &GetLatencyHistogram();
+
+  // Cycles available per hop to keep up with the audio.
+  uint32_t GetHopBudget();
+
+  // Demodulates a carrier at offset_hz (input frequency, like the zoom)
+  // to the headphone output, or Off (default). I/Q input only. Runs in its
+  // own thread, below the spectrum's, on the recorder's shared blocks.
+  // Takes effect with the next ProcessDemod().
+  int SetDemod(app::math::DemodMode mode, int32_t offset_hz);
+  app::math::DemodMode GetDemodMode();
+  int32_t GetDemodOffset();
+
+  // Cycles available per demodulated block to keep up with the audio.
+  uint32_t GetDemodBudget();
+
+  // Not thread safe against ProcessAudio(). Switching to or from Polyphase
+  // reconfigures the recorder with the next ProcessAudio(), discarding
+  // audio in flight.
+  void SetFftEngine(FftEngine engine);
+  FftEngine GetFftEngine();
+
+  // Colors span log2 power (relative to the reference FFT size) from min to
+  // max. Takes effect with the next ProcessAudio(). With automatic color
+  // range, only the span (max - min) is kept.
+  int SetColorRange(float32_t min_log2, float32_t max_log2);
+  float32_t GetColorMin();
+  float32_t GetColorMax();
+
+  // Automatic color range (on by default): keeps the noise floor at a fixed
+  // dark color, as antennas and bands change.
+  void SetAutoColorRange(bool enabled);
+  bool GetAutoColorRange();
+
+  // log2 of the tracked noise floor, like the color range.
+  float32_t GetNoiseFloor();
+
+  // Combination of TraceFlags. Takes effect with the next ProcessAudio(),
+  // newly enabled traces start from the averaged powers.
+  void SetTraces(unsigned int traces);
+  unsigned int GetTraces();
+
+  // log2 column powers of the last row, before display averaging. Not
+  // thread safe against ProcessAudio().
+  const float32_t *GetColumnPowers();
+
+  // Prints the per stage profile and the hop budget.
+  void Report();
+
   void HandleAudioInHalfTransferComplete();
 
   void HandleAudioInTransferComplete();
 
   void HandleAudioInError();
 
+  void HandleAudioOutHalfTransferComplete();
+
+  void HandleAudioOutTransferComplete();
+
   void HandleLtdcUnderrun();
 
   void HandleLtdcReload();
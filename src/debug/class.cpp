@@ -22,7 +22,7 @@ void Debug::do_crash(const char *func, const char *file, int line) {
   console.printf("\nCrash in %s (%s:%d)\n", func, file, line);
 
   // Call debugger or trigger hard fault
-  __asm__("BKPT");
+  __BKPT(0);
 
   // We won't return from bkpt, but to be sure
   while (true) {
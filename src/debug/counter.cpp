@@ -16,6 +16,10 @@ void Counter::Increment() {
   __sync_fetch_and_add(&counter, 1);
 }
 
+void Counter::Add(uint32_t n) {
+  __sync_fetch_and_add(&counter, n);
+}
+
 uint32_t Counter::GetValue() {
   return counter;
 }
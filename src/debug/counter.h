@@ -17,6 +17,7 @@ class Counter {
   const char* const name;
   Counter(app::debug::Debug& dbg, const char* name);
   void Increment();
+  void Add(uint32_t n);
   uint32_t GetValue();
 };
 
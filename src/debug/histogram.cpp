@@ -0,0 +1,103 @@
+#include <inttypes.h>
+#include <stdint.h>
+
+#include <mbed.h>
+
+#include "debug/class.h"
+
+#include "debug/histogram.h"
+
+namespace app::debug {
+
+Histogram::Histogram(app::debug::Debug &dbg, const char *name)
+    : dbg(dbg), name(name) {
+}
+
+void Histogram::Add(uint32_t cycles) {
+  buckets[GetBucketIndex(cycles)]++;
+  count++;
+  total += cycles;
+  if (cycles > max) {
+    max = cycles;
+  }
+}
+
+void Histogram::Reset() {
+  for (unsigned int i = 0; i < histogram_num_buckets; i++) {
+    buckets[i] = 0;
+  }
+  count = 0;
+  max = 0;
+  total = 0;
+}
+
+uint32_t Histogram::GetCount() {
+  return count;
+}
+
+uint32_t Histogram::GetMax() {
+  return max;
+}
+
+uint64_t Histogram::GetTotal() {
+  return total;
+}
+
+uint32_t Histogram::GetBucket(unsigned int i) {
+  return buckets[i];
+}
+
+// Values below histogram_steps_per_octave get a bucket each. Above, the
+// bucket is the octave plus the bits following the leading one.
+unsigned int Histogram::GetBucketIndex(uint32_t value) {
+  if (value < histogram_steps_per_octave) {
+    return value;
+  }
+  const unsigned int octave = 31 - __builtin_clz(value);
+  const unsigned int shift = octave - histogram_steps_log2;
+  return ((shift + 1) << histogram_steps_log2) +
+         ((value >> shift) & (histogram_steps_per_octave - 1));
+}
+
+uint64_t Histogram::GetBucketMin(unsigned int i) {
+  if (i < histogram_steps_per_octave) {
+    return i;
+  }
+  const unsigned int shift = (i >> histogram_steps_log2) - 1;
+  const uint64_t mantissa =
+      histogram_steps_per_octave + (i & (histogram_steps_per_octave - 1));
+  return mantissa << shift;
+}
+
+uint64_t Histogram::GetPercentile(float fraction) {
+  const uint32_t n = count;
+  uint32_t below = 0;
+  for (unsigned int i = 0; i < histogram_num_buckets; i++) {
+    below += buckets[i];
+    if (below > 0 && below >= fraction * n) {
+      return GetBucketMin(i + 1);
+    }
+  }
+  return 0;
+}
+
+void Histogram::Report() {
+  const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+  const uint32_t n = count;
+  dbg.printf(
+      "%s: %" PRIu32 " values, avg %" PRIu32 " us, max %" PRIu32 " us\n",
+      name,
+      n,
+      n ? (uint32_t)(total / n / cycles_per_us) : 0,
+      max / cycles_per_us);
+  for (unsigned int i = 0; i < histogram_num_buckets; i++) {
+    if (buckets[i]) {
+      dbg.printf(
+          "  >= %10" PRIu32 " us %10" PRIu32 "\n",
+          (uint32_t)(GetBucketMin(i) / cycles_per_us),
+          buckets[i]);
+    }
+  }
+}
+
+}  // namespace app::debug
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "debug/class.h"
+
+namespace app::debug {
+
+// Histogram of cycle counts, e.g. latencies.
+//
+// Buckets are logarithmic with histogram_steps_per_octave linear steps per
+// power of two, so any 32 bit value fits, within 25% and without configuring
+// a range. Add() is a few instructions and may be called from
+// one ISR or thread at a time.
+static const unsigned int histogram_steps_log2 = 2;
+static const unsigned int histogram_steps_per_octave =
+    1 << histogram_steps_log2;
+static const unsigned int histogram_num_buckets =
+    (33 - histogram_steps_log2) * histogram_steps_per_octave;
+
+class Histogram {
+ private:
+  app::debug::Debug &dbg;
+
+  volatile uint32_t buckets[histogram_num_buckets] = {0};
+  volatile uint32_t count = 0;
+  volatile uint32_t max = 0;
+  volatile uint64_t total = 0;
+
+ public:
+  const char *const name;
+  Histogram(app::debug::Debug &dbg, const char *name);
+
+  void Add(uint32_t cycles);
+  void Reset();
+
+  uint32_t GetCount();
+  uint32_t GetMax();
+  uint64_t GetTotal();
+
+  // Values in bucket i are in [GetBucketMin(i), GetBucketMin(i + 1)).
+  uint32_t GetBucket(unsigned int i);
+  static unsigned int GetBucketIndex(uint32_t value);
+  static uint64_t GetBucketMin(unsigned int i);
+
+  // Smallest bucket minimum below which at least the given fraction of
+  // values are (i.e. an upper bound for the percentile), or 0 if empty.
+  uint64_t GetPercentile(float fraction);
+
+  // Prints the non-empty buckets in us, at SystemCoreClock.
+  void Report();
+};
+
+}  // namespace app::debug
@@ -8,12 +8,14 @@
 #define crash(debug_inst) \
   ((debug_inst).do_crash(__FUNCTION__, __FILE__, __LINE__))
 
-#define crash_if(debug_inst, x) \
-  ({                            \
-    if (unlikely(x)) {          \
-      crash(debug_inst);        \
-    };                          \
-    (x);                        \
+// Evaluates x once, as it usually has side effects (e.g. an Init()).
+#define crash_if(debug_inst, x)           \
+  ({                                      \
+    const bool crash_if_condition = (x);  \
+    if (unlikely(crash_if_condition)) {   \
+      crash(debug_inst);                  \
+    };                                    \
+    crash_if_condition;                   \
   })
 
 #define crash_if_not(debug_inst, x) crash_if((debug_inst), !(x))
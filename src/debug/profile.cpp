@@ -0,0 +1,52 @@
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "debug/class.h"
+#include "debug/macros.h"
+#include "hw/perf_timer.h"
+
+#include "debug/profile.h"
+
+namespace app::debug {
+
+Profile::Profile(app::debug::Debug &dbg, app::hw::PerfTimer &perf_timer)
+    : dbg(dbg), perf_timer(perf_timer) {
+}
+
+unsigned int Profile::Add(const char *name) {
+  crash_if(dbg, num_stages >= max_stages);
+  stages[num_stages].name = name;
+  return num_stages++;
+}
+
+unsigned int Profile::NumStages() {
+  return num_stages;
+}
+
+const Profile::Stage &Profile::GetStage(unsigned int stage) {
+  return stages[stage];
+}
+
+void Profile::Reset() {
+  for (unsigned int i = 0; i < num_stages; i++) {
+    stages[i].count = 0;
+    stages[i].max_cycles = 0;
+    stages[i].total_cycles = 0;
+  }
+}
+
+void Profile::Report() {
+  dbg.printf("%-16s %10s %10s %10s\n", "stage", "count", "avg", "max");
+  for (unsigned int i = 0; i < num_stages; i++) {
+    const Stage &s = stages[i];
+    uint32_t avg = s.count ? (uint32_t)(s.total_cycles / s.count) : 0;
+    dbg.printf(
+        "%-16s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+        s.name,
+        s.count,
+        avg,
+        s.max_cycles);
+  }
+}
+
+}  // namespace app::debug
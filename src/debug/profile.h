@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "debug/class.h"
+#include "hw/perf_timer.h"
+
+namespace app::debug {
+
+// Cycle accounting for named processing stages.
+//
+// Stages are registered once at startup. Lap() charges the cycles elapsed
+// since a timestamp to a stage and returns the current timestamp, so that
+// consecutive stages can be chained with a single counter read each.
+//
+// On the host build, the cycle counter runs at 1 GHz (i.e. counts ns).
+class Profile {
+ public:
+  static const unsigned int max_stages = 24;
+
+  struct Stage {
+    const char *name;
+    uint32_t count;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+  };
+
+ private:
+  app::debug::Debug &dbg;
+  app::hw::PerfTimer &perf_timer;
+
+  Stage stages[max_stages] = {};
+  unsigned int num_stages = 0;
+
+ public:
+  Profile(app::debug::Debug &dbg, app::hw::PerfTimer &perf_timer);
+
+  unsigned int Add(const char *name);
+
+  inline uint32_t Now();
+  inline uint32_t Lap(unsigned int stage, uint32_t since);
+
+  unsigned int NumStages();
+  const Stage &GetStage(unsigned int stage);
+
+  void Reset();
+  void Report();
+};
+
+inline uint32_t Profile::Now() {
+  return perf_timer.GetCycles();
+}
+
+inline uint32_t Profile::Lap(unsigned int stage, uint32_t since) {
+  uint32_t now = perf_timer.GetCycles();
+  uint32_t cycles = now - since;  // Wraps correctly
+  Stage &s = stages[stage];
+  s.count++;
+  s.total_cycles += cycles;
+  if (cycles > s.max_cycles) {
+    s.max_cycles = cycles;
+  }
+  return now;
+}
+
+}  // namespace app::debug
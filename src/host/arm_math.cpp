@@ -0,0 +1,327 @@
+#include <math.h>
+#include <stdint.h>
+
+#include <arm_const_structs.h>
+#include <arm_math.h>
+
+// Shared twiddle table for the largest supported FFT size. Smaller sizes
+// use every n-th entry.
+static const uint32_t max_fft_len = 4096;
+
+struct TwiddleTable {
+  float32_t data[2 * max_fft_len];
+
+  TwiddleTable() {
+    for (uint32_t i = 0; i < max_fft_len; i++) {
+      double phase = 2.0 * M_PI * i / max_fft_len;
+      data[2 * i + 0] = (float32_t)cos(phase);
+      data[2 * i + 1] = (float32_t)sin(phase);
+    }
+  }
+};
+
+static const float32_t *Twiddles() {
+  static const TwiddleTable table;
+  return table.data;
+}
+
+template <typename T>
+static void BitReverse(T *p, uint32_t len) {
+  for (uint32_t i = 1, j = 0; i < len; i++) {
+    uint32_t bit = len >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      T re = p[2 * i], im = p[2 * i + 1];
+      p[2 * i] = p[2 * j];
+      p[2 * i + 1] = p[2 * j + 1];
+      p[2 * j] = re;
+      p[2 * j + 1] = im;
+    }
+  }
+}
+
+// Radix-2 decimation in frequency. Like CMSIS, takes natural order input,
+// produces bit reversed output unless asked to reorder, and scales the
+// inverse transform by 1/N.
+void arm_cfft_f32(
+    const arm_cfft_instance_f32 *S,
+    float32_t *p1,
+    uint8_t ifftFlag,
+    uint8_t bitReverseFlag) {
+  const uint32_t len = S->fftLen;
+  const float32_t *tw = Twiddles();
+  const float32_t sign = ifftFlag ? 1.0f : -1.0f;
+
+  for (uint32_t span = len; span >= 2; span >>= 1) {
+    const uint32_t half = span / 2;
+    const uint32_t stride = max_fft_len / span;
+    for (uint32_t start = 0; start < len; start += span) {
+      float32_t *a = &p1[2 * start];
+      float32_t *b = &p1[2 * (start + half)];
+      for (uint32_t k = 0; k < half; k++) {
+        float32_t wr = tw[2 * k * stride];
+        float32_t wi = sign * tw[2 * k * stride + 1];
+        float32_t dr = a[2 * k] - b[2 * k];
+        float32_t di = a[2 * k + 1] - b[2 * k + 1];
+        a[2 * k] += b[2 * k];
+        a[2 * k + 1] += b[2 * k + 1];
+        b[2 * k] = dr * wr - di * wi;
+        b[2 * k + 1] = dr * wi + di * wr;
+      }
+    }
+  }
+
+  if (bitReverseFlag) {
+    BitReverse(p1, len);
+  }
+
+  if (ifftFlag) {
+    const float32_t scale = 1.0f / len;
+    for (uint32_t i = 0; i < 2 * len; i++) {
+      p1[i] *= scale;
+    }
+  }
+}
+
+arm_status arm_rfft_fast_init_f32(
+    arm_rfft_fast_instance_f32 *S, uint16_t fftLen) {
+  if (fftLen < 32 || fftLen > max_fft_len || (fftLen & (fftLen - 1)) != 0) {
+    return ARM_MATH_ARGUMENT_ERROR;
+  }
+  S->Sint = {(uint16_t)(fftLen / 2), nullptr, nullptr, 0};
+  S->fftLenRFFT = fftLen;
+  S->pTwiddleRFFT = nullptr;
+  return ARM_MATH_SUCCESS;
+}
+
+// Through a complex FFT of the full length, packed like CMSIS: DC and
+// Nyquist (both real) first, then bins 1 to fftLen / 2 - 1. CMSIS uses p
+// as scratch, so callers can't rely on it either way.
+void arm_rfft_fast_f32(
+    arm_rfft_fast_instance_f32 *S,
+    float32_t *p,
+    float32_t *pOut,
+    uint8_t ifftFlag) {
+  static float32_t buf[2 * max_fft_len];
+  if (ifftFlag) {
+    return;
+  }
+  const uint32_t len = S->fftLenRFFT;
+  for (uint32_t i = 0; i < len; i++) {
+    buf[2 * i + 0] = p[i];
+    buf[2 * i + 1] = 0;
+  }
+  const arm_cfft_instance_f32 full = {(uint16_t)len, nullptr, nullptr, 0};
+  arm_cfft_f32(&full, buf, 0, 1);
+  pOut[0] = buf[0];
+  pOut[1] = buf[len];
+  for (uint32_t k = 1; k < len / 2; k++) {
+    pOut[2 * k + 0] = buf[2 * k + 0];
+    pOut[2 * k + 1] = buf[2 * k + 1];
+  }
+}
+
+// Fixed point radix-2 decimation in frequency. Each stage halves its
+// outputs, so like CMSIS the result is scaled down by N (in both
+// directions), and rounding noise is comparable.
+template <typename Acc, int frac_bits>
+struct FixedTwiddleTable {
+  Acc data[2 * max_fft_len];
+
+  FixedTwiddleTable() {
+    const float32_t *tw = Twiddles();
+    const double one = (double)((Acc)1 << frac_bits) - 1;
+    for (uint32_t i = 0; i < 2 * max_fft_len; i++) {
+      data[i] = (Acc)llrint(one * tw[i]);
+    }
+  }
+};
+
+template <typename T, typename Acc, int frac_bits>
+static void FixedCfft(
+    T *p1, uint32_t len, uint8_t ifftFlag, uint8_t bitReverseFlag) {
+  static const FixedTwiddleTable<Acc, frac_bits> table;
+  const Acc *tw = table.data;
+  const Acc sign = ifftFlag ? 1 : -1;
+
+  for (uint32_t span = len; span >= 2; span >>= 1) {
+    const uint32_t half = span / 2;
+    const uint32_t stride = max_fft_len / span;
+    for (uint32_t start = 0; start < len; start += span) {
+      T *a = &p1[2 * start];
+      T *b = &p1[2 * (start + half)];
+      for (uint32_t k = 0; k < half; k++) {
+        Acc wr = tw[2 * k * stride];
+        Acc wi = sign * tw[2 * k * stride + 1];
+        Acc dr = ((Acc)a[2 * k] - b[2 * k]) >> 1;
+        Acc di = ((Acc)a[2 * k + 1] - b[2 * k + 1]) >> 1;
+        a[2 * k] = ((Acc)a[2 * k] + b[2 * k]) >> 1;
+        a[2 * k + 1] = ((Acc)a[2 * k + 1] + b[2 * k + 1]) >> 1;
+        b[2 * k] = (dr * wr - di * wi) >> frac_bits;
+        b[2 * k + 1] = (dr * wi + di * wr) >> frac_bits;
+      }
+    }
+  }
+
+  if (bitReverseFlag) {
+    BitReverse(p1, len);
+  }
+}
+
+void arm_cfft_q15(
+    const arm_cfft_instance_q15 *S,
+    q15_t *p1,
+    uint8_t ifftFlag,
+    uint8_t bitReverseFlag) {
+  FixedCfft<q15_t, int32_t, 15>(p1, S->fftLen, ifftFlag, bitReverseFlag);
+}
+
+void arm_cfft_q31(
+    const arm_cfft_instance_q31 *S,
+    q31_t *p1,
+    uint8_t ifftFlag,
+    uint8_t bitReverseFlag) {
+  FixedCfft<q31_t, int64_t, 31>(p1, S->fftLen, ifftFlag, bitReverseFlag);
+}
+
+void arm_add_f32(
+    const float32_t *pSrcA,
+    const float32_t *pSrcB,
+    float32_t *pDst,
+    uint32_t blockSize) {
+  for (uint32_t i = 0; i < blockSize; i++) {
+    pDst[i] = pSrcA[i] + pSrcB[i];
+  }
+}
+
+void arm_copy_f32(const float32_t *pSrc, float32_t *pDst, uint32_t blockSize) {
+  for (uint32_t i = 0; i < blockSize; i++) {
+    pDst[i] = pSrc[i];
+  }
+}
+
+void arm_fill_f32(float32_t value, float32_t *pDst, uint32_t blockSize) {
+  for (uint32_t i = 0; i < blockSize; i++) {
+    pDst[i] = value;
+  }
+}
+
+void arm_scale_f32(
+    const float32_t *pSrc,
+    float32_t scale,
+    float32_t *pDst,
+    uint32_t blockSize) {
+  for (uint32_t i = 0; i < blockSize; i++) {
+    pDst[i] = pSrc[i] * scale;
+  }
+}
+
+void arm_cmplx_mult_cmplx_f32(
+    const float32_t *pSrcA,
+    const float32_t *pSrcB,
+    float32_t *pDst,
+    uint32_t numSamples) {
+  for (uint32_t i = 0; i < numSamples; i++) {
+    float32_t a_real = pSrcA[2 * i + 0];
+    float32_t a_imag = pSrcA[2 * i + 1];
+    float32_t b_real = pSrcB[2 * i + 0];
+    float32_t b_imag = pSrcB[2 * i + 1];
+    pDst[2 * i + 0] = a_real * b_real - a_imag * b_imag;
+    pDst[2 * i + 1] = a_real * b_imag + a_imag * b_real;
+  }
+}
+
+void arm_cmplx_mag_squared_f32(
+    const float32_t *pSrc,
+    float32_t *pDst,
+    uint32_t numSamples) {
+  for (uint32_t i = 0; i < numSamples; i++) {
+    float32_t real = pSrc[2 * i + 0];
+    float32_t imag = pSrc[2 * i + 1];
+    pDst[i] = real * real + imag * imag;
+  }
+}
+
+arm_status arm_fir_decimate_init_f32(
+    arm_fir_decimate_instance_f32 *S,
+    uint16_t numTaps,
+    uint8_t M,
+    const float32_t *pCoeffs,
+    float32_t *pState,
+    uint32_t blockSize) {
+  if (M == 0 || blockSize % M != 0) {
+    return ARM_MATH_LENGTH_ERROR;
+  }
+  S->M = M;
+  S->numTaps = numTaps;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+  for (uint32_t i = 0; i < numTaps + blockSize - 1u; i++) {
+    pState[i] = 0;
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+// State holds the last numTaps - 1 inputs, followed by the new block.
+void arm_fir_decimate_f32(
+    const arm_fir_decimate_instance_f32 *S,
+    const float32_t *pSrc,
+    float32_t *pDst,
+    uint32_t blockSize) {
+  const uint32_t num_taps = S->numTaps;
+  float32_t *state = S->pState;
+  for (uint32_t i = 0; i < blockSize; i++) {
+    state[num_taps - 1 + i] = pSrc[i];
+  }
+  for (uint32_t i = 0; i < blockSize / S->M; i++) {
+    const float32_t *x = &state[i * S->M];
+    float32_t acc = 0;
+    for (uint32_t k = 0; k < num_taps; k++) {
+      acc += x[k] * S->pCoeffs[k];
+    }
+    pDst[i] = acc;
+  }
+  for (uint32_t i = 0; i < num_taps - 1; i++) {
+    state[i] = state[blockSize + i];
+  }
+}
+
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len16 = {16, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len32 = {32, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len64 = {64, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len128 = {128, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len256 = {256, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len512 = {512, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len1024 = {
+    1024, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len2048 = {
+    2048, nullptr, nullptr, 0};
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len4096 = {
+    4096, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len16 = {16, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len32 = {32, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len64 = {64, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len128 = {128, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len256 = {256, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len512 = {512, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len1024 = {
+    1024, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len2048 = {
+    2048, nullptr, nullptr, 0};
+const arm_cfft_instance_q15 arm_cfft_sR_q15_len4096 = {
+    4096, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len16 = {16, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len32 = {32, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len64 = {64, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len128 = {128, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len256 = {256, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len512 = {512, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len1024 = {
+    1024, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len2048 = {
+    2048, nullptr, nullptr, 0};
+const arm_cfft_instance_q31 arm_cfft_sR_q31_len4096 = {
+    4096, nullptr, nullptr, 0};
@@ -0,0 +1,1162 @@
+// Host benchmark driver.
+//
+// Runs the real processing and rendering pipeline on synthetic or recorded
+// IQ data, as fast as the host allows, and reports throughput per stage.
+//
+// Usage: program [-n frames] [-f file] [-s size] [-o overlap] [-a frames]
+//                [-z factor] [-x offset] [-w window] [-e engine]
+//                [-i input] [-r min,max] [-t traces] [-j hops]
+//                [-k catch-up] [-m consumers] [-d mode:offset]
+//                [-W file] [-R file] [-b scroll] [-v] [-c] [-l]
+//                [-q] [-P] [-D] [-H]
+//
+// Input files contain raw interleaved little-endian int16 I/Q samples, as
+// written to the recorder's ring by the audio DMA. Demodulated audio is
+// written and compared as 16 bit mono WAV files.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <mbed.h>
+
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_audio.h"
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_lcd.h"
+
+#include "application.h"
+#include "debug/class.h"
+#include "debug/counter.h"
+#include "debug/funcs.h"
+#include "debug/histogram.h"
+#include "debug/macros.h"
+#include "debug/profile.h"
+#include "hw/perf_timer.h"
+#include "hw/volatile_buffer.h"
+#include "math/demodulator.h"
+#include "math/window.h"
+#include "tests/test_demod.h"
+#include "tests/test_dma_options.h"
+#include "tests/test_histogram.h"
+#include "tests/test_log2.h"
+#include "tests/test_polyphase.h"
+
+// Constants
+static const uint32_t fb_size = sizeof(uint32_t) * 272 * 480;
+static const unsigned int synthetic_num_samples = 65536;
+static const double sample_rate = 48000;
+
+// Max difference from a reference WAV (-R), in LSB, for float rounding
+// differences between hosts and compilers
+static const int max_reference_diff = 2;
+
+// References for use by interrupt handlers.
+static app::Application *volatile global_app = nullptr;
+
+// Memory normally provided by SDRAM and SRAM.
+alignas(64) static uint32_t fb_alloc[7 * fb_size / sizeof(uint32_t)];
+alignas(64) static app::structs::Complex<float32_t>
+    zoom_alloc[app::math::max_fft_len];
+alignas(64) static volatile app::structs::Complex<int16_t>
+    audio_buffer_alloc[app::hw::recorder_ring_samples];
+alignas(64) static volatile app::structs::Complex<int16_t>
+    audio_out_buffer_alloc[2 * app::hw::player_block_samples];
+
+static const uintptr_t fb_addr = (uintptr_t)fb_alloc;
+
+// Components, allocated as in main.cpp.
+static Serial serial(USBTX, USBRX);
+static app::debug::Debug dbg(serial);
+static app::debug::Counter ltdc_underrun_counter(dbg, "ltdc_underrun");
+static app::debug::Counter missed_audio_counter(dbg, "missed_audio");
+static app::debug::Counter late_audio_read_counter(dbg, "late_audio_read");
+static app::hw::PerfTimer perf_timer;
+static app::debug::Profile profile(dbg, perf_timer);
+static app::hw::DmaManager dma_manager(dbg, perf_timer);
+// The waterfall copy is waited for before each flip, clears are not. Both
+// without bursts until test_dma_throughput shows them to pay off.
+static const app::hw::DmaOptions copy_dma_options = {
+    app::hw::DmaPriority::High,
+    app::hw::DmaBurst::Single,
+    app::hw::DmaFifoThreshold::Full,
+};
+static app::hw::CopyDMA copy_dma(dma_manager, copy_dma_options);
+static app::hw::ZeroDMA zero_dma(dma_manager, app::hw::dma_default_options);
+static app::hw::VolatileBuffer<uint8_t> buf0(
+    dbg, zero_dma, fb_addr + 0 * fb_size, fb_size);
+static app::hw::VolatileBuffer<uint8_t> buf1(
+    dbg, zero_dma, fb_addr + 1 * fb_size, fb_size);
+static app::hw::VolatileBuffer<uint8_t> buf2(
+    dbg, zero_dma, fb_addr + 2 * fb_size, fb_size);
+static app::hw::VolatileBuffer<uint32_t> buf3(
+    dbg, zero_dma, fb_addr + 3 * fb_size, fb_size);
+static app::hw::VolatileBuffer<uint32_t> buf4(
+    dbg, zero_dma, fb_addr + 4 * fb_size, fb_size);
+static app::hw::VolatileBuffer<uint32_t> buf5(
+    dbg, zero_dma, fb_addr + 5 * fb_size, fb_size);
+static app::hw::VolatileBuffer<uint8_t> wf_buf(
+    dbg, zero_dma, fb_addr + 6 * fb_size, fb_size);
+static app::hw::VolatileBuffer<app::structs::Complex<float32_t>> zoom_buf(
+    dbg, zero_dma, (uintptr_t)&zoom_alloc, sizeof(zoom_alloc));
+static app::hw::VolatileBuffer<app::structs::Complex<int16_t>> audio_buf(
+    dbg, zero_dma, (uintptr_t)&audio_buffer_alloc, sizeof(audio_buffer_alloc));
+static app::hw::VolatileBuffer<app::structs::Complex<int16_t>> audio_out_buf(
+    dbg,
+    zero_dma,
+    (uintptr_t)&audio_out_buffer_alloc,
+    sizeof(audio_out_buffer_alloc));
+static app::hw::VolatileTripleBuffer<uint8_t> layer0(dbg, buf0, buf1, buf2);
+static app::hw::VolatileTripleBuffer<uint32_t> layer1(dbg, buf3, buf4, buf5);
+static app::ui::Waterfall waterfall(wf_buf, copy_dma, 480, 272);
+static app::hw::Display display(
+    dbg, layer0, layer1, copy_dma, ltdc_underrun_counter);
+static app::hw::Recorder recorder(
+    dbg, audio_buf, missed_audio_counter, late_audio_read_counter);
+static app::hw::Player player(dbg, audio_out_buf);
+static app::ui::Canvas canvas(480, 272);
+static app::Application application(
+    dbg,
+    profile,
+    display,
+    canvas,
+    recorder,
+    player,
+    waterfall,
+    zoom_buf,
+    dma_manager);
+
+// Synthetic input: a few carriers of different strength plus noise.
+static std::vector<uint16_t> GenerateInput() {
+  struct Tone {
+    double freq;
+    double amplitude;
+  };
+  const Tone tones[] = {
+      {8000, 8000}, {-3000, 1000}, {12500, 100}, {-15000, 20}};
+  const double noise_amplitude = 8;
+
+  std::vector<uint16_t> data(2 * synthetic_num_samples);
+  uint32_t seed = 1;
+  for (size_t n = 0; n < data.size() / 2; n++) {
+    double re = 0, im = 0;
+    for (const Tone &tone : tones) {
+      double phase = 2 * M_PI * tone.freq * n / sample_rate;
+      re += tone.amplitude * cos(phase);
+      im += tone.amplitude * sin(phase);
+    }
+    seed = seed * 1664525 + 1013904223;
+    re += noise_amplitude * ((int32_t)(seed >> 16) - 32768) / 32768.0;
+    seed = seed * 1664525 + 1013904223;
+    im += noise_amplitude * ((int32_t)(seed >> 16) - 32768) / 32768.0;
+    data[2 * n + 0] = (uint16_t)(int16_t)lrint(re);
+    data[2 * n + 1] = (uint16_t)(int16_t)lrint(im);
+  }
+  return data;
+}
+
+// File input, truncated to whole samples.
+static std::vector<uint16_t> ReadInput(const char *path) {
+  std::vector<uint16_t> data;
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return data;
+  }
+  uint16_t sample[2];
+  while (fread(sample, sizeof(sample), 1, f) == 1) {
+    data.insert(data.end(), sample, sample + 2);
+  }
+  fclose(f);
+  return data;
+}
+
+// Feeds the next samples of the (looped) input to the audio DMA stand-in.
+static size_t input_pos = 0;
+
+static void Feed(const std::vector<uint16_t> &input, size_t num_samples) {
+  size_t remaining = 2 * num_samples;
+  while (remaining > 0) {
+    size_t n = input.size() - input_pos;
+    n = n < remaining ? n : remaining;
+    BSP_AUDIO_IN_HostFeed(&input[input_pos], n);
+    input_pos = (input_pos + n) % input.size();
+    remaining -= n;
+  }
+}
+
+// Audio played (the left channel), with -d.
+static bool demod_enabled = false;
+static std::vector<int16_t> played;
+
+static void Drain(size_t num_samples) {
+  int16_t frames[2 * app::hw::player_block_samples];
+  while (num_samples > 0) {
+    size_t n = app::hw::player_block_samples;
+    n = n < num_samples ? n : num_samples;
+    BSP_AUDIO_OUT_HostDrain(frames, 2 * n);
+    for (size_t i = 0; i < n; i++) {
+      played.push_back(frames[2 * i]);
+    }
+    num_samples -= n;
+  }
+}
+
+// 16 bit mono PCM at the sample rate, little-endian hosts only.
+static bool WriteWav(const char *path, const std::vector<int16_t> &samples) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    return false;
+  }
+  const uint32_t data_size = samples.size() * sizeof(int16_t);
+  const uint32_t riff_size = 36 + data_size;
+  const uint32_t fmt_size = 16;
+  const uint16_t format = 1;  // PCM
+  const uint16_t channels = 1;
+  const uint32_t rate = sample_rate;
+  const uint32_t byte_rate = rate * sizeof(int16_t);
+  const uint16_t block_align = sizeof(int16_t);
+  const uint16_t bits = 16;
+  bool ok = fwrite("RIFF", 4, 1, f) == 1 &&
+            fwrite(&riff_size, 4, 1, f) == 1 &&
+            fwrite("WAVEfmt ", 8, 1, f) == 1 &&
+            fwrite(&fmt_size, 4, 1, f) == 1 && fwrite(&format, 2, 1, f) == 1 &&
+            fwrite(&channels, 2, 1, f) == 1 && fwrite(&rate, 4, 1, f) == 1 &&
+            fwrite(&byte_rate, 4, 1, f) == 1 &&
+            fwrite(&block_align, 2, 1, f) == 1 &&
+            fwrite(&bits, 2, 1, f) == 1 && fwrite("data", 4, 1, f) == 1 &&
+            fwrite(&data_size, 4, 1, f) == 1 &&
+            fwrite(samples.data(), data_size, 1, f) == 1;
+  return 0 == fclose(f) && ok;
+}
+
+// Reads what WriteWav() writes, skipping chunks other than the data.
+static bool ReadWav(const char *path, std::vector<int16_t> *samples) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+  char id[4];
+  uint32_t size;
+  bool ok = fread(id, 4, 1, f) == 1 && 0 == memcmp(id, "RIFF", 4) &&
+            fread(&size, 4, 1, f) == 1 && fread(id, 4, 1, f) == 1 &&
+            0 == memcmp(id, "WAVE", 4);
+  bool found = false;
+  while (ok && !found && fread(id, 4, 1, f) == 1 &&
+         fread(&size, 4, 1, f) == 1) {
+    if (0 == memcmp(id, "fmt ", 4)) {
+      uint16_t fmt[8];
+      ok = size >= sizeof(fmt) && fread(fmt, sizeof(fmt), 1, f) == 1 &&
+           fmt[0] == 1 && fmt[1] == 1 && fmt[7] == 16 &&
+           0 == fseek(f, size - sizeof(fmt), SEEK_CUR);
+    } else if (0 == memcmp(id, "data", 4)) {
+      samples->resize(size / sizeof(int16_t));
+      ok = fread(samples->data(), sizeof(int16_t), samples->size(), f) ==
+           samples->size();
+      found = true;
+    } else {
+      ok = 0 == fseek(f, size + size % 2, SEEK_CUR);
+    }
+  }
+  fclose(f);
+  return ok && found;
+}
+
+// Mode and offset in Hz, e.g. "usb:8000", or just the mode for 0 Hz.
+static bool ParseDemod(
+    const char *arg, app::math::DemodMode *mode, int32_t *offset_hz) {
+  const app::math::DemodMode modes[] = {
+      app::math::DemodMode::Off,
+      app::math::DemodMode::USB,
+      app::math::DemodMode::LSB,
+      app::math::DemodMode::AM,
+      app::math::DemodMode::CW,
+  };
+  const char *colon = strchr(arg, ':');
+  const size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+  *offset_hz = colon ? strtol(colon + 1, nullptr, 0) : 0;
+  for (app::math::DemodMode m : modes) {
+    const char *name = app::math::demod_mode_name(m);
+    if (len == strlen(name) && 0 == strncmp(arg, name, len)) {
+      *mode = m;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseWindow(const char *name, app::math::Window *window) {
+  const app::math::Window windows[] = {
+      app::math::Window::Rectangular,
+      app::math::Window::Hann,
+      app::math::Window::BlackmanHarris,
+      app::math::Window::FlatTop,
+  };
+  for (app::math::Window w : windows) {
+    if (0 == strcmp(name, app::math::window_name(w))) {
+      *window = w;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseEngine(const char *name, app::FftEngine *engine) {
+  const app::FftEngine engines[] = {
+      app::FftEngine::Float32,
+      app::FftEngine::Q15,
+      app::FftEngine::Q31,
+      app::FftEngine::Polyphase,
+  };
+  for (app::FftEngine e : engines) {
+    if (0 == strcmp(name, app::fft_engine_name(e))) {
+      *engine = e;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseInput(const char *name, app::hw::RecorderInput *input) {
+  const app::hw::RecorderInput inputs[] = {
+      app::hw::RecorderInput::IQ,
+      app::hw::RecorderInput::Left,
+      app::hw::RecorderInput::Right,
+  };
+  for (app::hw::RecorderInput i : inputs) {
+    if (0 == strcmp(name, app::hw::recorder_input_name(i))) {
+      *input = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseScroll(const char *name, app::WaterfallScroll *scroll) {
+  const app::WaterfallScroll scrolls[] = {
+      app::WaterfallScroll::Copy,
+      app::WaterfallScroll::Hardware,
+  };
+  for (app::WaterfallScroll c : scrolls) {
+    if (0 == strcmp(name, app::waterfall_scroll_name(c))) {
+      *scroll = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseCatchUp(const char *name, app::CatchUp *catch_up) {
+  const app::CatchUp catch_ups[] = {
+      app::CatchUp::All,
+      app::CatchUp::Newest,
+      app::CatchUp::Batch,
+  };
+  for (app::CatchUp c : catch_ups) {
+    if (0 == strcmp(name, app::catch_up_name(c))) {
+      *catch_up = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Traces as letters: p(eak), m(in), a(verage).
+static bool ParseTraces(const char *letters, unsigned int *traces) {
+  *traces = 0;
+  for (const char *c = letters; *c; c++) {
+    switch (*c) {
+      case 'p':
+        *traces |= app::TracePeak;
+        break;
+      case 'm':
+        *traces |= app::TraceMin;
+        break;
+      case 'a':
+        *traces |= app::TraceAverage;
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+static void Usage(const char *program) {
+  fprintf(
+      stderr,
+      "Usage: %s [-n frames] [-f file] [-s size] [-o overlap] [-a frames] "
+      "[-z factor] [-x offset] [-w window] [-e engine] [-i input] "
+      "[-r min,max] [-t traces] [-j hops] [-k catch-up] [-m consumers] "
+      "[-d mode:offset] [-W file] [-R file] [-b scroll] [-v] [-c] [-l] [-q] "
+      "[-P] [-D] [-H]\n"
+      "  -s: FFT size, 256 to 4096\n"
+      "  -o: frames per FFT size, 1, 2, 4 or 8 (not with -c)\n"
+      "  -a: frames averaged per row, 1 to 64 (not with -c)\n"
+      "  -z: zoom factor, 1 to 64 (not with -c)\n"
+      "  -x: zoom centre offset in Hz\n"
+      "  -w: rect, hann, blackman-harris, flattop\n"
+      "  -e: f32, q15, q31, pfb (polyphase filter bank, not with -c)\n"
+      "  -i: iq, left or right (a real input, not with -c)\n"
+      "  -r: fixed color range in log2 power, default automatic\n"
+      "  -t: traces, any of p (peak), m (min), a (average)\n"
+      "  -j: stall processing for up to this many hops at random\n"
+      "  -k: all, newest or batch, what to do with hops stalled\n"
+      "  -m: extra block consumers, 0 to 3, draining every 1, 2, 4 hops\n"
+      "  -b: copy or hardware, how the waterfall is scrolled\n"
+      "  -v: verify the waterfall lines as the LTDC fetches them\n"
+      "  -d: demodulate usb, lsb, am or cw at an offset in Hz\n"
+      "  -W: write the demodulated audio to a WAV file\n"
+      "  -R: compare the demodulated audio against a WAV file\n"
+      "  -c: compare fixed point engines against f32 instead of timing\n"
+      "  -l: run the log2 accuracy and speed harness instead\n"
+      "  -q: run the demodulator tests instead\n"
+      "  -P: run the polyphase filter bank tests instead\n"
+      "  -D: run the DMA options tests instead\n"
+      "  -H: run the histogram tests instead\n",
+      program);
+}
+
+// Extra block consumers (e.g. a demodulator or an I/Q recorder) for -m.
+// Consumer i drains its blocks every 2^i hops, so they lag differently, and
+// checks them against the input.
+struct BenchConsumer {
+  int id;
+  unsigned long mismatches;
+  unsigned long shared;  // Blocks another consumer got for the same seq
+};
+
+static const unsigned int bench_max_consumers =
+    app::hw::recorder_max_consumers - 1;  // One is the demodulator's
+static BenchConsumer bench_consumers[bench_max_consumers];
+static unsigned int num_bench_consumers = 0;
+
+// Block last acquired per seq (modulo), to count shared blocks
+static const app::hw::RecorderBlock *seen_blocks[64];
+static uint32_t seen_seqs[64];
+
+static void DrainConsumer(
+    const std::vector<uint16_t> &input, BenchConsumer *consumer) {
+  const size_t input_samples = input.size() / 2;
+  const app::hw::RecorderBlock *block;
+  while ((block = recorder.AcquireBlock(consumer->id))) {
+    const unsigned int slot = block->seq % 64;
+    if (seen_blocks[slot] == block && seen_seqs[slot] == block->seq) {
+      consumer->shared++;
+    }
+    seen_blocks[slot] = block;
+    seen_seqs[slot] = block->seq;
+
+    // Recording started at input sample 0
+    const size_t first = (size_t)block->seq * app::hw::recorder_block_samples;
+    for (int i = 0; i < app::hw::recorder_block_samples; i++) {
+      const size_t n = (first + i) % input_samples;
+      if (block->samples[i].real != (int16_t)input[2 * n] ||
+          block->samples[i].imag != (int16_t)input[2 * n + 1]) {
+        consumer->mismatches++;
+        break;
+      }
+    }
+    recorder.ReleaseBlock(block);
+  }
+}
+
+// The display in audio time: the LTDC fetches the lines of each frame
+// evenly over the refresh, then reloads its registers in the vertical
+// blanking. With -v, each line of the waterfall is checked as it is fetched
+// against the rows as of the Render() shown, so that rows added over lines
+// still to be scanned out show up as mismatches.
+static const unsigned int ltdc_refresh_hz = 60;
+static const unsigned int ltdc_frame_samples = sample_rate / ltdc_refresh_hz;
+
+static bool verify_view = false;
+static unsigned long views_verified = 0;
+static unsigned long view_mismatches = 0;  // Lines
+static unsigned int scan_samples = 0;      // Into the current frame
+static unsigned int scan_line = 0;         // Next line fetched
+static std::vector<uint8_t> rendered_rows;  // As of the last Render()
+static std::vector<uint8_t> shown_rows;     // As of the Render() shown
+
+// After each Render(), with -v
+static void SnapshotRows() {
+  rendered_rows.resize(272 * 480);
+  for (unsigned int y = 0; y < 272; y++) {
+    memcpy(&rendered_rows[y * 480], (const void *)waterfall.GetRow(y), 480);
+  }
+}
+
+static void VerifyLine(unsigned int y) {
+  const void *shown = HostLtdcGetLine(&hLtdcHandler, 0, y);
+  if (!shown || 0 != memcmp(shown, &shown_rows[y * 480], 480)) {
+    view_mismatches++;
+  }
+}
+
+// Scans out the display for num_samples of audio time. Returns the cycles
+// spent verifying, which aren't part of the timings.
+static uint32_t ScanOut(unsigned int num_samples) {
+  uint32_t verify_cycles = 0;
+  while (num_samples > 0) {
+    const unsigned int n =
+        std::min(num_samples, ltdc_frame_samples - scan_samples);
+    scan_samples += n;
+    num_samples -= n;
+
+    const unsigned int end_line = scan_samples * 272 / ltdc_frame_samples;
+    if (verify_view && !shown_rows.empty()) {
+      const uint32_t start = profile.Now();
+      for (unsigned int y = scan_line; y < end_line; y++) {
+        VerifyLine(y);
+      }
+      verify_cycles += profile.Now() - start;
+    }
+    scan_line = end_line;
+    if (scan_samples < ltdc_frame_samples) {
+      break;
+    }
+
+    if (verify_view) {
+      views_verified += shown_rows.empty() ? 0 : 1;
+      if (hLtdcHandler.Instance->reload_pending) {
+        shown_rows = rendered_rows;
+      }
+    }
+    HostLtdcVerticalBlank(&hLtdcHandler);
+    scan_samples = 0;
+    scan_line = 0;
+  }
+  return verify_cycles;
+}
+
+// Runs the whole pipeline and reports timings.
+//
+// With max_stall, processing pauses for a random 0 to max_stall hops after
+// each catch-up while audio keeps arriving, as if preempted, and then catches
+// up as the audio thread does.
+static void RunThroughput(
+    const std::vector<uint16_t> &input,
+    unsigned long num_frames,
+    unsigned int max_stall) {
+  const unsigned int stage_feed = profile.Add("feed");
+  const unsigned int stage_vblank = profile.Add("vblank");
+
+  const unsigned int hop_size = recorder.GetHopSamples();
+
+  uint32_t seed = 1;
+  unsigned int stall = 0;
+
+  dma_manager.ResetStats();
+  uint32_t start = profile.Now();
+  uint64_t elapsed = 0;
+  for (unsigned long frame = 0; frame < num_frames; frame++) {
+    uint32_t t = profile.Now();
+    Feed(input, hop_size);
+    t = profile.Lap(stage_feed, t);
+
+    for (unsigned int i = 0; i < num_bench_consumers; i++) {
+      if (frame % (1 << i) == 0) {
+        DrainConsumer(input, &bench_consumers[i]);
+      }
+    }
+
+    // Runs in its own thread, regardless of stalls of the audio thread
+    if (demod_enabled) {
+      application.ProcessDemod();
+      Drain(hop_size);
+    }
+
+    if (stall > 0) {
+      stall--;
+    } else {
+      do {
+        application.ProcessAudio();
+      } while (recorder.HasPending());
+      application.Render();
+      if (verify_view) {
+        t = profile.Now();
+        SnapshotRows();
+        start += profile.Now() - t;  // Not timed
+      }
+
+      if (max_stall > 0) {
+        seed = seed * 1664525 + 1013904223;
+        stall = (seed >> 16) % (max_stall + 1);
+      }
+    }
+
+    // The display scans out while the next hop is recorded
+    t = profile.Now();
+    const uint32_t verify_cycles = ScanOut(hop_size);
+    t = profile.Lap(stage_vblank, t + verify_cycles);
+
+    // Accumulate in 64 bit, the 32 bit ns counter wraps after ~4 s.
+    elapsed += (uint32_t)(t - start - verify_cycles);
+    start = t;
+  }
+
+  double seconds = elapsed / 1e9;
+  double fps = num_frames / seconds;
+  double realtime_fps = sample_rate / hop_size;
+  double budget_ns = 1e9 / realtime_fps;
+  app::debug::Profile::Stage process = {};
+  for (unsigned int i = 0; i < profile.NumStages(); i++) {
+    if (0 == strcmp(profile.GetStage(i).name, "process")) {
+      process = profile.GetStage(i);
+    }
+  }
+  double process_ns =
+      process.count ? (double)process.total_cycles / process.count : 0;
+  printf("frames:        %lu\n", num_frames);
+  printf("elapsed:       %.3f s\n", seconds);
+  printf("frames/s:      %.1f (%.1fx real time)\n", fps, fps / realtime_fps);
+  printf(
+      "hop budget:    %.0f ns, process uses %.2f%% avg, %.2f%% max\n",
+      budget_ns,
+      100 * process_ns / budget_ns,
+      100 * process.max_cycles / budget_ns);
+  printf("missed_audio:  %" PRIu32 "\n", missed_audio_counter.GetValue());
+  printf("late_audio:    %" PRIu32 "\n", late_audio_read_counter.GetValue());
+
+  // Every segment recorded is read, dropped, skipped or still pending
+  const uint32_t recorded = recorder.GetSegmentsRecorded();
+  const uint32_t read = recorder.GetSegmentsRead();
+  const uint32_t dropped = recorder.GetSegmentsDropped();
+  const uint32_t skipped = recorder.GetSegmentsSkipped();
+  const uint32_t pending = recorded - read - dropped - skipped;
+  printf(
+      "segments:      %" PRIu32 " recorded, %" PRIu32 " read, %" PRIu32
+      " dropped in %" PRIu32 " gaps, %" PRIu32 " skipped, %" PRIu32
+      " pending (ring of %d)\n",
+      recorded,
+      read,
+      dropped,
+      recorder.GetGaps(),
+      skipped,
+      pending,
+      recorder.GetNumSegments());
+  printf(
+      "catch-up:      %s, %" PRIu32 " frames batched, %" PRIu32
+      " gap rows\n",
+      app::catch_up_name(application.GetCatchUp()),
+      application.GetBatchedFrames(),
+      application.GetGapRows());
+  printf(
+      "waterfall:     %s scroll, %" PRIu32 " frames held",
+      app::waterfall_scroll_name(application.GetWaterfallScroll()),
+      application.GetHeldFrames());
+  if (verify_view) {
+    printf(
+        ", %lu views verified, %lu lines mismatched",
+        views_verified,
+        view_mismatches);
+  }
+  printf("\n");
+
+  // The host carries transfers out right away, so busy is the CPU's time
+  for (int i = 0; i < app::hw::dma_num_streams; i++) {
+    const app::hw::DmaStreamStats stats = dma_manager.GetStats(i);
+    printf(
+        "dma stream %d:  %" PRIu32
+        " transfers, %.1f MB, busy %.2f%%, up to %" PRIu32 " queued\n",
+        i,
+        stats.transfers,
+        stats.words * sizeof(uint32_t) / 1e6,
+        100.0 * stats.busy_cycles / elapsed,
+        stats.max_queued);
+  }
+
+  if (demod_enabled) {
+    app::debug::Profile::Stage demod = {};
+    for (unsigned int i = 0; i < profile.NumStages(); i++) {
+      if (0 == strcmp(profile.GetStage(i).name, "demod")) {
+        demod = profile.GetStage(i);
+      }
+    }
+    const double block_budget_ns =
+        1e9 * app::math::demod_block_len / sample_rate;
+    const double demod_ns =
+        demod.count ? (double)demod.total_cycles / demod.count : 0;
+    printf(
+        "demod:         %s at %+" PRId32 " Hz, %" PRIu32
+        " blocks, uses %.2f%% avg, %.2f%% max of %.0f ns per block\n",
+        app::math::demod_mode_name(application.GetDemodMode()),
+        application.GetDemodOffset(),
+        demod.count,
+        100 * demod_ns / block_budget_ns,
+        100 * demod.max_cycles / block_budget_ns,
+        block_budget_ns);
+    printf(
+        "playback:      %zu samples, %" PRIu32 " underruns, %" PRIu32
+        " overruns\n",
+        played.size(),
+        player.GetUnderruns(),
+        player.GetOverruns());
+  }
+
+  for (unsigned int i = 0; i < num_bench_consumers; i++) {
+    const BenchConsumer &c = bench_consumers[i];
+    printf(
+        "consumer %u:    %" PRIu32 " blocks read, %" PRIu32 " dropped, %" PRIu32
+        " behind, %lu shared, %lu mismatched\n",
+        i,
+        recorder.GetConsumerRead(c.id),
+        recorder.GetConsumerDropped(c.id),
+        recorder.GetConsumerLag(c.id),
+        c.shared,
+        c.mismatches);
+  }
+
+  // Feeding doesn't wait for real time, so this is the pipeline's own share
+  // of the latency (plus stalls), from the ISR to the vertical blank
+  app::debug::Histogram &latency = application.GetLatencyHistogram();
+  const uint32_t rows_shown = latency.GetCount();
+  printf(
+      "latency:       %" PRIu32 " rows shown, avg %.1f us, 50%% < %.1f us, "
+      "99%% < %.1f us, max %.1f us\n",
+      rows_shown,
+      rows_shown ? latency.GetTotal() / 1e3 / rows_shown : 0,
+      latency.GetPercentile(0.5f) / 1e3,
+      latency.GetPercentile(0.99f) / 1e3,
+      latency.GetMax() / 1e3);
+  printf(
+      "color range:   %.2f to %.2f log2 (%s), noise floor %.2f log2\n",
+      application.GetColorMin(),
+      application.GetColorMax(),
+      application.GetAutoColorRange() ? "auto" : "fixed",
+      application.GetNoiseFloor());
+  printf("\n");
+  printf("%-16s %10s %12s %12s\n", "stage", "count", "avg ns", "max ns");
+  for (unsigned int i = 0; i < profile.NumStages(); i++) {
+    const app::debug::Profile::Stage &s = profile.GetStage(i);
+    double avg = s.count ? (double)s.total_cycles / s.count : 0;
+    printf(
+        "%-16s %10" PRIu32 " %12.1f %12" PRIu32 "\n",
+        s.name,
+        s.count,
+        avg,
+        s.max_cycles);
+  }
+}
+
+// Feeds each block through every engine and reports the column power error
+// of the fixed point engines relative to f32, in dB.
+static void RunCompare(
+    const std::vector<uint16_t> &input, unsigned long num_frames) {
+  const app::FftEngine engines[] = {app::FftEngine::Q15, app::FftEngine::Q31};
+  const unsigned int num_engines = sizeof(engines) / sizeof(engines[0]);
+  const double db_per_log2 = 10 * log10(2.0);
+  const double strong_range_db = 60;
+
+  struct Error {
+    double sum = 0;
+    double max = 0;
+    unsigned long count = 0;
+
+    void Add(double e) {
+      sum += e;
+      max = e > max ? e : max;
+      count++;
+    }
+  };
+  Error all[num_engines], strong[num_engines];
+
+  const unsigned int fft_size = application.GetFftSize();
+
+  float32_t reference[480];
+  for (unsigned long frame = 0; frame < num_frames; frame++) {
+    const size_t frame_pos = input_pos;
+
+    application.SetFftEngine(app::FftEngine::Float32);
+    Feed(input, fft_size);
+    application.ProcessAudio();
+    memcpy(reference, application.GetColumnPowers(), sizeof(reference));
+
+    float32_t peak = reference[0];
+    for (unsigned int i = 0; i < 480; i++) {
+      peak = reference[i] > peak ? reference[i] : peak;
+    }
+
+    for (unsigned int e = 0; e < num_engines; e++) {
+      application.SetFftEngine(engines[e]);
+      input_pos = frame_pos;
+      Feed(input, fft_size);
+      application.ProcessAudio();
+
+      const float32_t *powers = application.GetColumnPowers();
+      for (unsigned int i = 0; i < 480; i++) {
+        double error = fabs(powers[i] - reference[i]) * db_per_log2;
+        all[e].Add(error);
+        if ((peak - reference[i]) * db_per_log2 < strong_range_db) {
+          strong[e].Add(error);
+        }
+      }
+    }
+  }
+
+  printf("frames:        %lu\n", num_frames);
+  printf("\n");
+  printf(
+      "%-8s %14s %14s %14s %14s\n",
+      "engine",
+      "mean err dB",
+      "max err dB",
+      "mean err dB*",
+      "max err dB*");
+  for (unsigned int e = 0; e < num_engines; e++) {
+    printf(
+        "%-8s %14.3f %14.3f %14.3f %14.3f\n",
+        app::fft_engine_name(engines[e]),
+        all[e].count ? all[e].sum / all[e].count : 0,
+        all[e].max,
+        strong[e].count ? strong[e].sum / strong[e].count : 0,
+        strong[e].max);
+  }
+  printf("* columns within %.0f dB of the frame's peak\n", strong_range_db);
+}
+
+int main(int argc, char **argv) {
+  unsigned long num_frames = 10000;
+  const char *input_path = nullptr;
+  app::math::Window window = recorder.GetWindow();
+  app::FftEngine engine = application.GetFftEngine();
+  unsigned int fft_size = application.GetFftSize();
+  unsigned int overlap = application.GetOverlap();
+  unsigned int frames_per_row = application.GetFramesPerRow();
+  unsigned int zoom_factor = application.GetZoomFactor();
+  int32_t zoom_offset = application.GetZoomOffset();
+  app::hw::RecorderInput input_mode = app::hw::RecorderInput::IQ;
+  float32_t color_min = 0, color_max = 0;  // Automatic if equal
+  unsigned int traces = 0;
+  unsigned int max_stall = 0;
+  app::CatchUp catch_up = app::CatchUp::All;
+  app::WaterfallScroll scroll = application.GetWaterfallScroll();
+  app::math::DemodMode demod_mode = app::math::DemodMode::Off;
+  int32_t demod_offset = 0;
+  const char *wav_path = nullptr;
+  const char *reference_path = nullptr;
+  bool compare = false;
+  bool log2_harness = false;
+  bool demod_tests = false;
+  bool polyphase_tests = false;
+  bool dma_options_tests = false;
+  bool histogram_tests = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:f:s:o:a:z:x:w:e:i:r:t:j:k:m:d:W:R:b:vclqPDH")) != -1) {
+    switch (opt) {
+      case 'n':
+        num_frames = strtoul(optarg, nullptr, 0);
+        break;
+      case 'f':
+        input_path = optarg;
+        break;
+      case 's':
+        fft_size = strtoul(optarg, nullptr, 0);
+        break;
+      case 'o':
+        overlap = strtoul(optarg, nullptr, 0);
+        break;
+      case 'a':
+        frames_per_row = strtoul(optarg, nullptr, 0);
+        break;
+      case 'z':
+        zoom_factor = strtoul(optarg, nullptr, 0);
+        break;
+      case 'x':
+        zoom_offset = strtol(optarg, nullptr, 0);
+        break;
+      case 'w':
+        if (!ParseWindow(optarg, &window)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'e':
+        if (!ParseEngine(optarg, &engine)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'i':
+        if (!ParseInput(optarg, &input_mode)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'r':
+        if (2 != sscanf(optarg, "%f,%f", &color_min, &color_max) ||
+            !(color_max > color_min)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 't':
+        if (!ParseTraces(optarg, &traces)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'j':
+        max_stall = strtoul(optarg, nullptr, 0);
+        break;
+      case 'k':
+        if (!ParseCatchUp(optarg, &catch_up)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'b':
+        if (!ParseScroll(optarg, &scroll)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'v':
+        verify_view = true;
+        break;
+      case 'm':
+        num_bench_consumers = strtoul(optarg, nullptr, 0);
+        if (num_bench_consumers > bench_max_consumers) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'd':
+        if (!ParseDemod(optarg, &demod_mode, &demod_offset)) {
+          Usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'W':
+        wav_path = optarg;
+        break;
+      case 'R':
+        reference_path = optarg;
+        break;
+      case 'c':
+        compare = true;
+        break;
+      case 'l':
+        log2_harness = true;
+        break;
+      case 'q':
+        demod_tests = true;
+        break;
+      case 'P':
+        polyphase_tests = true;
+        break;
+      case 'D':
+        dma_options_tests = true;
+        break;
+      case 'H':
+        histogram_tests = true;
+        break;
+      default:
+        Usage(argv[0]);
+        return 2;
+    }
+  }
+
+  app::debug::init(dbg);
+
+  if (log2_harness) {
+    test_log2(dbg);
+    return 0;
+  }
+  if (demod_tests) {
+    test_demod(dbg);
+    return 0;
+  }
+  if (dma_options_tests) {
+    test_dma_options(dbg);
+    return 0;
+  }
+  if (histogram_tests) {
+    test_histogram(dbg);
+    return 0;
+  }
+
+  std::vector<uint16_t> input =
+      input_path ? ReadInput(input_path) : GenerateInput();
+  if (input.empty()) {
+    fprintf(stderr, "No input\n");
+    return 1;
+  }
+
+  crash_if(dbg, 0 != dma_manager.Init());
+  crash_if(dbg, 0 != buf0.Init());
+  crash_if(dbg, 0 != buf1.Init());
+  crash_if(dbg, 0 != buf2.Init());
+  crash_if(dbg, 0 != buf3.Init());
+  crash_if(dbg, 0 != buf4.Init());
+  crash_if(dbg, 0 != buf5.Init());
+  crash_if(dbg, 0 != wf_buf.Init());
+  crash_if(dbg, 0 != zoom_buf.Init());
+  crash_if(dbg, 0 != waterfall.Init());
+  crash_if(dbg, 0 != audio_buf.Init());
+  crash_if(dbg, 0 != audio_out_buf.Init());
+  crash_if(dbg, 0 != layer0.Init());
+  crash_if(dbg, 0 != layer1.Init());
+  crash_if(dbg, 0 != display.Init());
+  crash_if(dbg, 0 != player.Init());
+  crash_if(dbg, 0 != recorder.Init());
+  crash_if(dbg, 0 != player.Start());
+  crash_if(dbg, 0 != application.Init());
+
+  // Comparing replays each hop per engine, which neither the history nor
+  // the row accumulation can take, and is only for the single frame I/Q
+  // engines
+  if (0 != application.SetFftSize(fft_size) ||
+      0 != application.SetOverlap(overlap) ||
+      0 != application.SetFramesPerRow(frames_per_row) ||
+      0 != application.SetZoom(zoom_factor, zoom_offset) ||
+      0 != application.SetDemod(demod_mode, demod_offset) ||
+      ((wav_path || reference_path) &&
+       demod_mode == app::math::DemodMode::Off) ||
+      (compare && (overlap != 1 || frames_per_row != 1 || zoom_factor != 1 ||
+                   input_mode != app::hw::RecorderInput::IQ ||
+                   engine == app::FftEngine::Polyphase))) {
+    Usage(argv[0]);
+    return 2;
+  }
+  recorder.SetWindow(window);
+  application.SetInput(input_mode);
+  application.SetFftEngine(engine);
+  application.SetTraces(traces);
+  application.SetCatchUp(catch_up);
+  application.SetWaterfallScroll(scroll);
+  if (color_max > color_min) {
+    application.SetAutoColorRange(false);
+    application.SetColorRange(color_min, color_max);
+  }
+
+  global_app = &application;
+
+  // Through the whole pipeline's recorder, as the audio arrives
+  if (polyphase_tests) {
+    test_polyphase(dbg);
+    test_polyphase_recorder(dbg, recorder, BSP_AUDIO_IN_HostFeed);
+    return 0;
+  }
+
+  // Apply settings before any audio arrives
+  application.ProcessAudio();
+  application.ProcessDemod();
+  demod_enabled = demod_mode != app::math::DemodMode::Off;
+  for (unsigned int i = 0; i < num_bench_consumers; i++) {
+    crash_if(dbg, 0 != recorder.AddConsumer(&bench_consumers[i].id));
+  }
+
+  printf("fft size:      %u\n", application.GetFftSize());
+  printf("overlap:       %u\n", application.GetOverlap());
+  printf("frames/row:    %u\n", application.GetFramesPerRow());
+  printf(
+      "zoom:          x%u at %+" PRId32 " Hz\n",
+      application.GetZoomFactor(),
+      application.GetZoomOffset());
+  printf(
+      "input:         %s\n",
+      app::hw::recorder_input_name(application.GetInput()));
+  printf("window:        %s\n", app::math::window_name(window));
+  if (compare) {
+    RunCompare(input, num_frames);
+  } else {
+    printf(
+        "engine:        %s, %d tap(s)\n",
+        app::fft_engine_name(engine),
+        recorder.GetTaps());
+    RunThroughput(input, num_frames, max_stall);
+    if (view_mismatches > 0) {
+      return 1;
+    }
+  }
+
+  if (wav_path && !WriteWav(wav_path, played)) {
+    fprintf(stderr, "Can't write %s\n", wav_path);
+    return 1;
+  }
+  if (reference_path) {
+    std::vector<int16_t> reference;
+    if (!ReadWav(reference_path, &reference)) {
+      fprintf(stderr, "Can't read %s\n", reference_path);
+      return 1;
+    }
+    int max_diff = 0;
+    const size_t n =
+        played.size() < reference.size() ? played.size() : reference.size();
+    for (size_t i = 0; i < n; i++) {
+      const int diff = abs(played[i] - reference[i]);
+      max_diff = diff > max_diff ? diff : max_diff;
+    }
+    const bool match =
+        played.size() == reference.size() && max_diff <= max_reference_diff;
+    printf(
+        "reference:     %zu of %zu samples, max diff %d, %s\n",
+        n,
+        reference.size(),
+        max_diff,
+        match ? "match" : "MISMATCH");
+    if (!match) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+extern "C" void LTDC_IRQHandler(void) {
+  if (global_app) {
+    global_app->HandleLtdcIRQ();
+  }
+}
+
+void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef *) {
+  if (global_app) {
+    global_app->HandleLtdcReload();
+  }
+}
+
+void HAL_LTDC_ErrorCallback(LTDC_HandleTypeDef *hltdc) {
+  if (HAL_LTDC_GetError(hltdc) & HAL_LTDC_ERROR_FU) {
+    hltdc->ErrorCode &= ~HAL_LTDC_ERROR_FU;
+    if (global_app) {
+      global_app->HandleLtdcUnderrun();
+    }
+  }
+}
+
+void BSP_AUDIO_IN_Error_Callback(void) {
+  if (global_app) {
+    global_app->HandleAudioInError();
+  }
+}
+
+void BSP_AUDIO_IN_HalfTransfer_CallBack(void) {
+  if (global_app) {
+    global_app->HandleAudioInHalfTransferComplete();
+  }
+}
+
+void BSP_AUDIO_IN_TransferComplete_CallBack(void) {
+  if (global_app) {
+    global_app->HandleAudioInTransferComplete();
+  }
+}
+
+void BSP_AUDIO_OUT_HalfTransfer_CallBack(void) {
+  if (global_app) {
+    global_app->HandleAudioOutHalfTransferComplete();
+  }
+}
+
+void BSP_AUDIO_OUT_TransferComplete_CallBack(void) {
+  if (global_app) {
+    global_app->HandleAudioOutTransferComplete();
+  }
+}
+
+extern "C" void EXTI15_10_IRQHandler(void) {
+}
@@ -0,0 +1,165 @@
+#include <stdint.h>
+
+#include <mbed.h>
+
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_audio.h"
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_lcd.h"
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_sdram.h"
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_ts.h"
+
+// LCD
+
+uint8_t BSP_LCD_Init(void) {
+  return LCD_OK;
+}
+
+uint32_t BSP_LCD_GetXSize(void) {
+  return 480;
+}
+
+uint32_t BSP_LCD_GetYSize(void) {
+  return 272;
+}
+
+void BSP_LCD_DisplayOn(void) {
+}
+
+void BSP_LCD_DisplayOff(void) {
+}
+
+// Touchscreen
+
+uint8_t BSP_TS_Init(uint16_t, uint16_t) {
+  return TS_OK;
+}
+
+uint8_t BSP_TS_ITConfig(void) {
+  return TS_OK;
+}
+
+// SDRAM
+
+uint8_t BSP_SDRAM_Init(void) {
+  return SDRAM_OK;
+}
+
+// Audio in
+
+// As the real driver's, for applications that run the DMA stream
+// themselves.
+static SAI_Block_TypeDef sai2_block_b;
+static DMA_HandleTypeDef hdma_sai_rx;
+SAI_HandleTypeDef haudio_in_sai;
+
+// The codec is shared, and stopping the input mutes the output
+static bool play_muted = true;
+
+// The SAI and its DMA stream (DMA2 Stream7, as on the board) are ready,
+// but not running.
+uint8_t BSP_AUDIO_IN_InitEx(uint16_t, uint32_t, uint32_t, uint32_t) {
+  hdma_sai_rx.Instance = DMA2_Stream7;
+  hdma_sai_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_sai_rx.State = HAL_DMA_STATE_READY;
+  haudio_in_sai.Instance = &sai2_block_b;
+  haudio_in_sai.hdmarx = &hdma_sai_rx;
+  haudio_in_sai.State = HAL_SAI_STATE_READY;
+  return AUDIO_OK;
+}
+
+// As HAL_SAI_DMAStop(): the stream is aborted, and may be started again
+uint8_t BSP_AUDIO_IN_Stop(uint32_t) {
+  play_muted = true;
+  haudio_in_sai.Instance->CR1 &= ~(SAI_xCR1_DMAEN | SAI_xCR1_SAIEN);
+  haudio_in_sai.hdmarx->Instance->CR &= ~DMA_SxCR_EN;
+  haudio_in_sai.hdmarx->State = HAL_DMA_STATE_READY;
+  haudio_in_sai.State = HAL_SAI_STATE_READY;
+  return AUDIO_OK;
+}
+
+void BSP_AUDIO_IN_HostFeed(const uint16_t *data, uint32_t size) {
+  const uint32_t enabled = SAI_xCR1_SAIEN | SAI_xCR1_DMAEN;
+  if (!haudio_in_sai.Instance ||
+      (haudio_in_sai.Instance->CR1 & enabled) != enabled) {
+    return;  // Not recording
+  }
+  for (uint32_t i = 0; i < size; i++) {
+    HostDmaPeripheralTransfer(haudio_in_sai.hdmarx, &data[i], sizeof(data[i]));
+  }
+}
+
+extern "C" void DMA2_Stream7_IRQHandler(void) {
+  HAL_DMA_IRQHandler(haudio_in_sai.hdmarx);
+}
+
+__attribute__((weak)) void BSP_AUDIO_IN_TransferComplete_CallBack(void) {
+}
+
+__attribute__((weak)) void BSP_AUDIO_IN_HalfTransfer_CallBack(void) {
+}
+
+__attribute__((weak)) void BSP_AUDIO_IN_Error_Callback(void) {
+}
+
+// Audio out
+
+static uint16_t *play_buffer = nullptr;
+static uint32_t play_size = 0;
+static uint32_t play_pos = 0;
+
+uint8_t BSP_AUDIO_OUT_Init(uint16_t, uint8_t, uint32_t) {
+  return AUDIO_OK;
+}
+
+uint8_t BSP_AUDIO_OUT_Play(uint16_t *buffer, uint32_t size) {
+  size /= sizeof(uint16_t);
+  if (size == 0 || size % 2 != 0) {
+    return AUDIO_ERROR;
+  }
+  play_buffer = buffer;
+  play_size = size;
+  play_pos = 0;
+  return AUDIO_OK;
+}
+
+uint8_t BSP_AUDIO_OUT_Stop(uint32_t) {
+  play_buffer = nullptr;
+  play_size = 0;
+  play_pos = 0;
+  return AUDIO_OK;
+}
+
+uint8_t BSP_AUDIO_OUT_SetVolume(uint8_t volume) {
+  return volume <= 100 ? AUDIO_OK : AUDIO_ERROR;
+}
+
+uint8_t BSP_AUDIO_OUT_SetMute(uint32_t cmd) {
+  play_muted = cmd == AUDIO_MUTE_ON;
+  return AUDIO_OK;
+}
+
+void BSP_AUDIO_OUT_HostDrain(int16_t *data, uint32_t size) {
+  for (uint32_t i = 0; i < size; i++) {
+    if (!play_buffer) {
+      data[i] = 0;  // Not playing
+      continue;
+    }
+    const int16_t sample = ((volatile int16_t *)play_buffer)[play_pos];
+    data[i] = play_muted ? 0 : sample;
+    play_pos++;
+    if (play_pos == play_size / 2) {
+      BSP_AUDIO_OUT_HalfTransfer_CallBack();
+    } else if (play_pos == play_size) {
+      play_pos = 0;
+      BSP_AUDIO_OUT_TransferComplete_CallBack();
+    }
+  }
+}
+
+__attribute__((weak)) void BSP_AUDIO_OUT_TransferComplete_CallBack(void) {
+}
+
+__attribute__((weak)) void BSP_AUDIO_OUT_HalfTransfer_CallBack(void) {
+}
+
+__attribute__((weak)) void BSP_AUDIO_OUT_Error_CallBack(void) {
+}
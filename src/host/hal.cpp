@@ -0,0 +1,366 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <mbed.h>
+
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_lcd.h"
+
+HAL_StatusTypeDef HAL_Init(void) {
+  return HAL_OK;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type, uint32_t, uint32_t) {
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type) {
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type) {
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *) {
+  return HAL_OK;
+}
+
+// DMA
+
+DMA_Stream_TypeDef host_dma2_streams[8];
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) {
+  if (!hdma || !hdma->Instance) {
+    return HAL_ERROR;
+  }
+  if (hdma->Init.Direction != DMA_MEMORY_TO_MEMORY) {
+    return HAL_ERROR;  // Peripherals are not modelled
+  }
+  if (hdma->Init.PeriphDataAlignment != DMA_PDATAALIGN_WORD) {
+    return HAL_ERROR;  // Only word transfers are modelled
+  }
+  // As DMA_CheckFifoParam(): with words, the 4 word FIFO only holds a
+  // 4 word burst, once full
+  if (hdma->Init.MemBurst != DMA_MBURST_SINGLE ||
+      hdma->Init.PeriphBurst != DMA_PBURST_SINGLE) {
+    if (hdma->Init.FIFOMode != DMA_FIFOMODE_ENABLE ||
+        hdma->Init.FIFOThreshold != DMA_FIFO_THRESHOLD_FULL ||
+        (hdma->Init.MemBurst != DMA_MBURST_SINGLE &&
+         hdma->Init.MemBurst != DMA_MBURST_INC4) ||
+        (hdma->Init.PeriphBurst != DMA_PBURST_SINGLE &&
+         hdma->Init.PeriphBurst != DMA_PBURST_INC4)) {
+      return HAL_ERROR;
+    }
+  }
+  hdma->Instance->CR = hdma->Init.Channel | hdma->Init.Direction |
+                       hdma->Init.PeriphInc | hdma->Init.MemInc |
+                       hdma->Init.Priority | hdma->Init.MemBurst |
+                       hdma->Init.PeriphBurst;
+  hdma->Instance->FCR = hdma->Init.FIFOMode | hdma->Init.FIFOThreshold;
+  hdma->State = HAL_DMA_STATE_READY;
+  hdma->ErrorCode = 0;
+  return HAL_OK;
+}
+
+// Memory-to-memory transfers are carried out immediately.
+static HAL_StatusTypeDef HostDmaTransfer(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uint32_t data_length) {
+  if (hdma->State != HAL_DMA_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (data_length == 0 || data_length > 0xFFFF) {
+    return HAL_ERROR;
+  }
+
+  DMA_Stream_TypeDef *stream = hdma->Instance;
+  stream->PAR = src_address;
+  stream->M0AR = dst_address;
+  stream->NDTR = data_length;
+  hdma->State = HAL_DMA_STATE_BUSY;
+
+  const uint32_t *src = (const uint32_t *)src_address;
+  uint32_t *dst = (uint32_t *)dst_address;
+  // As set up last on the stream, which need not be by this handle
+  if (stream->CR & DMA_PINC_ENABLE) {
+    memmove(dst, src, data_length * sizeof(uint32_t));
+  } else {
+    uint32_t value = *src;
+    for (uint32_t i = 0; i < data_length; i++) {
+      dst[i] = value;
+    }
+  }
+  stream->NDTR = 0;
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uint32_t data_length) {
+  return HostDmaTransfer(hdma, src_address, dst_address, data_length);
+}
+
+extern "C" void HostDmaDefaultIRQHandler(void) {
+}
+
+#define HOST_DMA_IRQ_HANDLER(name) \
+  extern "C" void name(void)       \
+      __attribute__((weak, alias("HostDmaDefaultIRQHandler")))
+
+HOST_DMA_IRQ_HANDLER(DMA2_Stream0_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream1_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream2_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream3_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream4_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream5_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream6_IRQHandler);
+HOST_DMA_IRQ_HANDLER(DMA2_Stream7_IRQHandler);
+
+static void (*const host_dma2_irq_handlers[8])(void) = {
+    DMA2_Stream0_IRQHandler,
+    DMA2_Stream1_IRQHandler,
+    DMA2_Stream2_IRQHandler,
+    DMA2_Stream3_IRQHandler,
+    DMA2_Stream4_IRQHandler,
+    DMA2_Stream5_IRQHandler,
+    DMA2_Stream6_IRQHandler,
+    DMA2_Stream7_IRQHandler,
+};
+
+// The transfer complete interrupt is raised right away, before returning.
+HAL_StatusTypeDef HAL_DMA_Start_IT(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uint32_t data_length) {
+  HAL_StatusTypeDef status =
+      HostDmaTransfer(hdma, src_address, dst_address, data_length);
+  if (status == HAL_OK) {
+    host_dma2_irq_handlers[hdma->Instance - host_dma2_streams]();
+  }
+  return status;
+}
+
+// Only transfer complete is modelled. In double buffer mode, the stream
+// keeps running, and CT tells which memory was just completed.
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma) {
+  if (hdma->State != HAL_DMA_STATE_BUSY) {
+    return;
+  }
+  if (hdma->Instance->CR & DMA_SxCR_DBM) {
+    if (hdma->Instance->CR & DMA_SxCR_CT) {
+      hdma->XferCpltCallback(hdma);
+    } else {
+      hdma->XferM1CpltCallback(hdma);
+    }
+    return;
+  }
+  hdma->State = HAL_DMA_STATE_READY;
+  if (hdma->XferCpltCallback) {
+    hdma->XferCpltCallback(hdma);
+  }
+}
+
+uint32_t HAL_DMA_GetError(DMA_HandleTypeDef *hdma) {
+  return hdma->ErrorCode;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uintptr_t second_mem_address,
+    uint32_t data_length) {
+  if (hdma->Init.Direction == DMA_MEMORY_TO_MEMORY) {
+    return HAL_ERROR;  // Not supported in double buffer mode
+  }
+  if (!hdma->XferCpltCallback || !hdma->XferM1CpltCallback ||
+      !hdma->XferErrorCallback) {
+    return HAL_ERROR;
+  }
+  if (hdma->State != HAL_DMA_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (data_length == 0 || data_length > 0xFFFF) {
+    return HAL_ERROR;
+  }
+
+  DMA_Stream_TypeDef *stream = hdma->Instance;
+  stream->PAR = src_address;
+  stream->M0AR = dst_address;
+  stream->M1AR = second_mem_address;
+  stream->NDTR = data_length;
+  stream->reload_ndtr = data_length;
+  stream->CR = (stream->CR & ~DMA_SxCR_CT) | DMA_SxCR_DBM | DMA_SxCR_EN;
+  hdma->State = HAL_DMA_STATE_BUSY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_ChangeMemory(
+    DMA_HandleTypeDef *hdma, uintptr_t address, HAL_DMA_MemoryTypeDef memory) {
+  if (memory == MEMORY0) {
+    hdma->Instance->M0AR = address;
+  } else {
+    hdma->Instance->M1AR = address;
+  }
+  return HAL_OK;
+}
+
+void HostDmaPeripheralTransfer(
+    DMA_HandleTypeDef *hdma, const void *data, uint32_t size) {
+  DMA_Stream_TypeDef *stream = hdma->Instance;
+  if (!(stream->CR & DMA_SxCR_EN)) {
+    return;  // Data is lost, as on overrun
+  }
+
+  const uintptr_t base =
+      stream->CR & DMA_SxCR_CT ? stream->M1AR : stream->M0AR;
+  const uint32_t index = stream->reload_ndtr - stream->NDTR;
+  memcpy((void *)(base + index * size), data, size);
+  if (--stream->NDTR > 0) {
+    return;
+  }
+
+  // Switches memory before the interrupt, which may not be handled before
+  // the next data item arrives
+  stream->NDTR = stream->reload_ndtr;
+  if (stream->CR & DMA_SxCR_DBM) {
+    stream->CR ^= DMA_SxCR_CT;
+  } else {
+    stream->CR &= ~DMA_SxCR_EN;
+  }
+  host_dma2_irq_handlers[stream - host_dma2_streams]();
+}
+
+HAL_StatusTypeDef HAL_DMA_PollForTransfer(
+    DMA_HandleTypeDef *hdma, HAL_DMA_LevelCompleteTypeDef, uint32_t) {
+  if (hdma->State != HAL_DMA_STATE_BUSY) {
+    return HAL_ERROR;
+  }
+  hdma->State = HAL_DMA_STATE_READY;
+  return HAL_OK;
+}
+
+// LTDC
+
+static LTDC_TypeDef ltdc;
+
+LTDC_HandleTypeDef hLtdcHandler = {&ltdc, {}, HAL_LTDC_ERROR_NONE};
+
+static void ApplyReload(LTDC_TypeDef *instance) {
+  instance->active[0] = instance->shadow[0];
+  instance->active[1] = instance->shadow[1];
+  instance->reload_pending = 0;
+}
+
+HAL_StatusTypeDef HAL_LTDC_ConfigLayer(
+    LTDC_HandleTypeDef *hltdc, LTDC_LayerCfgTypeDef *cfg, uint32_t layer_idx) {
+  if (layer_idx > 1) {
+    return HAL_ERROR;
+  }
+  hltdc->LayerCfg[layer_idx] = *cfg;
+  hltdc->Instance->shadow[layer_idx] = *cfg;
+  ApplyReload(hltdc->Instance);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_LTDC_SetAddress_NoReload(
+    LTDC_HandleTypeDef *hltdc, uintptr_t address, uint32_t layer_idx) {
+  if (layer_idx > 1) {
+    return HAL_ERROR;
+  }
+  hltdc->LayerCfg[layer_idx].FBStartAdress = address;
+  hltdc->Instance->shadow[layer_idx].FBStartAdress = address;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_LTDC_Reload(
+    LTDC_HandleTypeDef *hltdc, uint32_t reload_type) {
+  if (reload_type == LTDC_RELOAD_IMMEDIATE) {
+    ApplyReload(hltdc->Instance);
+  } else {
+    hltdc->Instance->reload_pending = 1;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_LTDC_ConfigCLUT(
+    LTDC_HandleTypeDef *hltdc,
+    uint32_t *clut,
+    uint32_t clut_size,
+    uint32_t layer_idx) {
+  if (layer_idx > 1 || clut_size > 256) {
+    return HAL_ERROR;
+  }
+  memcpy(hltdc->Instance->clut, clut, clut_size * sizeof(uint32_t));
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_LTDC_EnableCLUT(LTDC_HandleTypeDef *, uint32_t) {
+  return HAL_OK;
+}
+
+uint32_t HAL_LTDC_GetError(LTDC_HandleTypeDef *hltdc) {
+  return hltdc->ErrorCode;
+}
+
+void HAL_LTDC_IRQHandler(LTDC_HandleTypeDef *hltdc) {
+  LTDC_TypeDef *instance = hltdc->Instance;
+  uint32_t pending = instance->ISR & instance->IER;
+
+  if (pending & LTDC_IT_FU) {
+    instance->ISR &= ~LTDC_IT_FU;
+    hltdc->ErrorCode |= HAL_LTDC_ERROR_FU;
+    HAL_LTDC_ErrorCallback(hltdc);
+  }
+  if (pending & LTDC_IT_RR) {
+    instance->ISR &= ~LTDC_IT_RR;
+    __HAL_LTDC_DISABLE_IT(hltdc, LTDC_IT_RR);  // As done by the HAL
+    HAL_LTDC_ReloadEventCallback(hltdc);
+  }
+}
+
+__attribute__((weak)) void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef *) {
+}
+
+__attribute__((weak)) void HAL_LTDC_ErrorCallback(LTDC_HandleTypeDef *) {
+}
+
+extern "C" __attribute__((weak)) void LTDC_IRQHandler(void) {
+  HAL_LTDC_IRQHandler(&hLtdcHandler);
+}
+
+const void *HostLtdcGetLine(
+    LTDC_HandleTypeDef *hltdc, uint32_t layer_idx, uint32_t y) {
+  const LTDC_LayerCfgTypeDef &cfg = hltdc->Instance->active[layer_idx];
+  if (y >= cfg.WindowY1 - cfg.WindowY0) {
+    return nullptr;
+  }
+  uint32_t bytes_per_pixel;
+  switch (cfg.PixelFormat) {
+    case LTDC_PIXEL_FORMAT_ARGB8888:
+      bytes_per_pixel = 4;
+      break;
+    case LTDC_PIXEL_FORMAT_RGB565:
+      bytes_per_pixel = 2;
+      break;
+    default:
+      bytes_per_pixel = 1;
+      break;
+  }
+  return (const void *)(cfg.FBStartAdress +
+                        y * cfg.ImageWidth * bytes_per_pixel);
+}
+
+void HostLtdcVerticalBlank(LTDC_HandleTypeDef *hltdc) {
+  LTDC_TypeDef *instance = hltdc->Instance;
+  if (instance->reload_pending) {
+    ApplyReload(instance);
+    instance->ISR |= LTDC_IT_RR;
+  }
+  if (instance->ISR & instance->IER) {
+    LTDC_IRQHandler();
+  }
+}
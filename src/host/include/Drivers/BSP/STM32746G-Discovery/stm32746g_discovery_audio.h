@@ -0,0 +1,67 @@
+#pragma once
+
+// Host stand-in for the STM32746G-Discovery audio driver.
+//
+// Recording is left to the application, which runs the SAI's DMA stream
+// (haudio_in_sai.hdmarx) in double buffer mode, see the host HAL. The host
+// feeds samples with BSP_AUDIO_IN_HostFeed(), which moves them through that
+// stream, raising its interrupts. Playback is drained by
+// BSP_AUDIO_OUT_HostDrain().
+
+#include <stdint.h>
+
+#include <mbed.h>
+
+#define AUDIO_OK 0
+#define AUDIO_ERROR 1
+#define AUDIO_TIMEOUT 2
+
+#define AUDIO_FREQUENCY_48K 48000U
+
+#define INPUT_DEVICE_DIGITAL_MICROPHONE_2 0x0800
+#define INPUT_DEVICE_INPUT_LINE_1 0x0300
+
+#define OUTPUT_DEVICE_SPEAKER 0x0001
+#define OUTPUT_DEVICE_HEADPHONE 0x0002
+#define OUTPUT_DEVICE_BOTH 0x0003
+
+#define AUDIO_MUTE_OFF 0
+#define AUDIO_MUTE_ON 1
+
+#define CODEC_PDWN_HW 1
+#define CODEC_PDWN_SW 2
+
+#define AUDIO_IN_INT_GPIO_PIN 15
+#define AUDIO_IN_INT_IRQ EXTI15_10_IRQn
+#define AUDIO_IN_IRQ_PREPRIO 0x0F
+
+uint8_t BSP_AUDIO_IN_InitEx(
+    uint16_t input_device,
+    uint32_t audio_freq,
+    uint32_t bit_res,
+    uint32_t channel_nbr);
+uint8_t BSP_AUDIO_IN_Stop(uint32_t option);
+
+// Weak callbacks, may be overridden by the application.
+void BSP_AUDIO_IN_TransferComplete_CallBack(void);
+void BSP_AUDIO_IN_HalfTransfer_CallBack(void);
+void BSP_AUDIO_IN_Error_Callback(void);
+
+// Host only: passes halfwords to the SAI's DMA stream while it's enabled.
+void BSP_AUDIO_IN_HostFeed(const uint16_t *data, uint32_t size);
+
+uint8_t BSP_AUDIO_OUT_Init(
+    uint16_t output_device, uint8_t volume, uint32_t audio_freq);
+uint8_t BSP_AUDIO_OUT_Play(uint16_t *buffer, uint32_t size);  // In bytes
+uint8_t BSP_AUDIO_OUT_Stop(uint32_t option);
+uint8_t BSP_AUDIO_OUT_SetVolume(uint8_t volume);
+uint8_t BSP_AUDIO_OUT_SetMute(uint32_t cmd);
+
+// Weak callbacks, may be overridden by the application.
+void BSP_AUDIO_OUT_TransferComplete_CallBack(void);
+void BSP_AUDIO_OUT_HalfTransfer_CallBack(void);
+void BSP_AUDIO_OUT_Error_CallBack(void);
+
+// Host only: takes halfwords from the play buffer as the DMA would. Output
+// is only stored while playing and unmuted, else it's silence.
+void BSP_AUDIO_OUT_HostDrain(int16_t *data, uint32_t size);
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host stand-in for the STM32746G-Discovery LCD driver.
+
+#include <stdint.h>
+
+#include <mbed.h>
+
+#define LCD_OK 0x00
+#define LCD_ERROR 0x01
+
+typedef LTDC_LayerCfgTypeDef LCD_LayerCfgTypeDef;
+
+extern LTDC_HandleTypeDef hLtdcHandler;
+
+uint8_t BSP_LCD_Init(void);
+uint32_t BSP_LCD_GetXSize(void);
+uint32_t BSP_LCD_GetYSize(void);
+void BSP_LCD_DisplayOn(void);
+void BSP_LCD_DisplayOff(void);
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for the STM32746G-Discovery SDRAM driver.
+
+#include <stdint.h>
+
+#define SDRAM_OK 0x00
+#define SDRAM_ERROR 0x01
+
+uint8_t BSP_SDRAM_Init(void);
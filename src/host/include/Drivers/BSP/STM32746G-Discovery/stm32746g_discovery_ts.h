@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the STM32746G-Discovery touchscreen driver.
+
+#include <stdint.h>
+
+#include <mbed.h>
+
+#define TS_OK 0x00
+#define TS_ERROR 0x01
+
+#define TS_INT_PIN 13
+#define TS_INT_EXTI_IRQn EXTI15_10_IRQn
+
+uint8_t BSP_TS_Init(uint16_t size_x, uint16_t size_y);
+uint8_t BSP_TS_ITConfig(void);
@@ -0,0 +1,15 @@
+// Host stand-in for the BSP 7x12 font.
+//
+// Only the metrics matter for rendering cost, so all glyphs are blank.
+
+#include <stdint.h>
+
+typedef struct _tFont {
+  const uint8_t *table;
+  uint16_t Width;
+  uint16_t Height;
+} sFONT;
+
+static const uint8_t Font12_Table[95 * 12] = {0};
+
+sFONT Font12 = {Font12_Table, 7, 12};
@@ -0,0 +1,128 @@
+#pragma once
+
+// Host stand-in for the CMSIS-DSP library.
+//
+// Portable reference implementations of the functions used by the
+// application. They match CMSIS semantics (scaling, output order), not its
+// performance characteristics.
+
+#include <math.h>
+#include <stdint.h>
+
+typedef float float32_t;
+typedef double float64_t;
+typedef int8_t q7_t;
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+
+#define PI 3.14159265358979f
+
+typedef enum {
+  ARM_MATH_SUCCESS = 0,
+  ARM_MATH_ARGUMENT_ERROR = -1,
+  ARM_MATH_LENGTH_ERROR = -2,
+} arm_status;
+
+typedef struct {
+  uint16_t fftLen;
+  const float32_t *pTwiddle;
+  const uint16_t *pBitRevTable;
+  uint16_t bitRevLength;
+} arm_cfft_instance_f32;
+
+void arm_cfft_f32(
+    const arm_cfft_instance_f32 *S,
+    float32_t *p1,
+    uint8_t ifftFlag,
+    uint8_t bitReverseFlag);
+
+typedef struct {
+  arm_cfft_instance_f32 Sint;
+  uint16_t fftLenRFFT;
+  const float32_t *pTwiddleRFFT;
+} arm_rfft_fast_instance_f32;
+
+arm_status arm_rfft_fast_init_f32(
+    arm_rfft_fast_instance_f32 *S, uint16_t fftLen);
+
+// Forward transform only
+void arm_rfft_fast_f32(
+    arm_rfft_fast_instance_f32 *S,
+    float32_t *p,
+    float32_t *pOut,
+    uint8_t ifftFlag);
+
+typedef struct {
+  uint16_t fftLen;
+  const q15_t *pTwiddle;
+  const uint16_t *pBitRevTable;
+  uint16_t bitRevLength;
+} arm_cfft_instance_q15;
+
+typedef struct {
+  uint16_t fftLen;
+  const q31_t *pTwiddle;
+  const uint16_t *pBitRevTable;
+  uint16_t bitRevLength;
+} arm_cfft_instance_q31;
+
+void arm_cfft_q15(
+    const arm_cfft_instance_q15 *S,
+    q15_t *p1,
+    uint8_t ifftFlag,
+    uint8_t bitReverseFlag);
+
+void arm_cfft_q31(
+    const arm_cfft_instance_q31 *S,
+    q31_t *p1,
+    uint8_t ifftFlag,
+    uint8_t bitReverseFlag);
+
+void arm_add_f32(
+    const float32_t *pSrcA,
+    const float32_t *pSrcB,
+    float32_t *pDst,
+    uint32_t blockSize);
+
+void arm_copy_f32(const float32_t *pSrc, float32_t *pDst, uint32_t blockSize);
+
+void arm_fill_f32(float32_t value, float32_t *pDst, uint32_t blockSize);
+
+void arm_scale_f32(
+    const float32_t *pSrc,
+    float32_t scale,
+    float32_t *pDst,
+    uint32_t blockSize);
+
+void arm_cmplx_mult_cmplx_f32(
+    const float32_t *pSrcA,
+    const float32_t *pSrcB,
+    float32_t *pDst,
+    uint32_t numSamples);
+
+void arm_cmplx_mag_squared_f32(
+    const float32_t *pSrc,
+    float32_t *pDst,
+    uint32_t numSamples);
+
+typedef struct {
+  uint8_t M;
+  uint16_t numTaps;
+  const float32_t *pCoeffs;
+  float32_t *pState;
+} arm_fir_decimate_instance_f32;
+
+arm_status arm_fir_decimate_init_f32(
+    arm_fir_decimate_instance_f32 *S,
+    uint16_t numTaps,
+    uint8_t M,
+    const float32_t *pCoeffs,
+    float32_t *pState,
+    uint32_t blockSize);
+
+void arm_fir_decimate_f32(
+    const arm_fir_decimate_instance_f32 *S,
+    const float32_t *pSrc,
+    float32_t *pDst,
+    uint32_t blockSize);
@@ -0,0 +1,59 @@
+#pragma once
+
+// Host stand-in for the CMSIS Cortex-M7 core peripheral header.
+//
+// The DWT cycle counter is emulated by a monotonic clock running at 1 GHz,
+// so cycle counts measured on the host read as nanoseconds.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Normally provided by the device header.
+typedef enum {
+  LTDC_IRQn = 88,
+  EXTI15_10_IRQn = 40,
+  DMA2_Stream0_IRQn = 56,
+  DMA2_Stream1_IRQn = 57,
+} IRQn_Type;
+
+class HostCycleCounter {
+ private:
+  uint32_t offset = 0;
+
+  static uint32_t Raw();
+
+ public:
+  operator uint32_t() const {
+    return Raw() - offset;
+  }
+  HostCycleCounter &operator=(uint32_t value) {
+    offset = Raw() - value;
+    return *this;
+  }
+};
+
+typedef struct {
+  uint32_t CTRL;
+  HostCycleCounter CYCCNT;
+  uint32_t LAR;
+} DWT_Type;
+
+typedef struct {
+  uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type *const DWT;
+extern CoreDebug_Type *const CoreDebug;
+
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+#define __DSB()
+#define __DMB()
+#define __BKPT(value) abort()
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+void NVIC_SetVector(IRQn_Type irqn, uintptr_t vector);
@@ -0,0 +1,94 @@
+#pragma once
+
+// Host stand-in for mbed OS.
+//
+// Provides just enough of the mbed, RTOS and HAL API for the application
+// sources to build and run natively. See src/host/ for the implementations.
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "cmsis/TARGET_CORTEX_M/core_cm7.h"
+#include "stm32f7xx_hal.h"
+
+enum PinName {
+  USBTX,
+  USBRX,
+  LED1,
+  USER_BUTTON,
+};
+
+class Serial {
+ public:
+  Serial(PinName tx, PinName rx);
+  int printf(const char *format, ...);
+  int vprintf(const char *format, va_list args);
+};
+
+class DigitalOut {
+ private:
+  int value = 0;
+
+ public:
+  DigitalOut(PinName pin);
+  DigitalOut &operator=(int value);
+  operator int();
+};
+
+class DigitalIn {
+ public:
+  DigitalIn(PinName pin);
+  operator int();
+};
+
+typedef enum {
+  osPriorityLow,
+  osPriorityNormal,
+  osPriorityAboveNormal,
+  osPriorityHigh,
+  osPriorityRealtime,
+} osPriority;
+
+template <typename T>
+std::function<void()> callback(T *obj, void (T::*method)()) {
+  return [obj, method]() { (obj->*method)(); };
+}
+
+class Thread {
+ private:
+  std::thread thread;
+
+ public:
+  Thread(osPriority priority = osPriorityNormal);
+  ~Thread();
+  int start(std::function<void()> task);
+};
+
+class Mutex {
+ private:
+  std::mutex mutex;
+
+ public:
+  void lock();
+  void unlock();
+};
+
+#define osWaitForever 0xFFFFFFFFU
+
+class EventFlags {
+ private:
+  std::mutex mutex;
+  std::condition_variable cond;
+  uint32_t flags = 0;
+
+ public:
+  uint32_t set(uint32_t flags);
+  uint32_t clear(uint32_t flags);
+  uint32_t wait_all(
+      uint32_t flags, uint32_t millisec = osWaitForever, bool clear = true);
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for the mbed events library. See mbed.h.
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <mbed.h>
+
+#define EVENTS_EVENT_SIZE 64
+
+class EventQueue {
+ private:
+  struct Periodic {
+    int period_ms;
+    std::function<void()> task;
+  };
+
+  std::mutex mutex;
+  std::vector<Periodic> periodic;
+
+ public:
+  EventQueue(unsigned int size);
+  int call_every(int period_ms, std::function<void()> task);
+  void dispatch_forever();
+};
@@ -0,0 +1,346 @@
+#pragma once
+
+// Host stand-in for the STM32F7 HAL.
+//
+// DMA transfers are carried out synchronously by the CPU, interrupt driven
+// ones call the stream's interrupt handler before returning. The LTDC is
+// modelled as far as the application relies on it: shadow/active frame
+// buffer addresses, reload on vertical blanking and the related interrupts.
+
+#include <stdint.h>
+
+#include "cmsis/TARGET_CORTEX_M/core_cm7.h"
+
+extern uint32_t SystemCoreClock;
+
+#define SET_BIT(REG, BIT) ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT) ((REG) & (BIT))
+
+typedef enum {
+  HAL_OK = 0x00,
+  HAL_ERROR = 0x01,
+  HAL_BUSY = 0x02,
+  HAL_TIMEOUT = 0x03,
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+HAL_StatusTypeDef HAL_Init(void);
+
+void HAL_NVIC_SetPriority(
+    IRQn_Type irqn, uint32_t preempt_priority, uint32_t sub_priority);
+void HAL_NVIC_EnableIRQ(IRQn_Type irqn);
+void HAL_NVIC_DisableIRQ(IRQn_Type irqn);
+
+// RCC
+
+typedef struct {
+  uint32_t PLLSAIN;
+  uint32_t PLLSAIQ;
+  uint32_t PLLSAIR;
+  uint32_t PLLSAIP;
+} RCC_PLLSAIInitTypeDef;
+
+typedef struct {
+  uint32_t PeriphClockSelection;
+  RCC_PLLSAIInitTypeDef PLLSAI;
+  uint32_t PLLSAIDivR;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_PERIPHCLK_LTDC 0x00000008U
+#define RCC_PLLSAIDIVR_2 0x00000000U
+#define RCC_PLLSAIDIVR_4 0x00010000U
+#define RCC_PLLSAIDIVR_8 0x00020000U
+#define RCC_PLLSAIDIVR_16 0x00030000U
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *init);
+
+#define __HAL_RCC_DMA2_CLK_ENABLE()
+
+// DMA
+
+typedef struct {
+  uint32_t CR;
+  uint32_t NDTR;
+  uintptr_t PAR;
+  uintptr_t M0AR;
+  uintptr_t M1AR;
+  uint32_t FCR;
+
+  // Host model: what NDTR is reloaded with in double buffer mode
+  uint32_t reload_ndtr;
+} DMA_Stream_TypeDef;
+
+extern DMA_Stream_TypeDef host_dma2_streams[8];
+
+#define DMA2_Stream0 (&host_dma2_streams[0])
+#define DMA2_Stream1 (&host_dma2_streams[1])
+#define DMA2_Stream2 (&host_dma2_streams[2])
+#define DMA2_Stream3 (&host_dma2_streams[3])
+#define DMA2_Stream4 (&host_dma2_streams[4])
+#define DMA2_Stream5 (&host_dma2_streams[5])
+#define DMA2_Stream6 (&host_dma2_streams[6])
+#define DMA2_Stream7 (&host_dma2_streams[7])
+
+typedef struct {
+  uint32_t Channel;
+  uint32_t Direction;
+  uint32_t PeriphInc;
+  uint32_t MemInc;
+  uint32_t PeriphDataAlignment;
+  uint32_t MemDataAlignment;
+  uint32_t Mode;
+  uint32_t Priority;
+  uint32_t FIFOMode;
+  uint32_t FIFOThreshold;
+  uint32_t MemBurst;
+  uint32_t PeriphBurst;
+} DMA_InitTypeDef;
+
+typedef enum {
+  HAL_DMA_STATE_RESET = 0x00,
+  HAL_DMA_STATE_READY = 0x01,
+  HAL_DMA_STATE_BUSY = 0x02,
+  HAL_DMA_STATE_TIMEOUT = 0x03,
+  HAL_DMA_STATE_ERROR = 0x04,
+  HAL_DMA_STATE_ABORT = 0x05,
+} HAL_DMA_StateTypeDef;
+
+typedef enum {
+  HAL_DMA_FULL_TRANSFER = 0x00,
+  HAL_DMA_HALF_TRANSFER = 0x01,
+} HAL_DMA_LevelCompleteTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+  DMA_Stream_TypeDef *Instance;
+  DMA_InitTypeDef Init;
+  HAL_DMA_StateTypeDef State;
+  void *Parent;
+  void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferM1CpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferM1HalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+  uint32_t ErrorCode;
+} DMA_HandleTypeDef;
+
+typedef enum {
+  MEMORY0 = 0x00,
+  MEMORY1 = 0x01,
+} HAL_DMA_MemoryTypeDef;
+
+#define HAL_DMA_ERROR_NONE 0x00000000U
+#define HAL_DMA_ERROR_TE 0x00000001U
+#define HAL_DMA_ERROR_FE 0x00000002U
+#define HAL_DMA_ERROR_DME 0x00000004U
+
+#define DMA_SxCR_EN 0x00000001U
+#define DMA_SxCR_DBM 0x00040000U
+#define DMA_SxCR_CT 0x00080000U
+
+#define DMA_CHANNEL_0 0x00000000U
+#define DMA_CHANNEL_1 0x02000000U
+#define DMA_CHANNEL_2 0x04000000U
+#define DMA_CHANNEL_3 0x06000000U
+
+#define DMA_PERIPH_TO_MEMORY 0x00000000U
+#define DMA_MEMORY_TO_PERIPH 0x00000040U
+#define DMA_MEMORY_TO_MEMORY 0x00000080U
+
+#define DMA_PINC_ENABLE 0x00000200U
+#define DMA_PINC_DISABLE 0x00000000U
+#define DMA_MINC_ENABLE 0x00000400U
+#define DMA_MINC_DISABLE 0x00000000U
+
+#define DMA_PDATAALIGN_BYTE 0x00000000U
+#define DMA_PDATAALIGN_HALFWORD 0x00000800U
+#define DMA_PDATAALIGN_WORD 0x00001000U
+#define DMA_MDATAALIGN_BYTE 0x00000000U
+#define DMA_MDATAALIGN_HALFWORD 0x00002000U
+#define DMA_MDATAALIGN_WORD 0x00004000U
+
+#define DMA_NORMAL 0x00000000U
+#define DMA_CIRCULAR 0x00000100U
+
+#define DMA_PRIORITY_LOW 0x00000000U
+#define DMA_PRIORITY_MEDIUM 0x00010000U
+#define DMA_PRIORITY_HIGH 0x00020000U
+#define DMA_PRIORITY_VERY_HIGH 0x00030000U
+
+#define DMA_FIFOMODE_DISABLE 0x00000000U
+#define DMA_FIFOMODE_ENABLE 0x00000004U
+
+#define DMA_FIFO_THRESHOLD_1QUARTERFULL 0x00000000U
+#define DMA_FIFO_THRESHOLD_HALFFULL 0x00000001U
+#define DMA_FIFO_THRESHOLD_3QUARTERSFULL 0x00000002U
+#define DMA_FIFO_THRESHOLD_FULL 0x00000003U
+
+#define DMA_MBURST_SINGLE 0x00000000U
+#define DMA_MBURST_INC4 0x00800000U
+#define DMA_MBURST_INC8 0x01000000U
+#define DMA_MBURST_INC16 0x01800000U
+
+#define DMA_PBURST_SINGLE 0x00000000U
+#define DMA_PBURST_INC4 0x00200000U
+#define DMA_PBURST_INC8 0x00400000U
+#define DMA_PBURST_INC16 0x00600000U
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_Start(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uint32_t data_length);
+HAL_StatusTypeDef HAL_DMA_Start_IT(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uint32_t data_length);
+HAL_StatusTypeDef HAL_DMA_PollForTransfer(
+    DMA_HandleTypeDef *hdma,
+    HAL_DMA_LevelCompleteTypeDef complete_level,
+    uint32_t timeout);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+uint32_t HAL_DMA_GetError(DMA_HandleTypeDef *hdma);
+
+// Double buffer mode, for peripheral streams only. The host doesn't run
+// these by itself, the peripheral's stand-in does (see
+// BSP_AUDIO_IN_HostFeed()).
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(
+    DMA_HandleTypeDef *hdma,
+    uintptr_t src_address,
+    uintptr_t dst_address,
+    uintptr_t second_mem_address,
+    uint32_t data_length);
+HAL_StatusTypeDef HAL_DMAEx_ChangeMemory(
+    DMA_HandleTypeDef *hdma, uintptr_t address, HAL_DMA_MemoryTypeDef memory);
+
+// Host only: the stream moved one data item, of size bytes, from the
+// peripheral. Completes the transfer and switches buffers as the hardware
+// does in double buffer mode.
+void HostDmaPeripheralTransfer(
+    DMA_HandleTypeDef *hdma, const void *data, uint32_t size);
+
+// SAI
+
+typedef struct {
+  uint32_t CR1;
+  uint32_t DR;
+} SAI_Block_TypeDef;
+
+typedef enum {
+  HAL_SAI_STATE_RESET = 0x00,
+  HAL_SAI_STATE_READY = 0x01,
+  HAL_SAI_STATE_BUSY_RX = 0x22,
+} HAL_SAI_StateTypeDef;
+
+typedef struct {
+  SAI_Block_TypeDef *Instance;
+  DMA_HandleTypeDef *hdmarx;
+  HAL_SAI_StateTypeDef State;
+} SAI_HandleTypeDef;
+
+#define SAI_xCR1_SAIEN 0x00010000U
+#define SAI_xCR1_DMAEN 0x00020000U
+
+#define __HAL_SAI_ENABLE(handle) ((handle)->Instance->CR1 |= SAI_xCR1_SAIEN)
+
+// LTDC
+
+typedef struct {
+  uint8_t Blue;
+  uint8_t Green;
+  uint8_t Red;
+} LTDC_ColorTypeDef;
+
+typedef struct {
+  uint32_t WindowX0;
+  uint32_t WindowX1;
+  uint32_t WindowY0;
+  uint32_t WindowY1;
+  uint32_t PixelFormat;
+  uint32_t Alpha;
+  uint32_t Alpha0;
+  uint32_t BlendingFactor1;
+  uint32_t BlendingFactor2;
+  uintptr_t FBStartAdress;
+  uint32_t ImageWidth;
+  uint32_t ImageHeight;
+  LTDC_ColorTypeDef Backcolor;
+} LTDC_LayerCfgTypeDef;
+
+typedef struct {
+  uint32_t IER;
+  uint32_t ISR;
+
+  // Host model of the shadowed layer registers. Writes go to the shadow
+  // registers and become active on reload.
+  uint32_t reload_pending;
+  LTDC_LayerCfgTypeDef shadow[2];
+  LTDC_LayerCfgTypeDef active[2];
+  uint32_t clut[256];
+} LTDC_TypeDef;
+
+typedef struct {
+  LTDC_TypeDef *Instance;
+  LTDC_LayerCfgTypeDef LayerCfg[2];
+  uint32_t ErrorCode;
+} LTDC_HandleTypeDef;
+
+#define LTDC_IT_LI 0x00000001U
+#define LTDC_IT_FU 0x00000002U
+#define LTDC_IT_TE 0x00000004U
+#define LTDC_IT_RR 0x00000008U
+
+#define LTDC_RELOAD_IMMEDIATE 0x00000001U
+#define LTDC_RELOAD_VERTICAL_BLANKING 0x00000002U
+
+#define LTDC_PIXEL_FORMAT_ARGB8888 0x00000000U
+#define LTDC_PIXEL_FORMAT_RGB565 0x00000002U
+#define LTDC_PIXEL_FORMAT_L8 0x00000005U
+
+#define LTDC_BLENDING_FACTOR1_CA 0x00000400U
+#define LTDC_BLENDING_FACTOR1_PAxCA 0x00000600U
+#define LTDC_BLENDING_FACTOR2_CA 0x00000005U
+#define LTDC_BLENDING_FACTOR2_PAxCA 0x00000007U
+
+#define HAL_LTDC_ERROR_NONE 0x00000000U
+#define HAL_LTDC_ERROR_TE 0x00000001U
+#define HAL_LTDC_ERROR_FU 0x00000002U
+
+#define __HAL_LTDC_ENABLE_IT(handle, it) ((handle)->Instance->IER |= (it))
+#define __HAL_LTDC_DISABLE_IT(handle, it) ((handle)->Instance->IER &= ~(it))
+
+HAL_StatusTypeDef HAL_LTDC_ConfigLayer(
+    LTDC_HandleTypeDef *hltdc, LTDC_LayerCfgTypeDef *cfg, uint32_t layer_idx);
+HAL_StatusTypeDef HAL_LTDC_SetAddress_NoReload(
+    LTDC_HandleTypeDef *hltdc, uintptr_t address, uint32_t layer_idx);
+HAL_StatusTypeDef HAL_LTDC_Reload(
+    LTDC_HandleTypeDef *hltdc, uint32_t reload_type);
+HAL_StatusTypeDef HAL_LTDC_ConfigCLUT(
+    LTDC_HandleTypeDef *hltdc,
+    uint32_t *clut,
+    uint32_t clut_size,
+    uint32_t layer_idx);
+HAL_StatusTypeDef HAL_LTDC_EnableCLUT(
+    LTDC_HandleTypeDef *hltdc, uint32_t layer_idx);
+uint32_t HAL_LTDC_GetError(LTDC_HandleTypeDef *hltdc);
+void HAL_LTDC_IRQHandler(LTDC_HandleTypeDef *hltdc);
+
+// Weak callbacks, may be overridden by the application.
+void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef *hltdc);
+void HAL_LTDC_ErrorCallback(LTDC_HandleTypeDef *hltdc);
+
+// Interrupt vector, may be overridden by the application.
+extern "C" void LTDC_IRQHandler(void);
+
+// Host only: simulates the vertical blanking period of one frame. Applies
+// pending reloads and raises the LTDC interrupt as the hardware would.
+void HostLtdcVerticalBlank(LTDC_HandleTypeDef *hltdc);
+
+// Host only: the pixels the LTDC fetches for line y of a layer's window
+// with the active registers, i.e. from the frame buffer start address, one
+// image width per line. nullptr if y is outside the window.
+const void *HostLtdcGetLine(
+    LTDC_HandleTypeDef *hltdc, uint32_t layer_idx, uint32_t y);
@@ -0,0 +1,164 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <mbed.h>
+#include <mbed_events.h>
+
+#include "cmsis/TARGET_CORTEX_M/core_cm7.h"
+
+uint32_t SystemCoreClock = 216000000;
+
+// Core peripherals
+
+static DWT_Type dwt;
+static CoreDebug_Type core_debug;
+
+DWT_Type *const DWT = &dwt;
+CoreDebug_Type *const CoreDebug = &core_debug;
+
+uint32_t HostCycleCounter::Raw() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type) {
+}
+
+void NVIC_DisableIRQ(IRQn_Type) {
+}
+
+void NVIC_EnableIRQ(IRQn_Type) {
+}
+
+void NVIC_SetPriority(IRQn_Type, uint32_t) {
+}
+
+void NVIC_SetVector(IRQn_Type, uintptr_t) {
+}
+
+// Drivers
+
+Serial::Serial(PinName, PinName) {
+}
+
+int Serial::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int result = vprintf(format, args);
+  va_end(args);
+  return result;
+}
+
+int Serial::vprintf(const char *format, va_list args) {
+  return ::vfprintf(stdout, format, args);
+}
+
+DigitalOut::DigitalOut(PinName) {
+}
+
+DigitalOut &DigitalOut::operator=(int new_value) {
+  value = new_value;
+  return *this;
+}
+
+DigitalOut::operator int() {
+  return value;
+}
+
+DigitalIn::DigitalIn(PinName) {
+}
+
+DigitalIn::operator int() {
+  return 0;
+}
+
+// RTOS
+
+Thread::Thread(osPriority) {
+}
+
+Thread::~Thread() {
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+int Thread::start(std::function<void()> task) {
+  thread = std::thread(task);
+  return 0;
+}
+
+void Mutex::lock() {
+  mutex.lock();
+}
+
+void Mutex::unlock() {
+  mutex.unlock();
+}
+
+uint32_t EventFlags::set(uint32_t new_flags) {
+  std::lock_guard<std::mutex> lock(mutex);
+  flags |= new_flags;
+  cond.notify_all();
+  return flags;
+}
+
+uint32_t EventFlags::clear(uint32_t clear_flags) {
+  std::lock_guard<std::mutex> lock(mutex);
+  uint32_t result = flags;
+  flags &= ~clear_flags;
+  return result;
+}
+
+uint32_t EventFlags::wait_all(
+    uint32_t wait_flags, uint32_t millisec, bool clear) {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto all_set = [&] { return (flags & wait_flags) == wait_flags; };
+  if (millisec == osWaitForever) {
+    cond.wait(lock, all_set);
+  } else if (!cond.wait_for(
+                 lock, std::chrono::milliseconds(millisec), all_set)) {
+    return flags;
+  }
+  uint32_t result = flags;
+  if (clear) {
+    flags &= ~wait_flags;
+  }
+  return result;
+}
+
+// Events
+
+EventQueue::EventQueue(unsigned int) {
+}
+
+int EventQueue::call_every(int period_ms, std::function<void()> task) {
+  std::lock_guard<std::mutex> lock(mutex);
+  periodic.push_back(Periodic{period_ms, task});
+  return (int)periodic.size();
+}
+
+void EventQueue::dispatch_forever() {
+  // Coarse scheduler: wake up every 10 ms and run whatever is due.
+  const int tick_ms = 10;
+  uint64_t elapsed_ms = 0;
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(tick_ms));
+    elapsed_ms += tick_ms;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Periodic &p : periodic) {
+      if (elapsed_ms % p.period_ms < (uint64_t)tick_ms) {
+        p.task();
+      }
+    }
+  }
+}
@@ -144,8 +144,11 @@ void Display::Flip() {
 
   // Request swap of front buffer and next front buffer by ISR
   switch_front_buffer = true;
-  HAL_LTDC_SetAddress_NoReload(
-      &hLtdcHandler, layer0.GetNextFrontBuffer().addr, 0);
+  flipped_view = background_view;
+  const uintptr_t background_addr =
+      background_view ? (uintptr_t)background_view
+                      : layer0.GetNextFrontBuffer().addr;
+  HAL_LTDC_SetAddress_NoReload(&hLtdcHandler, background_addr, 0);
   HAL_LTDC_SetAddress_NoReload(
       &hLtdcHandler, layer1.GetNextFrontBuffer().addr, 1);
   HAL_LTDC_Reload(&hLtdcHandler, LTDC_RELOAD_VERTICAL_BLANKING);
@@ -154,17 +157,19 @@ void Display::Flip() {
   __HAL_LTDC_ENABLE_IT(&hLtdcHandler, LTDC_IT_RR);
 }
 
-void Display::HandleReload() {
+bool Display::HandleReload() {
   if (!switch_front_buffer) {
-    return;
+    return false;
   }
   switch_front_buffer = false;
+  shown_view = flipped_view;
 
   layer0.FlipFrontBuffer();
   layer1.FlipFrontBuffer();
 
   // Don't call us again unless another buffer switch is needed
   __HAL_LTDC_DISABLE_IT(&hLtdcHandler, LTDC_IT_RR);
+  return true;
 }
 
 VolatileBuffer<uint32_t> &Display::GetForeground() {
@@ -175,8 +180,23 @@ VolatileBuffer<uint8_t> &Display::GetBackground() {
   return layer0.GetBackBuffer();
 }
 
+void Display::SetBackgroundView(volatile uint8_t *view) {
+  background_view = view;
+}
+
+volatile uint8_t *Display::GetShownBackgroundView() {
+  return shown_view;
+}
+
+volatile uint8_t *Display::GetFlippedBackgroundView() {
+  return flipped_view;
+}
+
 void Display::HandleUnderrun() {
   ltdc_underrun_counter.Increment();
+
+  // The HAL disables the interrupt on each underrun, count the next one too
+  __HAL_LTDC_ENABLE_IT(&hLtdcHandler, LTDC_IT_FU);
 }
 
 void Display::HandleLtdcIRQ() {
@@ -22,6 +22,11 @@ class Display {
   // Signal for ISR to switch front buffer and next front buffers
   bool switch_front_buffer;
 
+  // Shown instead of the background buffers if set, see SetBackgroundView()
+  volatile uint8_t *background_view = nullptr;
+  volatile uint8_t *volatile flipped_view = nullptr;  // By the last Flip()
+  volatile uint8_t *volatile shown_view = nullptr;    // Since the last reload
+
   CopyDMA &copy_dma;
 
   app::debug::Counter &ltdc_underrun_counter;
@@ -36,7 +41,9 @@ class Display {
   int Init();
 
   void Flip();
-  void HandleReload();
+
+  // Returns whether the buffers flipped, i.e. the last Flip() is now shown.
+  bool HandleReload();
   void HandleUnderrun();
 
   int Blit(volatile uint8_t *src_buf, int src_line, int dst_line, int n_lines);
@@ -46,6 +53,16 @@ class Display {
   VolatileBuffer<uint32_t> &GetForeground();
   VolatileBuffer<uint8_t> &GetBackground();
 
+  // Shows the background from elsewhere with the next Flip(): size_y lines
+  // of size_x pixels from view, instead of the background buffer. Repeated
+  // per Flip(), e.g. with a scrolled view. nullptr goes back to the buffer.
+  void SetBackgroundView(volatile uint8_t *view);
+
+  // The background views the LTDC may be scanning out: the one shown, and
+  // the one flipped to until the reload shows it. nullptr for the buffers.
+  volatile uint8_t *GetShownBackgroundView();
+  volatile uint8_t *GetFlippedBackgroundView();
+
   void HandleLtdcIRQ();
 };
 
@@ -1,28 +1,114 @@
+#include <inttypes.h>
+
 #include <mbed.h>
 
+#include "debug/class.h"
 #include "debug/macros.h"
+#include "hw/perf_timer.h"
 
 #include "dma.h"
 
 namespace app::hw {
 
-static uint32_t zero_words[] = {0, 0, 0, 0};
+// Aligned for bursts
+alignas(16) static uint32_t zero_words[] = {0, 0, 0, 0};
+
+// Queue of each managed stream, for the interrupt handlers
+static DmaQueue *volatile dma_stream_queues[dma_num_streams] = {};
+
+bool dma_options_valid(const DmaOptions &options) {
+  return options.burst == DmaBurst::Single ||
+         options.fifo_threshold == DmaFifoThreshold::Full;
+}
+
+const char *dma_priority_name(DmaPriority priority) {
+  switch (priority) {
+    case DmaPriority::Low:
+      return "low";
+    case DmaPriority::Medium:
+      return "medium";
+    case DmaPriority::High:
+      return "high";
+    case DmaPriority::VeryHigh:
+      return "very-high";
+  }
+  return "?";
+}
 
-CopyDMA::CopyDMA() {
+const char *dma_burst_name(DmaBurst burst) {
+  switch (burst) {
+    case DmaBurst::Single:
+      return "single";
+    case DmaBurst::Incr4:
+      return "incr4";
+  }
+  return "?";
 }
 
-int CopyDMA::Init() {
+const char *dma_fifo_threshold_name(DmaFifoThreshold threshold) {
+  switch (threshold) {
+    case DmaFifoThreshold::Quarter:
+      return "1/4";
+    case DmaFifoThreshold::Half:
+      return "1/2";
+    case DmaFifoThreshold::ThreeQuarters:
+      return "3/4";
+    case DmaFifoThreshold::Full:
+      return "full";
+  }
+  return "?";
+}
+
+static uint32_t dma_priority_bits(DmaPriority priority) {
+  switch (priority) {
+    case DmaPriority::Low:
+      return DMA_PRIORITY_LOW;
+    case DmaPriority::Medium:
+      return DMA_PRIORITY_MEDIUM;
+    case DmaPriority::High:
+      return DMA_PRIORITY_HIGH;
+    case DmaPriority::VeryHigh:
+      return DMA_PRIORITY_VERY_HIGH;
+  }
+  return DMA_PRIORITY_LOW;
+}
+
+static uint32_t dma_fifo_threshold_bits(DmaFifoThreshold threshold) {
+  switch (threshold) {
+    case DmaFifoThreshold::Quarter:
+      return DMA_FIFO_THRESHOLD_1QUARTERFULL;
+    case DmaFifoThreshold::Half:
+      return DMA_FIFO_THRESHOLD_HALFFULL;
+    case DmaFifoThreshold::ThreeQuarters:
+      return DMA_FIFO_THRESHOLD_3QUARTERSFULL;
+    case DmaFifoThreshold::Full:
+      return DMA_FIFO_THRESHOLD_FULL;
+  }
+  return DMA_FIFO_THRESHOLD_FULL;
+}
+
+// Words per burst
+static uint32_t dma_burst_words(DmaBurst burst) {
+  return burst == DmaBurst::Incr4 ? 4 : 1;
+}
+
+int DmaQueue::Init(
+    DMA_Stream_TypeDef *stream,
+    IRQn_Type new_irqn,
+    PerfTimer &new_perf_timer) {
   __HAL_RCC_DMA2_CLK_ENABLE();
 
-  handle.Instance = DMA2_Stream0;       // Only DMA2 can do memory-to-memory
-  handle.Init.Channel = DMA_CHANNEL_0;  // Can use only 1 chan per stream
+  perf_timer = &new_perf_timer;
+
+  handle.Instance = stream;             // Only DMA2 can do memory-to-memory
+  handle.Init.Channel = DMA_CHANNEL_0;  // Any, no peripheral involved
   handle.Init.Direction = DMA_MEMORY_TO_MEMORY;
-  handle.Init.PeriphInc = DMA_PINC_ENABLE;  // Source
+  handle.Init.PeriphInc = DMA_PINC_ENABLE;  // Source, see Configure()
   handle.Init.MemInc = DMA_MINC_ENABLE;     // Destination
   handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
   handle.Init.MemDataAlignment = DMA_PDATAALIGN_WORD;
   handle.Init.Mode = DMA_NORMAL;
-  handle.Init.Priority = DMA_PRIORITY_LOW;
+  handle.Init.Priority = DMA_PRIORITY_LOW;   // See Configure()
   handle.Init.MemBurst = DMA_MBURST_SINGLE;  // See AN4031 for burst reqs
   handle.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
   handle.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
@@ -31,115 +117,411 @@ int CopyDMA::Init() {
   if (HAL_OK != HAL_DMA_Init(&handle)) {
     return 1;
   }
+  handle.Parent = this;
+  handle.XferCpltCallback = TransferCompleteCallback;
+  handle.XferErrorCallback = TransferErrorCallback;
 
+  irqn = new_irqn;
+  HAL_NVIC_SetPriority(irqn, 0xE, 0);  // Like the LTDC
+  HAL_NVIC_EnableIRQ(irqn);
   return 0;
 }
 
-int CopyDMA::CopyWordsUnsafe(
-    uint32_t src_addr, uint32_t dst_addr, uint32_t num_words) {
-  // DMA can process only up to 0xFFFF words.
-  // Our DMA bursts have 4 word size.
-  // (=> num_words must be multiple of 4!)
-  // Our LTDC bursts have 64 byte size.
-  // LTDC bursts can't cross the 1kB boundary.
-  // (=> src_addr/dst_addr should be 64 byte = 16 word multiple!).
-  // Highest multiple of 4 and 64 less than 0xFFFF is 0xFFC0.
-  const uint32_t max_num_words_per_batch = 0xFFC0;
+// Sets the stream up for the transfer, if it isn't already.
+int DmaQueue::Configure(const Transfer &transfer) {
+  const uint32_t periph_inc =
+      transfer.fill ? DMA_PINC_DISABLE : DMA_PINC_ENABLE;
+  const uint32_t priority = dma_priority_bits(transfer.options.priority);
+  const uint32_t mem_burst = transfer.options.burst == DmaBurst::Incr4
+                                 ? DMA_MBURST_INC4
+                                 : DMA_MBURST_SINGLE;
+  const uint32_t periph_burst = transfer.options.burst == DmaBurst::Incr4
+                                    ? DMA_PBURST_INC4
+                                    : DMA_PBURST_SINGLE;
+  const uint32_t fifo_threshold =
+      dma_fifo_threshold_bits(transfer.options.fifo_threshold);
+  if (handle.Init.PeriphInc == periph_inc &&
+      handle.Init.Priority == priority && handle.Init.MemBurst == mem_burst &&
+      handle.Init.PeriphBurst == periph_burst &&
+      handle.Init.FIFOThreshold == fifo_threshold) {
+    return 0;
+  }
+  handle.Init.PeriphInc = periph_inc;
+  handle.Init.Priority = priority;
+  handle.Init.MemBurst = mem_burst;
+  handle.Init.PeriphBurst = periph_burst;
+  handle.Init.FIFOThreshold = fifo_threshold;
+  return HAL_OK == HAL_DMA_Init(&handle) ? 0 : 1;
+}
+
+// Bursts must not cross a 1 kB boundary (so start on a multiple of their
+// size), and the length must be a multiple of them.
+static bool dma_aligned(
+    uintptr_t src_addr,
+    uintptr_t dst_addr,
+    uint32_t num_words,
+    bool fill,
+    DmaBurst burst) {
+  const uint32_t burst_bytes = sizeof(uint32_t) * dma_burst_words(burst);
+  return (dst_addr % burst_bytes) == 0 &&
+         (fill || (src_addr % burst_bytes) == 0) &&
+         (num_words % dma_burst_words(burst)) == 0;
+}
 
-  // Batches of 0xFFC0 words.
-  while (num_words > max_num_words_per_batch) {
-    CopyMax65kWordsUnsafe(src_addr, dst_addr, max_num_words_per_batch);
-    num_words -= max_num_words_per_batch;
-    src_addr += sizeof(uint32_t) * max_num_words_per_batch;
-    dst_addr += sizeof(uint32_t) * max_num_words_per_batch;
+uint32_t DmaQueue::Submit(
+    uintptr_t src_addr,
+    uintptr_t dst_addr,
+    uint32_t num_words,
+    bool fill,
+    const DmaOptions &options,
+    DmaCallback callback,
+    void *context) {
+  const uint32_t n = submitted;
+  if (n - completed >= (uint32_t)dma_max_queued) {
+    return 0;
   }
+  const uint32_t slot = (n + 1) % dma_max_queued;
+  event_flags.clear(1 << slot);
+  transfers[slot] = Transfer{
+      src_addr, dst_addr, num_words, fill, options, callback, context};
 
-  // Any remaining words (at most 0xFFC0 words).
-  if (num_words > 0) {
-    CopyMax65kWordsUnsafe(src_addr, dst_addr, num_words);
+  // The interrupt starts queued transfers while one runs, otherwise this
+  // one starts here. Masked, so that the interrupt can't complete the
+  // running one in between.
+  HAL_NVIC_DisableIRQ(irqn);
+  const bool idle = n == completed;
+  submitted = n + 1;
+  queued_words = queued_words + num_words;
+  if (n + 1 - completed > stats.max_queued) {
+    stats.max_queued = n + 1 - completed;
+  }
+  if (idle) {
+    busy_since = perf_timer->GetCycles();
+    StartBatch();
   }
+  HAL_NVIC_EnableIRQ(irqn);
+  return n + 1;
+}
 
-  return 0;
+// Starts the next batch of the oldest transfer. Nothing may follow the
+// start, the interrupt may come right away.
+void DmaQueue::StartBatch() {
+  Transfer &transfer = transfers[(completed + 1) % dma_max_queued];
+  batch_words = transfer.num_words < dma_max_batch_words
+                    ? transfer.num_words
+                    : dma_max_batch_words;
+  if (batch_words == 0) {
+    FinishTransfer();
+  } else if (
+      !dma_aligned(
+          transfer.src_addr,
+          transfer.dst_addr,
+          batch_words,
+          transfer.fill,
+          transfer.options.burst) ||
+      0 != Configure(transfer) ||
+      HAL_OK != HAL_DMA_Start_IT(
+                    &handle,
+                    transfer.src_addr,
+                    transfer.dst_addr,
+                    batch_words)) {
+    HandleTransferError();
+  }
 }
 
-int CopyDMA::CopyMax65kWordsUnsafe(
-    uint32_t src_addr, uint32_t dst_addr, uint32_t num_words) {
-  if (HAL_OK != HAL_DMA_Start(&handle, src_addr, dst_addr, num_words)) {
-    return 1;
+// Completes the oldest transfer and starts the next one, if any.
+void DmaQueue::FinishTransfer() {
+  const uint32_t slot = (completed + 1) % dma_max_queued;
+  Transfer &transfer = transfers[slot];
+  queued_words = queued_words - transfer.num_words;
+  if (transfer.callback) {
+    transfer.callback(transfer.context);
+  }
+  completed = completed + 1;
+  stats.transfers++;
+  event_flags.set(1 << slot);
+  if (completed != submitted) {
+    StartBatch();
+  } else {
+    stats.busy_cycles += perf_timer->GetCycles() - busy_since;
   }
+}
 
-  if (HAL_OK !=
-      HAL_DMA_PollForTransfer(&handle, HAL_DMA_FULL_TRANSFER, HAL_MAX_DELAY)) {
-    return 1;
+void DmaQueue::HandleTransferComplete() {
+  if (completed == submitted) {
+    return;  // Already finished, e.g. after an error
   }
+  Transfer &transfer = transfers[(completed + 1) % dma_max_queued];
+  transfer.num_words -= batch_words;
+  transfer.dst_addr += sizeof(uint32_t) * batch_words;
+  if (!transfer.fill) {
+    transfer.src_addr += sizeof(uint32_t) * batch_words;
+  }
+  queued_words = queued_words - batch_words;
+  stats.words += batch_words;
+  if (transfer.num_words > 0) {
+    StartBatch();
+  } else {
+    FinishTransfer();
+  }
+}
 
-  return 0;
+// Skips the rest of the transfer, so that the queue keeps going.
+void DmaQueue::HandleTransferError() {
+  if (completed == submitted) {
+    return;
+  }
+  errors = errors + 1;
+  FinishTransfer();
 }
 
-ZeroDMA::ZeroDMA() {
+void DmaQueue::TransferCompleteCallback(DMA_HandleTypeDef *hdma) {
+  ((DmaQueue *)hdma->Parent)->HandleTransferComplete();
 }
 
-int ZeroDMA::Init() {
-  __HAL_RCC_DMA2_CLK_ENABLE();
+// Only transfer and direct mode errors end the transfer. The HAL reports
+// FIFO errors too, but the stream keeps going and completes as usual.
+void DmaQueue::TransferErrorCallback(DMA_HandleTypeDef *hdma) {
+  DmaQueue *queue = (DmaQueue *)hdma->Parent;
+  if (HAL_DMA_GetError(hdma) & (HAL_DMA_ERROR_TE | HAL_DMA_ERROR_DME)) {
+    queue->HandleTransferError();
+  } else {
+    queue->stats.fifo_errors++;
+  }
+}
 
-  handle.Instance = DMA2_Stream0;       // Only DMA2 can do memory-to-memory
-  handle.Init.Channel = DMA_CHANNEL_1;  // Can use only 1 chan per stream
-  handle.Init.Direction = DMA_MEMORY_TO_MEMORY;
-  handle.Init.PeriphInc = DMA_PINC_DISABLE;  // Source
-  handle.Init.MemInc = DMA_MINC_ENABLE;      // Destination
-  handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
-  handle.Init.MemDataAlignment = DMA_PDATAALIGN_WORD;
-  handle.Init.Mode = DMA_NORMAL;
-  handle.Init.Priority = DMA_PRIORITY_LOW;
-  handle.Init.MemBurst = DMA_MBURST_SINGLE;  // See AN4031 for burst reqs
-  handle.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
-  handle.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
-  handle.Init.PeriphBurst = DMA_MBURST_SINGLE;
+bool DmaQueue::IsComplete(uint32_t ticket) {
+  return (int32_t)(completed - ticket) >= 0;
+}
 
-  if (HAL_OK != HAL_DMA_Init(&handle)) {
-    return 1;
+void DmaQueue::Wait(uint32_t ticket) {
+  // The flag may also be that of an earlier transfer in the slot, or be
+  // cleared already for a later one. Either only costs another check.
+  while (!IsComplete(ticket)) {
+    event_flags.wait_all(1 << (ticket % dma_max_queued), osWaitForever, false);
   }
+}
+
+void DmaQueue::WaitAll() {
+  Wait(submitted);
+}
+
+uint32_t DmaQueue::GetQueuedWords() {
+  return queued_words;
+}
 
+uint32_t DmaQueue::GetErrors() {
+  return errors;
+}
+
+DmaStreamStats DmaQueue::GetStats() {
+  HAL_NVIC_DisableIRQ(irqn);
+  DmaStreamStats result = stats;
+  if (completed != submitted) {
+    result.busy_cycles += perf_timer->GetCycles() - busy_since;
+  }
+  HAL_NVIC_EnableIRQ(irqn);
+  return result;
+}
+
+void DmaQueue::ResetStats() {
+  HAL_NVIC_DisableIRQ(irqn);
+  stats = DmaStreamStats{};
+  busy_since = perf_timer->GetCycles();
+  HAL_NVIC_EnableIRQ(irqn);
+}
+
+void DmaQueue::HandleIRQ() {
+  HAL_DMA_IRQHandler(&handle);
+}
+
+DmaManager::DmaManager(app::debug::Debug &dbg, PerfTimer &perf_timer)
+    : dbg(dbg), perf_timer(perf_timer) {
+}
+
+int DmaManager::Init() {
+  DMA_Stream_TypeDef *const streams[dma_num_streams] = {
+      DMA2_Stream0,
+      DMA2_Stream1,
+  };
+  const IRQn_Type irqns[dma_num_streams] = {
+      DMA2_Stream0_IRQn,
+      DMA2_Stream1_IRQn,
+  };
+  for (int i = 0; i < dma_num_streams; i++) {
+    if (0 != queues[i].Init(streams[i], irqns[i], perf_timer)) {
+      return 1;
+    }
+    dma_stream_queues[i] = &queues[i];
+  }
+  ResetStats();
   return 0;
 }
 
-int ZeroDMA::ZeroWordsUnsafe(uint32_t dst_addr, uint32_t num_words) {
-  // DMA can process only up to 0xFFFF words.
-  // Our DMA bursts have 4 word size.
-  // (=> num_words MUST be multiple of 4!)
-  // Our LTDC bursts have 64 byte size.
-  // LTDC bursts can't cross the 1kB boundary.
-  // (=> dst_addr SHOULD be 64 byte (16 word) multiple!).
-  // Highest multiple 64 (and 4) less than 0xFFFF is 0xFFC0.
-  const uint32_t max_num_words_per_batch = 0xFFC0;
+DmaTicket DmaManager::Submit(
+    uintptr_t src_addr,
+    uintptr_t dst_addr,
+    uint32_t num_words,
+    bool fill,
+    const DmaOptions &options,
+    DmaCallback callback,
+    void *context) {
+  mutex.lock();
+
+  // The stream with the fewest words queued, others if its queue is full
+  int least_busy = 0;
+  for (int i = 1; i < dma_num_streams; i++) {
+    if (queues[i].GetQueuedWords() < queues[least_busy].GetQueuedWords()) {
+      least_busy = i;
+    }
+  }
+  DmaTicket ticket = {0, 0};
+  for (int i = 0; i < dma_num_streams && ticket.number == 0; i++) {
+    const int stream = (least_busy + i) % dma_num_streams;
+    ticket.stream = stream;
+    ticket.number = queues[stream].Submit(
+        src_addr, dst_addr, num_words, fill, options, callback, context);
+  }
+
+  mutex.unlock();
+  return ticket;
+}
+
+bool DmaManager::IsComplete(DmaTicket ticket) {
+  return queues[ticket.stream].IsComplete(ticket.number);
+}
+
+void DmaManager::Wait(DmaTicket ticket) {
+  queues[ticket.stream].Wait(ticket.number);
+}
 
-  // Batches of 0xFFC0 words.
-  while (num_words > max_num_words_per_batch) {
-    ZeroMax65kWordsUnsafe(dst_addr, max_num_words_per_batch);
-    num_words -= max_num_words_per_batch;
-    dst_addr += sizeof(uint32_t) * max_num_words_per_batch;
+void DmaManager::WaitAll() {
+  for (DmaQueue &queue : queues) {
+    queue.WaitAll();
   }
+}
 
-  // Any remaining words (at most 0xFFC0 words).
-  if (num_words > 0) {
-    ZeroMax65kWordsUnsafe(dst_addr, num_words);
+uint32_t DmaManager::GetErrors() {
+  uint32_t errors = 0;
+  for (DmaQueue &queue : queues) {
+    errors += queue.GetErrors();
   }
+  return errors;
+}
 
-  return 0;
+DmaStreamStats DmaManager::GetStats(int stream) {
+  return queues[stream].GetStats();
 }
 
-int ZeroDMA::ZeroMax65kWordsUnsafe(uint32_t dst_addr, uint32_t num_words) {
-  if (HAL_OK !=
-      HAL_DMA_Start(&handle, (uint32_t)zero_words, dst_addr, num_words)) {
-    return 1;
+uint32_t DmaManager::GetStatsCycles() {
+  return perf_timer.GetCycles() - stats_since;
+}
+
+void DmaManager::ResetStats() {
+  stats_since = perf_timer.GetCycles();
+  for (DmaQueue &queue : queues) {
+    queue.ResetStats();
+  }
+}
+
+void DmaManager::Report() {
+  const uint32_t cycles = GetStatsCycles();
+  for (int i = 0; i < dma_num_streams; i++) {
+    const DmaStreamStats stats = GetStats(i);
+    dbg.printf(
+        "dma stream %d: %" PRIu32 " transfers, %" PRIu64
+        " words, busy %" PRIu32 "%%, up to %" PRIu32 " queued, %" PRIu32
+        " FIFO errors\n",
+        i,
+        stats.transfers,
+        stats.words,
+        cycles ? (uint32_t)(stats.busy_cycles * 100 / cycles) : 0,
+        stats.max_queued,
+        stats.fifo_errors);
   }
+}
 
-  if (HAL_OK !=
-      HAL_DMA_PollForTransfer(&handle, HAL_DMA_FULL_TRANSFER, HAL_MAX_DELAY)) {
-    return 1;
+CopyDMA::CopyDMA(DmaManager &manager, const DmaOptions &options)
+    : manager(manager), options(options) {
+}
+
+DmaTicket CopyDMA::CopyWordsAsync(
+    uintptr_t src_addr,
+    uintptr_t dst_addr,
+    uint32_t num_words,
+    DmaCallback callback,
+    void *context) {
+  return manager.Submit(
+      src_addr, dst_addr, num_words, false, options, callback, context);
+}
+
+int CopyDMA::CopyWordsUnsafe(
+    uintptr_t src_addr, uintptr_t dst_addr, uint32_t num_words) {
+  if (num_words == 0) {
+    return 0;
   }
+  const uint32_t errors = manager.GetErrors();
+  DmaTicket ticket;
+  while (0 ==
+         (ticket = CopyWordsAsync(src_addr, dst_addr, num_words)).number) {
+    manager.WaitAll();  // Queues full
+  }
+  manager.Wait(ticket);
+  return manager.GetErrors() == errors ? 0 : 1;
+}
 
-  return 0;
+DmaManager &CopyDMA::GetManager() {
+  return manager;
+}
+
+ZeroDMA::ZeroDMA(DmaManager &manager, const DmaOptions &options)
+    : manager(manager), options(options) {
+}
+
+DmaTicket ZeroDMA::ZeroWordsAsync(
+    uintptr_t dst_addr,
+    uint32_t num_words,
+    DmaCallback callback,
+    void *context) {
+  return manager.Submit(
+      (uintptr_t)zero_words,
+      dst_addr,
+      num_words,
+      true,
+      options,
+      callback,
+      context);
+}
+
+int ZeroDMA::ZeroWordsUnsafe(uintptr_t dst_addr, uint32_t num_words) {
+  if (num_words == 0) {
+    return 0;
+  }
+  const uint32_t errors = manager.GetErrors();
+  DmaTicket ticket;
+  while (0 == (ticket = ZeroWordsAsync(dst_addr, num_words)).number) {
+    manager.WaitAll();  // Queues full
+  }
+  manager.Wait(ticket);
+  return manager.GetErrors() == errors ? 0 : 1;
+}
+
+DmaManager &ZeroDMA::GetManager() {
+  return manager;
 }
 
 }  // namespace app::hw
+
+extern "C" void DMA2_Stream0_IRQHandler(void) {
+  app::hw::DmaQueue *queue = app::hw::dma_stream_queues[0];
+  if (queue) {
+    queue->HandleIRQ();
+  }
+}
+
+extern "C" void DMA2_Stream1_IRQHandler(void) {
+  app::hw::DmaQueue *queue = app::hw::dma_stream_queues[1];
+  if (queue) {
+    queue->HandleIRQ();
+  }
+}
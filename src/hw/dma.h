@@ -4,36 +4,279 @@
 
 #include <mbed.h>
 
+#include "debug/class.h"
+#include "hw/perf_timer.h"
+
 namespace app::hw {
 
-class CopyDMA {
+// Called from the DMA interrupt once a transfer completed (all batches of
+// it), with the context given when it was queued.
+typedef void (*DmaCallback)(void *context);
+
+// Transfers queued per DMA stream at most.
+static const int dma_max_queued = 8;
+
+// Memory-to-memory streams managed, DMA2 Stream0 onwards. Only DMA2 can do
+// memory-to-memory, and its other streams are left for peripherals (the
+// audio SAI uses Stream4 and Stream7).
+static const int dma_num_streams = 2;
+
+// DMA can process only up to 0xFFFF words.
+// Our DMA bursts have 4 word size.
+// (=> num_words must be multiple of 4!)
+// Our LTDC bursts have 64 byte size.
+// LTDC bursts can't cross the 1kB boundary.
+// (=> src_addr/dst_addr should be 64 byte = 16 word multiple!).
+// Highest multiple of 4 and 64 less than 0xFFFF is 0xFFC0.
+static const uint32_t dma_max_batch_words = 0xFFC0;
+
+// Priority of a transfer in the DMA controller's arbitration between
+// streams running at the same time. (Transfers on one stream run in the
+// order queued.)
+enum class DmaPriority {
+  Low,
+  Medium,
+  High,
+  VeryHigh,
+};
+
+// Words per burst, on both the source and the destination side. Longer
+// bursts than 4 words don't fit the FIFO (4 words), with word transfers.
+enum class DmaBurst {
+  Single,
+  Incr4,  // Needs 16 byte aligned addresses, see dma_max_batch_words
+};
+
+// FIFO level at which a burst is written. Incr4 needs Full.
+enum class DmaFifoThreshold {
+  Quarter,
+  Half,
+  ThreeQuarters,
+  Full,
+};
+
+struct DmaOptions {
+  DmaPriority priority;
+  DmaBurst burst;
+  DmaFifoThreshold fifo_threshold;
+};
+
+static const DmaOptions dma_default_options = {
+    DmaPriority::Low,
+    DmaBurst::Single,
+    DmaFifoThreshold::Full,
+};
+
+// Whether the DMA controller allows the combination (see RM0385, FIFO
+// threshold configurations). Transfers with others fail.
+bool dma_options_valid(const DmaOptions &options);
+
+const char *dma_priority_name(DmaPriority priority);
+const char *dma_burst_name(DmaBurst burst);
+const char *dma_fifo_threshold_name(DmaFifoThreshold threshold);
+
+// A queued transfer: its stream, and its number there (counting from 1,
+// 0 if it could not be queued).
+struct DmaTicket {
+  int stream;
+  uint32_t number;
+};
+
+struct DmaStreamStats {
+  uint32_t transfers;    // Completed
+  uint64_t words;        // Transferred
+  uint64_t busy_cycles;  // With transfers queued
+  uint32_t max_queued;   // Transfers at once
+  uint32_t fifo_errors;  // Not fatal, the transfer went on
+};
+
+// Memory-to-memory transfers on a DMA stream, queued and completed by
+// interrupt.
+//
+// Transfers run in the order queued. Each runs in batches of up to
+// dma_max_batch_words: the transfer complete interrupt starts the next
+// batch, or the next transfer, so the CPU is free meanwhile. Queueing
+// returns a ticket, which can be waited for (sleeping, not polling), and
+// the transfer's callback runs in the interrupt once it completed.
+//
+// Each transfer is either a copy or a fill, and has its own options. The
+// stream is set up again when these change from one transfer to the next.
+//
+// One thread queues at a time (see DmaManager), the interrupt is the only
+// other user.
+class DmaQueue {
  private:
+  struct Transfer {
+    uintptr_t src_addr;
+    uintptr_t dst_addr;
+    uint32_t num_words;  // Left, including the running batch
+    bool fill;           // Of dst with the word at src
+    DmaOptions options;
+    DmaCallback callback;
+    void *context;
+  };
+
+  PerfTimer *perf_timer = nullptr;
   DMA_HandleTypeDef handle = {0};
+  IRQn_Type irqn;
+
+  // Transfer n (counting from 1, the ticket) is in slot n % dma_max_queued.
+  // Transfers submitted - completed are queued, the oldest one runs.
+  Transfer transfers[dma_max_queued];
+  volatile uint32_t submitted = 0;
+  volatile uint32_t completed = 0;
+  volatile uint32_t batch_words = 0;   // Of the running batch
+  volatile uint32_t queued_words = 0;  // Left of all queued transfers
+  volatile uint32_t errors = 0;
+
+  // Flag n % dma_max_queued is set once transfer n completed, until the
+  // slot is reused, so that any number of threads can wait
+  EventFlags event_flags;
+
+  DmaStreamStats stats = {};
+  uint32_t busy_since = 0;
 
-  int CopyMax65kWordsUnsafe(uint32_t src_addr,
-                            uint32_t dst_addr,
-                            uint32_t num_words);
+  int Configure(const Transfer &transfer);
+  void StartBatch();
+  void FinishTransfer();
+  void HandleTransferComplete();
+  void HandleTransferError();
+  static void TransferCompleteCallback(DMA_HandleTypeDef *hdma);
+  static void TransferErrorCallback(DMA_HandleTypeDef *hdma);
 
  public:
-  CopyDMA();
+  int Init(DMA_Stream_TypeDef *stream, IRQn_Type irqn, PerfTimer &perf_timer);
 
-  int Init();
+  // Queues a transfer of num_words (a multiple of 4, see
+  // dma_max_batch_words). Returns its ticket, or 0 if the queue is full.
+  uint32_t Submit(
+      uintptr_t src_addr,
+      uintptr_t dst_addr,
+      uint32_t num_words,
+      bool fill,
+      const DmaOptions &options,
+      DmaCallback callback,
+      void *context);
+
+  // Whether the transfer with this ticket completed. Transfers complete in
+  // order, so all before it did too.
+  bool IsComplete(uint32_t ticket);
+
+  // Waits until the transfer with this ticket completed. Not from
+  // interrupts.
+  void Wait(uint32_t ticket);
 
-  int CopyWordsUnsafe(uint32_t src_addr, uint32_t dst_addr, uint32_t num_words);
+  // Waits until all transfers queued so far completed.
+  void WaitAll();
+
+  // Words queued but not transferred yet.
+  uint32_t GetQueuedWords();
+
+  // Transfers that failed (and were skipped) so far.
+  uint32_t GetErrors();
+
+  DmaStreamStats GetStats();
+  void ResetStats();
+
+  // Called by the stream's interrupt handler.
+  void HandleIRQ();
 };
 
-class ZeroDMA {
+// Owns the memory-to-memory DMA streams and hands them out per transfer.
+//
+// Each transfer goes to the stream with the fewest words queued, so that
+// e.g. a clear runs in parallel to a copy rather than after it. Queueing is
+// serialized by a mutex, so any thread may queue (not interrupts, though).
+// The transfer's priority then decides how the DMA controller shares the
+// memory bandwidth between the streams.
+//
+// Transfers with invalid options, or with bursts but addresses or lengths
+// not aligned to them, fail (see GetErrors()).
+class DmaManager {
  private:
-  DMA_HandleTypeDef handle = {0};
+  app::debug::Debug &dbg;
+  PerfTimer &perf_timer;
+
+  DmaQueue queues[dma_num_streams];
+  Mutex mutex;
 
-  int ZeroMax65kWordsUnsafe(uint32_t dst_addr, uint32_t num_words);
+  uint32_t stats_since = 0;
 
  public:
-  ZeroDMA();
+  DmaManager(app::debug::Debug &dbg, PerfTimer &perf_timer);
 
   int Init();
 
-  int ZeroWordsUnsafe(uint32_t dst_addr, uint32_t num_words);
+  // Queues a copy (or fill, with the word at src_addr) on the least busy
+  // stream. The ticket's number is 0 if all streams' queues are full.
+  DmaTicket Submit(
+      uintptr_t src_addr,
+      uintptr_t dst_addr,
+      uint32_t num_words,
+      bool fill,
+      const DmaOptions &options,
+      DmaCallback callback,
+      void *context);
+
+  bool IsComplete(DmaTicket ticket);
+  void Wait(DmaTicket ticket);
+  void WaitAll();
+
+  // Transfers that failed (and were skipped) so far, on all streams.
+  uint32_t GetErrors();
+
+  // Since the last reset. Utilisation is busy_cycles / GetStatsCycles().
+  DmaStreamStats GetStats(int stream);
+  uint32_t GetStatsCycles();
+  void ResetStats();
+  void Report();
+};
+
+class CopyDMA {
+ private:
+  DmaManager &manager;
+  DmaOptions options;
+
+ public:
+  CopyDMA(
+      DmaManager &manager, const DmaOptions &options = dma_default_options);
+
+  // Queues a copy, see DmaManager::Submit().
+  DmaTicket CopyWordsAsync(
+      uintptr_t src_addr,
+      uintptr_t dst_addr,
+      uint32_t num_words,
+      DmaCallback callback = nullptr,
+      void *context = nullptr);
+
+  // Copies and waits for it.
+  int CopyWordsUnsafe(uintptr_t src_addr,
+                      uintptr_t dst_addr,
+                      uint32_t num_words);
+
+  DmaManager &GetManager();
+};
+
+class ZeroDMA {
+ private:
+  DmaManager &manager;
+  DmaOptions options;
+
+ public:
+  ZeroDMA(
+      DmaManager &manager, const DmaOptions &options = dma_default_options);
+
+  // Queues zeroing, see DmaManager::Submit().
+  DmaTicket ZeroWordsAsync(
+      uintptr_t dst_addr,
+      uint32_t num_words,
+      DmaCallback callback = nullptr,
+      void *context = nullptr);
+
+  // Zeroes and waits for it.
+  int ZeroWordsUnsafe(uintptr_t dst_addr, uint32_t num_words);
+
+  DmaManager &GetManager();
 };
 
 }  // namespace app::hw
@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <arm_math.h>
+
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_audio.h"
+
+#include "debug/counter.h"
+#include "debug/macros.h"
+
+#include "hw/volatile_buffer.h"
+
+#include "player.h"
+
+namespace app::hw {
+
+Player::Player(
+    app::debug::Debug &dbg,
+    VolatileBuffer<app::structs::Complex<int16_t>> &audio_out_buf)
+    : dbg(dbg),
+      buffer(audio_out_buf),
+      underrun_counter(dbg, "audio_out_underrun"),
+      overrun_counter(dbg, "audio_out_overrun") {
+}
+
+int Player::Init() {
+  // Sets up the SAI transmitter and its DMA. The codec setup is redone by
+  // BSP_AUDIO_IN_InitEx(), with the headphone output enabled alongside the
+  // line input (the transmitter clocks the receiver).
+  if (AUDIO_OK != BSP_AUDIO_OUT_Init(
+                      OUTPUT_DEVICE_HEADPHONE,
+                      player_default_volume,
+                      AUDIO_FREQUENCY_48K)) {
+    return 1;
+  }
+  return 0;
+}
+
+int Player::Start() {
+  const uint32_t size =
+      2 * player_block_samples * sizeof(app::structs::Complex<int16_t>);
+  crash_if(dbg, size > buffer.size);
+
+  write_count = 0;
+  read_count = 0;
+  primed = false;
+  memset((void *)buffer.Data(), 0, size);
+
+  // Size in bytes, unlike BSP_AUDIO_IN_Record()
+  if (AUDIO_OK != BSP_AUDIO_OUT_Play((uint16_t *)buffer.addr, size)) {
+    return 1;
+  }
+  return Unmute();
+}
+
+int Player::SetVolume(unsigned int percent) {
+  if (percent > 100) {
+    return 1;
+  }
+  if (AUDIO_OK != BSP_AUDIO_OUT_SetVolume(percent)) {
+    return 1;
+  }
+  return 0;
+}
+
+int Player::SetBurst(unsigned int samples) {
+  unsigned int blocks =
+      (samples + player_block_samples - 1) / player_block_samples;
+  if (blocks > (unsigned int)player_max_burst_blocks) {
+    return 1;
+  }
+  prime_blocks = blocks + 1;
+  return 0;
+}
+
+int Player::Unmute() {
+  if (AUDIO_OK != BSP_AUDIO_OUT_SetMute(AUDIO_MUTE_OFF)) {
+    return 1;
+  }
+  return 0;
+}
+
+int Player::Write(const float32_t *src) {
+  const uint32_t n = write_count;
+  if (n - read_count >= (uint32_t)player_queue_blocks) {
+    overrun_counter.Increment();
+    return 1;
+  }
+
+  int16_t *dst = queue[n % player_queue_blocks];
+  for (int i = 0; i < player_block_samples; i++) {
+    float32_t x = src[i];
+    x = x > INT16_MAX ? INT16_MAX : x;
+    x = x < INT16_MIN ? INT16_MIN : x;
+    dst[i] = (int16_t)x;
+  }
+  write_count = n + 1;
+  return 0;
+}
+
+uint32_t Player::GetQueued() {
+  return write_count - read_count;
+}
+
+uint32_t Player::GetUnderruns() {
+  return underrun_counter.GetValue();
+}
+
+uint32_t Player::GetOverruns() {
+  return overrun_counter.GetValue();
+}
+
+void Player::HandleHalf(volatile app::structs::Complex<int16_t> *half) {
+  const uint32_t n = read_count;
+  const uint32_t queued = write_count - n;
+  if (!primed && queued >= prime_blocks) {
+    primed = true;
+  }
+  if (!primed || queued == 0) {
+    if (primed) {
+      primed = false;
+      underrun_counter.Increment();
+    }
+    memset((void *)half, 0, player_block_samples * sizeof(*half));
+    return;
+  }
+
+  // Mono to both channels
+  const int16_t *src = queue[n % player_queue_blocks];
+  for (int i = 0; i < player_block_samples; i++) {
+    half[i].real = src[i];
+    half[i].imag = src[i];
+  }
+  read_count = n + 1;
+}
+
+// The half that just completed is refilled while the other one plays
+void Player::HandleHalfTransferComplete() {
+  HandleHalf(&buffer.Data()[0]);
+}
+
+void Player::HandleTransferComplete() {
+  HandleHalf(&buffer.Data()[player_block_samples]);
+}
+
+}  // namespace app::hw
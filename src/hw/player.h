@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <arm_math.h>
+
+#include "debug/counter.h"
+#include "hw/recorder.h"
+#include "hw/volatile_buffer.h"
+#include "structs/complex.h"
+
+namespace app::hw {
+
+// Samples per half of the playback buffer, and per Write()
+static const int player_block_samples = 512;
+
+// Blocks written at once at most, i.e. per hop of the recorder, and the
+// queue between Write() and the ISR. Playback starts with at most two bursts
+// queued, and a late burst only catches up to that, so two bursts and a
+// little slack suffice.
+static const int player_max_burst_blocks =
+    recorder_max_num_samples / player_block_samples;
+static const int player_queue_blocks = 2 * player_max_burst_blocks + 2;
+
+static const int player_default_volume = 70;  // Percent
+
+// Plays mono audio on the headphone output, at the recorder's sample rate.
+//
+// The DMA plays a circular buffer of two halves of player_block_samples
+// stereo frames, like the recorder. As each half completes, the ISR refills
+// it from a queue of blocks written by Write(), or with silence if the queue
+// ran dry (an underrun). Playback starts (and restarts after running dry)
+// once a burst and one more block are queued, which absorbs the writer's
+// jitter. One writer thread, and the ISR as the only reader.
+class Player {
+ private:
+  app::debug::Debug &dbg;
+
+  // Two halves of player_block_samples frames
+  VolatileBuffer<app::structs::Complex<int16_t>> &buffer;
+
+  // Blocks written and played, block n is in slot n % player_queue_blocks
+  int16_t queue[player_queue_blocks][player_block_samples];
+  volatile uint32_t write_count = 0;
+  volatile uint32_t read_count = 0;
+  volatile uint32_t prime_blocks = 2;
+  bool primed = false;  // Playing from the queue, only used by the ISR
+
+  app::debug::Counter underrun_counter;  // Queue ran dry while playing
+  app::debug::Counter overrun_counter;   // Blocks dropped by Write()
+
+  void HandleHalf(volatile app::structs::Complex<int16_t> *half);
+
+ public:
+  Player(
+      app::debug::Debug &dbg,
+      VolatileBuffer<app::structs::Complex<int16_t>> &audio_out_buf);
+
+  // Sets up the output. Must precede the recorder's Init(), which sets up
+  // the codec for line in and headphone out together.
+  int Init();
+
+  // Starts playing (silence at first). After the recorder's Init().
+  int Start();
+
+  int SetVolume(unsigned int percent);
+
+  // Samples written at once, e.g. the recorder's hop.
+  int SetBurst(unsigned int samples);
+
+  // Unmutes, e.g. after the recorder restarted (which mutes the codec).
+  int Unmute();
+
+  // Queues player_block_samples samples (at int16 scale, saturated) for
+  // playback on both channels. Returns 1 if the queue is full, dropping
+  // the block.
+  int Write(const float32_t *src);
+
+  // Blocks queued and not played yet.
+  uint32_t GetQueued();
+
+  uint32_t GetUnderruns();
+  uint32_t GetOverruns();
+
+  void HandleHalfTransferComplete();
+  void HandleTransferComplete();
+};
+
+}  // namespace app::hw
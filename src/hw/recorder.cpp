@@ -1,4 +1,7 @@
+#include <math.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <arm_math.h>
 
@@ -8,18 +11,28 @@
 #include "debug/macros.h"
 
 #include "hw/volatile_buffer.h"
+#include "math/window.h"
 
 #include "recorder.h"
 
-namespace app::hw {
+extern SAI_HandleTypeDef haudio_in_sai;
 
-static const uint32_t LOWER_HALF_READABLE_BIT = 1 << 0;
-static const uint32_t UPPER_HALF_READABLE_BIT = 1 << 1;
-static const uint32_t BOTH_HALF_READABLE_BITS =
-    LOWER_HALF_READABLE_BIT | UPPER_HALF_READABLE_BIT;
+namespace app::hw {
 
 extern "C" void EXTI15_10_IRQHandler(void);
 
+const char *recorder_input_name(RecorderInput input) {
+  switch (input) {
+    case RecorderInput::IQ:
+      return "iq";
+    case RecorderInput::Left:
+      return "left";
+    case RecorderInput::Right:
+      return "right";
+  }
+  return "?";
+}
+
 Recorder::Recorder(
     app::debug::Debug &dbg,
     VolatileBuffer<app::structs::Complex<int16_t>> &audio_buf,
@@ -27,10 +40,10 @@ Recorder::Recorder(
     app::debug::Counter &late_audio_read_counter)
     : dbg(dbg),
       buffer(audio_buf),
-      lower_half_buffer(audio_buf.LowerHalf()),
-      upper_half_buffer(audio_buf.UpperHalf()),
+      ring((const uint32_t *)audio_buf.addr),
       missed_audio_counter(missed_audio_counter),
       late_audio_read_counter(late_audio_read_counter) {
+  SetWindow(window);
 }
 
 int Recorder::Init() {
@@ -43,9 +56,7 @@ int Recorder::Init() {
     return 1;
   }
 
-  if (AUDIO_OK !=
-      BSP_AUDIO_IN_Record(
-          (uint16_t *)buffer.addr, dma_double_buffer_num_halfwords)) {
+  if (0 != StartRecording()) {
     return 1;
   }
 
@@ -56,65 +67,690 @@ int Recorder::Init() {
   NVIC_ClearPendingIRQ(irqn);
   NVIC_DisableIRQ(irqn);
   NVIC_SetPriority(irqn, AUDIO_IN_IRQ_PREPRIO);
-  NVIC_SetVector(irqn, (uint32_t)EXTI15_10_IRQHandler);
+  NVIC_SetVector(irqn, (uintptr_t)EXTI15_10_IRQHandler);
   NVIC_EnableIRQ(irqn);
 
   return 0;
 }
 
-app::structs::Complex<float32_t> *Recorder::Read() {
-  // Atomically read state and clear both bits
-  uint32_t bit = __sync_fetch_and_and(&dma_state, ~BOTH_HALF_READABLE_BITS);
-
-  // If one and only one of the bits is set, return corresponding buffer
-  volatile app::structs::Complex<int16_t> *b;
-  switch (bit) {
-    case LOWER_HALF_READABLE_BIT:
-      b = lower_half_buffer.Data();
-      break;
-    case UPPER_HALF_READABLE_BIT:
-      b = upper_half_buffer.Data();
-      break;
-    default:
-      return nullptr;  // Nothing available yet
+// The DMA's interrupts, raised through the BSP's callbacks as its own
+// would be.
+static void HandleDmaMemory0Complete(DMA_HandleTypeDef *) {
+  BSP_AUDIO_IN_HalfTransfer_CallBack();
+}
+
+static void HandleDmaMemory1Complete(DMA_HandleTypeDef *) {
+  BSP_AUDIO_IN_TransferComplete_CallBack();
+}
+
+static void HandleDmaError(DMA_HandleTypeDef *) {
+  BSP_AUDIO_IN_Error_Callback();
+}
+
+// Like BSP_AUDIO_IN_Record() (i.e. HAL_SAI_Receive_DMA()), but in double
+// buffer mode, into the first two slots of the ring.
+int Recorder::StartRecording() {
+  crash_if(dbg, ring_samples * sizeof(uint32_t) > buffer.size);
+
+  SAI_HandleTypeDef *sai = &haudio_in_sai;
+  DMA_HandleTypeDef *dma = sai->hdmarx;
+  if (sai->State != HAL_SAI_STATE_READY) {
+    return 1;
+  }
+  dma->XferCpltCallback = HandleDmaMemory0Complete;
+  dma->XferM1CpltCallback = HandleDmaMemory1Complete;
+  dma->XferHalfCpltCallback = nullptr;
+  dma->XferM1HalfCpltCallback = nullptr;
+  dma->XferErrorCallback = HandleDmaError;
+
+  // In half words, one per channel
+  const uint32_t length = 2 * hop_samples;
+  if (HAL_OK != HAL_DMAEx_MultiBufferStart_IT(
+                    dma,
+                    (uintptr_t)&sai->Instance->DR,
+                    GetSlotAddr(0),
+                    GetSlotAddr(1),
+                    length)) {
+    return 1;
+  }
+  sai->State = HAL_SAI_STATE_BUSY_RX;  // So that BSP_AUDIO_IN_Stop() stops it
+  if (!(sai->Instance->CR1 & SAI_xCR1_SAIEN)) {
+    __HAL_SAI_ENABLE(sai);
+  }
+  sai->Instance->CR1 |= SAI_xCR1_DMAEN;
+
+  return 0;
+}
+
+int Recorder::Configure(
+    int new_num_samples,
+    int new_overlap,
+    RecorderInput new_input,
+    int new_taps) {
+  if (!app::math::is_valid_fft_len(new_num_samples)) {
+    return 1;
+  }
+  if (new_overlap < 1 || new_overlap > recorder_max_overlap ||
+      (new_overlap & (new_overlap - 1)) != 0) {
+    return 1;
+  }
+  if (new_taps < 1 || new_taps > recorder_max_taps ||
+      new_taps * new_num_samples > recorder_max_num_samples ||
+      (new_taps > 1 && new_input != RecorderInput::IQ)) {
+    return 1;
+  }
+
+  // The frame, the DMA's two and the slack, rounded up to a power of two
+  const int new_hop_samples = new_num_samples / new_overlap;
+  const int new_frame_segments = new_taps * new_overlap;
+  int new_num_segments = recorder_min_ring_samples / new_hop_samples;
+  while (new_num_segments < new_frame_segments + 2 + recorder_slack_segments) {
+    new_num_segments *= 2;
+  }
+  if (new_num_segments > recorder_max_segments ||
+      new_num_segments * new_hop_samples > recorder_ring_samples) {
+    return 1;
+  }
+
+  if (AUDIO_OK != BSP_AUDIO_IN_Stop(CODEC_PDWN_SW)) {
+    return 1;
+  }
+
+  // No more interrupts, so no need for atomics. Consumers read the
+  // bookkeeping under the lock, so it's reset as a whole.
+  blocks_mutex.lock();
+  input = new_input;
+  num_samples = new_num_samples;
+  overlap = new_overlap;
+  hop_samples = new_hop_samples;
+  taps = new_taps;
+  frame_segments = new_frame_segments;
+  num_segments = new_num_segments;
+  ring_samples = num_segments * hop_samples;
+  write_begin_seq = 2;
+  write_seq = 0;
+  read_seq = 0;
+  contiguous = 0;
+  dropped = 0;
+  skipped = 0;
+  gaps = 0;
+  drop_end_seq = 0;
+  last_read_seq = 0;
+  last_read_stamp = 0;
+  for (int i = 0; i < num_consumers; i++) {
+    consumers[i] = Consumer{};
+  }
+  for (int i = 0; i < recorder_num_blocks; i++) {
+    block_valid[i] = false;
+  }
+  blocks_mutex.unlock();
+  SetWindow(window);
+
+  return StartRecording();
+}
+
+RecorderInput Recorder::GetInput() {
+  return input;
+}
+
+int Recorder::GetNumSamples() {
+  return num_samples;
+}
+
+int Recorder::GetOverlap() {
+  return overlap;
+}
+
+int Recorder::GetHopSamples() {
+  return hop_samples;
+}
+
+int Recorder::GetTaps() {
+  return taps;
+}
+
+void Recorder::SetWindow(app::math::Window new_window) {
+  window = new_window;
+  if (taps > 1) {
+    app::math::make_polyphase_window(window, window_table, num_samples, taps);
+  } else {
+    app::math::make_window(window, window_table, num_samples);
   }
 
-  // Copy data out of buffer (and do float conversion)
+  float32_t max = 0;
+  int32_t max_q12 = 0;
   for (int i = 0; i < num_samples; i++) {
-    sig_buffer[i].real = b[i].real;
-    sig_buffer[i].imag = b[i].imag;
+    window_table_q12[i] = lrintf(window_table[i] * 4096);
+    max = window_table[i] > max ? window_table[i] : max;
+    max_q12 = window_table_q12[i] > max_q12 ? window_table_q12[i] : max_q12;
+  }
+  window_table_bits = 0;
+  while (max > (1 << window_table_bits)) {
+    window_table_bits++;
+  }
+  window_table_q12_bits = 32 - __builtin_clz(max_q12 | 1);
+}
+
+app::math::Window Recorder::GetWindow() {
+  return window;
+}
+
+const float32_t *Recorder::GetWindowTable() {
+  return window_table;
+}
+
+app::structs::Complex<float32_t> *Recorder::GetFrameBuffer() {
+  return sig_buffer.f32;
+}
+
+bool Recorder::HasPending() {
+  return write_seq != read_seq;
+}
+
+int Recorder::GetNumSegments() {
+  return num_segments;
+}
+
+uint32_t Recorder::GetSegmentsRecorded() {
+  return write_seq;
+}
+
+uint32_t Recorder::GetSegmentsRead() {
+  return read_seq - dropped - skipped;
+}
+
+uint32_t Recorder::GetSegmentsDropped() {
+  return dropped;
+}
+
+uint32_t Recorder::GetSegmentsSkipped() {
+  return skipped;
+}
+
+uint32_t Recorder::GetGaps() {
+  return gaps;
+}
+
+uint32_t Recorder::GetLastReadSeq() {
+  return last_read_seq;
+}
+
+uint32_t Recorder::GetLastReadStamp() {
+  return last_read_stamp;
+}
+
+// Takes the oldest unread segment. If the reader fell too far behind, the
+// segments about to be overwritten are dropped first: a frame reaches back
+// frame_segments - 1 segments, the DMA owns the two slots after the newest
+// segment, and may complete one more segment and take its next slot
+// meanwhile.
+bool Recorder::BeginSegment(uint32_t *seq) {
+  const uint32_t pending = write_seq - read_seq;
+  if (pending == 0) {
+    return false;
+  }
+  const uint32_t max_pending = num_segments - frame_segments - 2;
+  if (pending > max_pending) {
+    const uint32_t n = pending - max_pending;
+    missed_audio_counter.Add(n);
+    Drop(read_seq, n);
+    read_seq += n;
   }
 
-  // Clear bit to indicate comleted buffer read
-  uint32_t state = __sync_and_and_fetch(&dma_state, ~bit);
+  *seq = read_seq++;
+  contiguous += contiguous < num_segments;
+  last_read_seq = *seq;
+  last_read_stamp = stamps[*seq & (num_segments - 1)];
+  return true;
+}
+
+// Skipped segments stay in the ring, so unlike dropped ones they don't
+// break the contiguous samples a frame needs.
+uint32_t Recorder::Skip(uint32_t keep) {
+  const uint32_t pending = write_seq - read_seq;
+  if (pending <= keep) {
+    return 0;
+  }
+  const uint32_t n = pending - keep;
+  read_seq += n;
+  skipped += n;
+  contiguous = contiguous + n < (uint32_t)num_segments ? contiguous + n
+                                                        : num_segments;
+  return n;
+}
 
-  // Check for missed deadline (we may have been called too late)
-  if (state != 0) {
+// Checks that the DMA didn't start overwriting the oldest segment read,
+// i.e. its slot, since BeginSegment().
+bool Recorder::EndSegment(uint32_t first_seq) {
+  if (write_begin_seq - first_seq > (uint32_t)num_segments) {
     late_audio_read_counter.Increment();
-    return nullptr;  // Data potentially corrupted, so discard
+    Drop(read_seq - 1, 1);  // Only the newest wasn't used yet
+    return false;
   }
+  return true;
+}
 
-  return sig_buffer;
+void Recorder::Drop(uint32_t first_seq, uint32_t n) {
+  if (first_seq != drop_end_seq || dropped == 0) {
+    gaps++;
+  }
+  drop_end_seq = first_seq + n;
+  dropped += n;
+  contiguous = 0;
 }
 
-void Recorder::HandleAudioInError() {
-  crash(dbg);
+bool Recorder::BeginFrame(Frame *frame) {
+  uint32_t seq;
+  if (!BeginSegment(&seq)) {
+    return false;
+  }
+  if (contiguous < frame_segments) {
+    return false;  // Not enough contiguous samples yet
+  }
+
+  // The frame's segments are contiguous in the ring, unless it wraps
+  const uint32_t first_seq = seq - (frame_segments - 1);
+  const int start = (first_seq & (num_segments - 1)) * hop_samples;
+  const int len = ring_samples - start;
+  const int frame_len = taps * num_samples;
+  frame->src[0] = &ring[start];
+  frame->len[0] = len < frame_len ? len : frame_len;
+  frame->src[1] = ring;
+  frame->len[1] = frame_len - frame->len[0];
+  frame->first_seq = first_seq;
+  return true;
+}
+
+bool Recorder::EndFrame(const Frame &frame) {
+  return EndSegment(frame.first_seq);
 }
 
-void Recorder::HandleHalfTransferComplete() {
-  if (READ_BIT(dma_state, UPPER_HALF_READABLE_BIT)) {
-    missed_audio_counter.Increment();
+// Number of bits needed for the magnitude of the largest I or Q sample.
+static int BlockBits(const uint32_t *src, int num_samples) {
+  uint32_t acc = 0;
+  for (int i = 0; i < num_samples; i++) {
+    uint32_t s = src[i];
+    acc |= abs((int16_t)(s & 0xFFFF)) | abs((int16_t)(s >> 16));
+  }
+  return 32 - __builtin_clz(acc | 1);
+}
+
+// Float conversion and windowing in the same pass. Reads one I/Q pair per
+// word, unrolled by 4.
+static inline void ConvertF32(
+    const uint32_t *src, const float32_t *w, float32_t *dst, int n) {
+  for (int i = 0; i < n; i += 4) {
+    uint32_t s0 = src[i + 0];
+    uint32_t s1 = src[i + 1];
+    uint32_t s2 = src[i + 2];
+    uint32_t s3 = src[i + 3];
+    dst[2 * i + 0] = (int16_t)(s0 & 0xFFFF) * w[i + 0];
+    dst[2 * i + 1] = (int16_t)(s0 >> 16) * w[i + 0];
+    dst[2 * i + 2] = (int16_t)(s1 & 0xFFFF) * w[i + 1];
+    dst[2 * i + 3] = (int16_t)(s1 >> 16) * w[i + 1];
+    dst[2 * i + 4] = (int16_t)(s2 & 0xFFFF) * w[i + 2];
+    dst[2 * i + 5] = (int16_t)(s2 >> 16) * w[i + 2];
+    dst[2 * i + 6] = (int16_t)(s3 & 0xFFFF) * w[i + 3];
+    dst[2 * i + 7] = (int16_t)(s3 >> 16) * w[i + 3];
+  }
+}
+
+// Like ConvertF32(), adding to dst, for folding polyphase taps.
+static inline void ConvertF32Add(
+    const uint32_t *src, const float32_t *w, float32_t *dst, int n) {
+  for (int i = 0; i < n; i += 4) {
+    uint32_t s0 = src[i + 0];
+    uint32_t s1 = src[i + 1];
+    uint32_t s2 = src[i + 2];
+    uint32_t s3 = src[i + 3];
+    dst[2 * i + 0] += (int16_t)(s0 & 0xFFFF) * w[i + 0];
+    dst[2 * i + 1] += (int16_t)(s0 >> 16) * w[i + 0];
+    dst[2 * i + 2] += (int16_t)(s1 & 0xFFFF) * w[i + 1];
+    dst[2 * i + 3] += (int16_t)(s1 >> 16) * w[i + 1];
+    dst[2 * i + 4] += (int16_t)(s2 & 0xFFFF) * w[i + 2];
+    dst[2 * i + 5] += (int16_t)(s2 >> 16) * w[i + 2];
+    dst[2 * i + 6] += (int16_t)(s3 & 0xFFFF) * w[i + 3];
+    dst[2 * i + 7] += (int16_t)(s3 >> 16) * w[i + 3];
+  }
+}
+
+// Like ConvertF32(), without a window.
+static inline void ConvertRaw(const uint32_t *src, float32_t *dst, int n) {
+  for (int i = 0; i < n; i += 4) {
+    uint32_t s0 = src[i + 0];
+    uint32_t s1 = src[i + 1];
+    uint32_t s2 = src[i + 2];
+    uint32_t s3 = src[i + 3];
+    dst[2 * i + 0] = (int16_t)(s0 & 0xFFFF);
+    dst[2 * i + 1] = (int16_t)(s0 >> 16);
+    dst[2 * i + 2] = (int16_t)(s1 & 0xFFFF);
+    dst[2 * i + 3] = (int16_t)(s1 >> 16);
+    dst[2 * i + 4] = (int16_t)(s2 & 0xFFFF);
+    dst[2 * i + 5] = (int16_t)(s2 >> 16);
+    dst[2 * i + 6] = (int16_t)(s3 & 0xFFFF);
+    dst[2 * i + 7] = (int16_t)(s3 >> 16);
+  }
+}
+
+// Like ConvertF32(), for one channel: the half word at shift (0 or 16).
+static inline void ConvertReal(
+    const uint32_t *src, const float32_t *w, float32_t *dst, int n, int shift) {
+  for (int i = 0; i < n; i += 4) {
+    dst[i + 0] = (int16_t)(src[i + 0] >> shift) * w[i + 0];
+    dst[i + 1] = (int16_t)(src[i + 1] >> shift) * w[i + 1];
+    dst[i + 2] = (int16_t)(src[i + 2] >> shift) * w[i + 2];
+    dst[i + 3] = (int16_t)(src[i + 3] >> shift) * w[i + 3];
+  }
+}
+
+// Integer multiply, shift and store in a single pass, unrolled by 2.
+static inline void ConvertQ15(
+    const uint32_t *src,
+    const int16_t *w,
+    q15_t *dst,
+    int n,
+    int pre_shift,
+    int post_shift) {
+  for (int i = 0; i < n; i += 2) {
+    uint32_t s0 = src[i + 0];
+    uint32_t s1 = src[i + 1];
+    int32_t w0 = w[i + 0];
+    int32_t w1 = w[i + 1];
+    dst[2 * i + 0] = ((int16_t)(s0 & 0xFFFF) * w0 << pre_shift) >> post_shift;
+    dst[2 * i + 1] = ((int16_t)(s0 >> 16) * w0 << pre_shift) >> post_shift;
+    dst[2 * i + 2] = ((int16_t)(s1 & 0xFFFF) * w1 << pre_shift) >> post_shift;
+    dst[2 * i + 3] = ((int16_t)(s1 >> 16) * w1 << pre_shift) >> post_shift;
+  }
+}
+
+// The window is applied in float, which has the same precision as the
+// float path, then converted. Unrolled by 2.
+static inline void ConvertQ31(
+    const uint32_t *src,
+    const float32_t *w,
+    float32_t scale,
+    q31_t *dst,
+    int n) {
+  for (int i = 0; i < n; i += 2) {
+    uint32_t s0 = src[i + 0];
+    uint32_t s1 = src[i + 1];
+    float32_t w0 = w[i + 0] * scale;
+    float32_t w1 = w[i + 1] * scale;
+    dst[2 * i + 0] = (q31_t)((int16_t)(s0 & 0xFFFF) * w0);
+    dst[2 * i + 1] = (q31_t)((int16_t)(s0 >> 16) * w0);
+    dst[2 * i + 2] = (q31_t)((int16_t)(s1 & 0xFFFF) * w1);
+    dst[2 * i + 3] = (q31_t)((int16_t)(s1 >> 16) * w1);
+  }
+}
+
+app::structs::Complex<float32_t> *Recorder::Read() {
+  Frame frame;
+  if (!BeginFrame(&frame)) {
+    return nullptr;
+  }
+
+  // The first tap is stored, the others added. Runs split where taps start
+  // and where the ring wraps, both multiples of the unrolling.
+  float32_t *dst = (float32_t *)sig_buffer.f32;
+  for (int seg = 0, pos = 0; seg < 2; seg++) {
+    const uint32_t *src = frame.src[seg];
+    for (int len = frame.len[seg]; len > 0;) {
+      const int i = pos & (num_samples - 1);
+      const int n = num_samples - i < len ? num_samples - i : len;
+      if (pos < num_samples) {
+        ConvertF32(src, &window_table[pos], &dst[2 * i], n);
+      } else {
+        ConvertF32Add(src, &window_table[pos], &dst[2 * i], n);
+      }
+      src += n;
+      len -= n;
+      pos += n;
+    }
+  }
+
+  if (!EndFrame(frame)) {
+    return nullptr;
+  }
+
+  return sig_buffer.f32;
+}
+
+app::structs::Complex<q15_t> *Recorder::ReadQ15(int *exponent) {
+  crash_if(dbg, taps != 1);
+  Frame frame;
+  if (!BeginFrame(&frame)) {
+    return nullptr;
+  }
+
+  // Scale so that the largest possible windowed sample just fits.
+  // Products fit in 31 bits (16 bit sample, 15 bit window), so they can be
+  // shifted in either direction without overflow.
+  const int bits0 = BlockBits(frame.src[0], frame.len[0]);
+  const int bits1 = BlockBits(frame.src[1], frame.len[1]);
+  const int bits = bits0 > bits1 ? bits0 : bits1;
+  const int shift = bits + window_table_q12_bits - 15;
+  const int pre_shift = shift < 0 ? -shift : 0;
+  const int post_shift = shift > 0 ? shift : 0;
+  *exponent = 12 - shift;
+
+  q15_t *dst = (q15_t *)sig_buffer.q15;
+  for (int seg = 0, i = 0; seg < 2; i += frame.len[seg++]) {
+    ConvertQ15(
+        frame.src[seg],
+        &window_table_q12[i],
+        &dst[2 * i],
+        frame.len[seg],
+        pre_shift,
+        post_shift);
+  }
+
+  if (!EndFrame(frame)) {
+    return nullptr;
   }
-  CLEAR_BIT(dma_state, UPPER_HALF_READABLE_BIT);
-  SET_BIT(dma_state, LOWER_HALF_READABLE_BIT);
+
+  return sig_buffer.q15;
+}
+
+app::structs::Complex<q31_t> *Recorder::ReadQ31(int *exponent) {
+  crash_if(dbg, taps != 1);
+  Frame frame;
+  if (!BeginFrame(&frame)) {
+    return nullptr;
+  }
+
+  // Scale so that the largest possible windowed sample just fits, leaving
+  // one bit of headroom for rounding of the float product.
+  const int bits0 = BlockBits(frame.src[0], frame.len[0]);
+  const int bits1 = BlockBits(frame.src[1], frame.len[1]);
+  const int bits = bits0 > bits1 ? bits0 : bits1;
+  const int shift = 30 - bits - window_table_bits;
+  const float32_t scale = ldexpf(1.0f, shift);
+  *exponent = shift;
+
+  q31_t *dst = (q31_t *)sig_buffer.q31;
+  for (int seg = 0, i = 0; seg < 2; i += frame.len[seg++]) {
+    ConvertQ31(
+        frame.src[seg], &window_table[i], scale, &dst[2 * i], frame.len[seg]);
+  }
+
+  if (!EndFrame(frame)) {
+    return nullptr;
+  }
+
+  return sig_buffer.q31;
 }
 
-void Recorder::HandleTransferComplete() {
-  if (READ_BIT(dma_state, LOWER_HALF_READABLE_BIT)) {
-    missed_audio_counter.Increment();
+float32_t *Recorder::ReadReal() {
+  Frame frame;
+  if (!BeginFrame(&frame)) {
+    return nullptr;
+  }
+
+  const int shift = input == RecorderInput::Right ? 16 : 0;
+  float32_t *dst = sig_buffer.real;
+  for (int seg = 0, i = 0; seg < 2; i += frame.len[seg++]) {
+    ConvertReal(
+        frame.src[seg], &window_table[i], &dst[i], frame.len[seg], shift);
   }
-  CLEAR_BIT(dma_state, LOWER_HALF_READABLE_BIT);
-  SET_BIT(dma_state, UPPER_HALF_READABLE_BIT);
+
+  if (!EndFrame(frame)) {
+    return nullptr;
+  }
+
+  return sig_buffer.real;
+}
+
+int Recorder::AddConsumer(int *consumer) {
+  blocks_mutex.lock();
+  if (num_consumers >= recorder_max_consumers) {
+    blocks_mutex.unlock();
+    return 1;
+  }
+  *consumer = num_consumers;
+  // Starts with the next block, not with the whole ring
+  const uint32_t written = write_seq * hop_samples;
+  consumers[num_consumers++] =
+      Consumer{written & ~(recorder_block_samples - 1), 0, 0};
+  blocks_mutex.unlock();
+  return 0;
+}
+
+// Converting under the lock keeps the bookkeeping simple. It's a few
+// thousand cycles, and the RTOS mutex inherits priority.
+const RecorderBlock *Recorder::AcquireBlock(int consumer) {
+  blocks_mutex.lock();
+  Consumer &c = consumers[consumer];
+
+  // Samples before written - ring + 2 hops may be overwritten by the DMA
+  // meanwhile (wrapping arithmetic, hops and blocks divide 2^32)
+  const uint32_t written = write_seq * hop_samples;
+  const uint32_t max_lag = ring_samples - 2 * hop_samples;
+  if (written - c.pos > max_lag) {
+    const uint32_t n =
+        (written - c.pos - max_lag + recorder_block_samples - 1) &
+        ~(recorder_block_samples - 1);
+    c.pos += n;
+    c.dropped += n / recorder_block_samples;
+  }
+  if (written - c.pos < (uint32_t)recorder_block_samples) {
+    blocks_mutex.unlock();
+    return nullptr;
+  }
+
+  // Shared if already converted, else into the free block that other
+  // consumers are least likely to need: an invalid one, or the oldest
+  int index = -1;
+  uint32_t index_age = 0;
+  for (int i = 0; i < recorder_num_blocks; i++) {
+    if (block_valid[i] && block_pos[i] == c.pos) {
+      index = i;
+      break;
+    }
+    const uint32_t age = block_valid[i] ? written - block_pos[i] : UINT32_MAX;
+    if (block_refs[i] == 0 && (index < 0 || age > index_age)) {
+      index = i;
+      index_age = age;
+    }
+  }
+  if (index < 0) {
+    blocks_mutex.unlock();
+    return nullptr;  // All referenced, try again after a release
+  }
+
+  RecorderBlock &block = blocks[index];
+  if (!block_valid[index] || block_pos[index] != c.pos) {
+    const int start = c.pos & (ring_samples - 1);
+    ConvertRaw(
+        &ring[start], (float32_t *)block.samples, recorder_block_samples);
+    block.seq = c.pos / recorder_block_samples;
+    block.stamp =
+        stamps[(c.pos + recorder_block_samples - 1) / hop_samples &
+               (num_segments - 1)];
+
+    // The DMA may have started overwriting it
+    if (write_begin_seq * hop_samples - c.pos > (uint32_t)ring_samples) {
+      block_valid[index] = false;
+      c.pos += recorder_block_samples;
+      c.dropped++;
+      blocks_mutex.unlock();
+      return nullptr;
+    }
+    block_pos[index] = c.pos;
+    block_valid[index] = true;
+  }
+
+  block_refs[index]++;
+  c.pos += recorder_block_samples;
+  c.read++;
+  blocks_mutex.unlock();
+  return &block;
+}
+
+void Recorder::ReleaseBlock(const RecorderBlock *block) {
+  blocks_mutex.lock();
+  block_refs[block - blocks]--;
+  blocks_mutex.unlock();
+}
+
+uint32_t Recorder::GetConsumerRead(int consumer) {
+  return consumers[consumer].read;
+}
+
+uint32_t Recorder::GetConsumerDropped(int consumer) {
+  return consumers[consumer].dropped;
+}
+
+uint32_t Recorder::GetConsumerLag(int consumer) {
+  return (write_seq * hop_samples - consumers[consumer].pos) /
+         recorder_block_samples;
+}
+
+const app::structs::Complex<int16_t> *Recorder::ReadRaw(bool *continued) {
+  uint32_t seq;
+  if (!BeginSegment(&seq)) {
+    return nullptr;
+  }
+
+  const int start = (seq & (num_segments - 1)) * hop_samples;
+  memcpy(sig_buffer.raw, &ring[start], hop_samples * sizeof(uint32_t));
+  if (!EndSegment(seq)) {
+    return nullptr;
+  }
+
+  *continued = contiguous > 1;
+  return sig_buffer.raw;
+}
+
+void Recorder::HandleAudioInError() {
+  crash(dbg);
+}
+
+uintptr_t Recorder::GetSlotAddr(uint32_t seq) {
+  const uint32_t slot = seq & (num_segments - 1);
+  return buffer.addr + slot * hop_samples * sizeof(uint32_t);
+}
+
+// Segment seq is complete, in the memory seq % 2, and the DMA went on with
+// seq + 1 in the other. The completed memory is pointed at seq + 2, which
+// the DMA starts on as soon as seq + 1 completes, possibly before this
+// runs again. So the DMA may be writing up to seq + 2 until then.
+void Recorder::HandleSegment(uint32_t cycles) {
+  const uint32_t seq = write_seq;
+  write_begin_seq = seq + 3;
+  HAL_DMAEx_ChangeMemory(
+      haudio_in_sai.hdmarx, GetSlotAddr(seq + 2), seq & 1 ? MEMORY1 : MEMORY0);
+  stamps[seq & (num_segments - 1)] = cycles;
+  write_seq = seq + 1;
+}
+
+void Recorder::HandleHalfTransferComplete(uint32_t cycles) {
+  crash_if(dbg, write_seq & 1);  // Missed an interrupt
+  HandleSegment(cycles);
+}
+
+void Recorder::HandleTransferComplete(uint32_t cycles) {
+  crash_if(dbg, !(write_seq & 1));
+  HandleSegment(cycles);
 }
 
 }  // namespace app::hw
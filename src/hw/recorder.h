@@ -3,35 +3,186 @@
 #include <stdint.h>
 
 #include <arm_math.h>
+#include <mbed.h>
 
 #include "debug/counter.h"
 #include "hw/volatile_buffer.h"
+#include "math/fft.h"
+#include "math/window.h"
 #include "structs/complex.h"
 
 namespace app::hw {
 
-static const int recorder_num_samples = 512;
+static const int recorder_sample_rate = 48000;
+static const int recorder_default_num_samples = 512;
+static const int recorder_max_num_samples = app::math::max_fft_len;
+static const int recorder_max_overlap = 8;
+
+// Polyphase frames span taps * num_samples, up to recorder_max_num_samples
+static const int recorder_max_taps = 4;
+static_assert(
+    app::math::min_fft_len / recorder_max_overlap % 4 == 0,
+    "Read() is unrolled by 4 within each hop");
+
+// Segments the reader may fall behind by at least, beyond those of the
+// frame being read and the two owned by the DMA. The ring is that rounded
+// up to a power of two segments, and to at least recorder_min_ring_samples
+// (i.e. more slack with short hops).
+static const int recorder_slack_segments = 8;
+static const int recorder_min_ring_samples = 2 * recorder_max_num_samples;
+static const int recorder_max_segments =
+    recorder_min_ring_samples / (app::math::min_fft_len / recorder_max_overlap);
+static_assert(
+    recorder_max_segments >=
+        recorder_max_taps * recorder_max_overlap + 2 + recorder_slack_segments,
+    "Room for the longest frame");
+
+// Samples in the ring at most, i.e. the size of the audio buffer: 16
+// segments of the largest FFT, at overlap 1
+static const int recorder_ring_samples = 16 * recorder_max_num_samples;
+
+// Blocks shared by the consumers of AcquireBlock(), in samples. Blocks start
+// at multiples of this in the stream (and the ring), regardless of the hop.
+// Rings are powers of two of at least recorder_min_ring_samples, so blocks
+// are contiguous in them.
+static const int recorder_block_samples = 512;
+static const int recorder_num_blocks = 4;
+static const int recorder_max_consumers = 4;
+static_assert(
+    recorder_min_ring_samples % recorder_block_samples == 0,
+    "Blocks are contiguous in the ring");
+
+// A block of raw samples converted to float once for all consumers:
+// unwindowed and unscaled, I and Q (or left and right for a real input).
+struct RecorderBlock {
+  uint32_t seq;    // Block number since Configure()
+  uint32_t stamp;  // Cycle counter when its last sample's segment completed
+  app::structs::Complex<float32_t> samples[recorder_block_samples];
+};
+
+// What the two line-in channels carry. Left is the lower half word of each
+// sample, i.e. I.
+enum class RecorderInput {
+  IQ,     // Complex samples
+  Left,   // A real signal on the left channel, the right is ignored
+  Right,  // Same, on the right channel
+};
+
+// Short name for display and command line parsing.
+const char *recorder_input_name(RecorderInput input);
 
 class Recorder {
  private:
   app::debug::Debug &dbg;
 
+  // Holds the ring, sized for the largest, recorder_ring_samples
   VolatileBuffer<app::structs::Complex<int16_t>> &buffer;
-  VolatileBuffer<app::structs::Complex<int16_t>> lower_half_buffer;
-  VolatileBuffer<app::structs::Complex<int16_t>> upper_half_buffer;
 
-  uint32_t dma_state = 0;
+  RecorderInput input = RecorderInput::IQ;
+
+  // Samples per frame (i.e. per Read()), complex or real
+  int num_samples = recorder_default_num_samples;
+
+  // Frames per num_samples, and samples per ring segment
+  int overlap = 1;
+  int hop_samples = recorder_default_num_samples;
+
+  // Polyphase: frames reach back taps * num_samples, folded into
+  // num_samples by the window table. Segments per frame.
+  int taps = 1;
+  int frame_segments = 1;
+
+  // Ring of segments of hop_samples raw I/Q pairs, as recorded. The SAI's
+  // DMA writes each segment straight into its slot, in double buffer mode:
+  // while it fills one slot, the ISR points its other memory at the slot
+  // after. It owns those two slots, so the reader can fall behind by up to
+  // num_segments - frame_segments - 2 segments, at least
+  // recorder_slack_segments. Frames are read from the ring in place.
+  // Segment (sequence number) n is in slot n % num_segments.
+  const uint32_t *const ring;
+  int num_segments = recorder_min_ring_samples / recorder_default_num_samples;
+  int ring_samples = recorder_min_ring_samples;
+
+  // Cycle counter when each slot's segment completed, as passed to the ISR
+  uint32_t stamps[recorder_max_segments];
+
+  // Newest segment of the last read, and its stamp
+  uint32_t last_read_seq = 0;
+  uint32_t last_read_stamp = 0;
+
+  // Segments the DMA may have started writing (two ahead of those it
+  // completed, see HandleSegment()) and completed, and the next segment to
+  // read
+  volatile uint32_t write_begin_seq = 2;
+  volatile uint32_t write_seq = 0;
+  uint32_t read_seq = 0;
+
+  // Segments read without a gap, saturating at num_segments
+  int contiguous = 0;
+
+  // Accounting since Configure()
+  uint32_t dropped = 0;
+  uint32_t skipped = 0;
+  uint32_t gaps = 0;
+  uint32_t drop_end_seq = 0;  // After the last dropped segment
+
+  // Consumers of shared blocks, each reading the ring at its own position,
+  // in samples since Configure() (modulo 2^32)
+  struct Consumer {
+    uint32_t pos;
+    uint32_t read;
+    uint32_t dropped;
+  };
+  Consumer consumers[recorder_max_consumers];
+  int num_consumers = 0;
+
+  // Converted blocks, by the position they hold. A block without
+  // references stays valid for consumers behind, until it is reused for
+  // another position.
+  RecorderBlock blocks[recorder_num_blocks];
+  uint32_t block_pos[recorder_num_blocks];
+  bool block_valid[recorder_num_blocks] = {false};
+  int block_refs[recorder_num_blocks] = {0};
+  Mutex blocks_mutex;  // Consumers, and blocks
 
-  const int dma_double_buffer_num_halfwords = buffer.size / sizeof(int16_t);
+  // Raw samples of a frame, oldest first, in up to two segments of the ring
+  struct Frame {
+    const uint32_t *src[2];
+    int len[2];
+    uint32_t first_seq;  // To check for overwrites by EndFrame()
+  };
 
-  app::structs::Complex<float32_t> sig_buffer[recorder_num_samples];
+  // Output of the last read, in the format requested
+  union {
+    app::structs::Complex<float32_t> f32[recorder_max_num_samples];
+    app::structs::Complex<q31_t> q31[recorder_max_num_samples];
+    app::structs::Complex<q15_t> q15[recorder_max_num_samples];
+    app::structs::Complex<int16_t> raw[recorder_max_num_samples];
+    float32_t real[recorder_max_num_samples];
+  } sig_buffer;
+
+  app::math::Window window = app::math::Window::BlackmanHarris;
+  float32_t window_table[recorder_max_num_samples];  // taps * num_samples
+  int window_table_bits;  // Max of window_table is <= 2^window_table_bits
+  int16_t window_table_q12[recorder_max_num_samples];  // Q3.12
+  int window_table_q12_bits;  // Max of window_table_q12 is < 2^this
+
+  bool BeginSegment(uint32_t *seq);
+  bool EndSegment(uint32_t first_seq);
+  void Drop(uint32_t first_seq, uint32_t n);
+
+  bool BeginFrame(Frame *frame);
+  bool EndFrame(const Frame &frame);
+
+  uintptr_t GetSlotAddr(uint32_t seq);
+  void HandleSegment(uint32_t cycles);
+
+  int StartRecording();
 
   app::debug::Counter &missed_audio_counter;
   app::debug::Counter &late_audio_read_counter;
 
  public:
-  const int num_samples = recorder_num_samples;
-
   Recorder(
       app::debug::Debug &dbg,
       VolatileBuffer<app::structs::Complex<int16_t>> &audio_buf,
@@ -40,11 +191,103 @@ class Recorder {
 
   int Init();
 
+  // Restarts recording with frames of num_samples, one every
+  // num_samples / overlap samples (overlap 1, 2, 4 or 8). With taps > 1
+  // (I/Q only, taps * num_samples up to recorder_max_num_samples), Read()
+  // returns polyphase filter bank frames: taps * num_samples, weighted by a
+  // prototype filter tapered by the window, folded into num_samples. Data
+  // not yet read is discarded. Not thread safe against Read().
+  int Configure(int num_samples, int overlap, RecorderInput input, int taps);
+  RecorderInput GetInput();
+  int GetNumSamples();
+  int GetOverlap();
+  int GetHopSamples();
+  int GetTaps();
+
+  // Window applied by Read(). Not thread safe against Read().
+  void SetWindow(app::math::Window window);
+  app::math::Window GetWindow();
+  const float32_t *GetWindowTable();  // taps * num_samples entries
+
+  // The buffer the reads return their output in, recorder_max_num_samples
+  // long, for frames built elsewhere (e.g. zoomed from ReadRaw(), once done
+  // with its output). Overwritten by the next read.
+  app::structs::Complex<float32_t> *GetFrameBuffer();
+
+  // Segments (hops) recorded but not read yet. Each read takes the oldest
+  // one, so the reader catches up by reading until there are none.
+  bool HasPending();
+
+  // Skips all but the newest keep pending segments, and returns how many
+  // were skipped. The next frame still includes skipped segments as its
+  // overlap, while the next ReadRaw() is reported as continued, i.e.
+  // spliced.
+  uint32_t Skip(uint32_t keep);
+
+  // Registers a consumer of shared blocks, independent of the reads above
+  // and of each other. Up to recorder_max_consumers, may be called from any
+  // thread.
+  int AddConsumer(int *consumer);
+
+  // Returns the consumer's oldest unread block, or nullptr if none is
+  // complete (or all blocks are referenced). Blocks are converted once and
+  // shared: consumers at the same position get the same block, read only,
+  // until ReleaseBlock(). A consumer that falls behind by more than the ring
+  // drops the oldest blocks. Thread safe between consumers (one thread per
+  // consumer).
+  const RecorderBlock *AcquireBlock(int consumer);
+  void ReleaseBlock(const RecorderBlock *block);
+
+  // Per consumer accounting since Configure(): blocks read and dropped, and
+  // blocks complete but not read yet.
+  uint32_t GetConsumerRead(int consumer);
+  uint32_t GetConsumerDropped(int consumer);
+  uint32_t GetConsumerLag(int consumer);
+
+  // Segment accounting since Configure(). Each segment recorded is read,
+  // dropped, skipped or pending. Dropped segments were overwritten before or
+  // while being read (counted by missed_audio and late_audio_read
+  // respectively). Gaps are the runs of dropped segments.
+  int GetNumSegments();
+  uint32_t GetSegmentsRecorded();
+  uint32_t GetSegmentsRead();
+  uint32_t GetSegmentsDropped();
+  uint32_t GetSegmentsSkipped();
+  uint32_t GetGaps();
+
+  // Newest segment of the last read: its sequence number since Configure(),
+  // and the cycle counter when its DMA transfer completed, i.e. when its last
+  // sample arrived.
+  uint32_t GetLastReadSeq();
+  uint32_t GetLastReadStamp();
+
+  // Returns the frame ending with the oldest unread segment, windowed (and
+  // folded), or nullptr. With overlap or taps, there is no frame until the
+  // frame's samples have been read without a gap since starting or since
+  // dropped segments.
   app::structs::Complex<float32_t> *Read();
 
+  // Same as Read(), but in fixed point with block scaling. The result is
+  // the windowed signal multiplied by 2^exponent, using the available range
+  // as far as the window and the block's peak sample allow. Single tap only.
+  app::structs::Complex<q15_t> *ReadQ15(int *exponent);
+  app::structs::Complex<q31_t> *ReadQ31(int *exponent);
+
+  // Same as Read(), for a real input: num_samples samples of the configured
+  // channel.
+  float32_t *ReadReal();
+
+  // Returns a copy of the oldest unread segment (hop_samples I/Q pairs)
+  // without windowing, or nullptr. Sets continued if it directly follows
+  // the previous one. Don't mix with the other reads between Configure().
+  const app::structs::Complex<int16_t> *ReadRaw(bool *continued);
+
   void HandleAudioInError();
-  void HandleHalfTransferComplete();
-  void HandleTransferComplete();
+  // Called with the cycle counter on entry to the ISR, when the DMA
+  // completed its memory 0 and 1 respectively. They are raised through the
+  // BSP's half and full transfer callbacks, which alternate the same way.
+  void HandleHalfTransferComplete(uint32_t cycles);
+  void HandleTransferComplete(uint32_t cycles);
 };
 
 }  // namespace app::hw
@@ -13,12 +13,25 @@
 #include "debug/counter.h"
 #include "debug/funcs.h"
 #include "debug/macros.h"
+#include "debug/profile.h"
 #include "hw/perf_timer.h"
 #include "hw/volatile_buffer.h"
 
 // Constants
 static const uint32_t fb_addr = LCD_FB_START_ADDRESS;
 static const uint32_t fb_size = sizeof(uint32_t) * 272 * 480;
+// SDRAM after the frame buffers
+static const uint32_t zoom_addr = fb_addr + 7 * fb_size;
+static const uint32_t zoom_size =
+    sizeof(app::structs::Complex<float32_t>) * app::math::max_fft_len;
+// The recorder's ring, which the SAI's DMA records into. Only the reads
+// take from it, the ISR doesn't touch the samples.
+static const uint32_t audio_addr = zoom_addr + zoom_size;
+static const uint32_t audio_size =
+    sizeof(app::structs::Complex<int16_t>) * app::hw::recorder_ring_samples;
+static_assert(
+    audio_addr + audio_size <= SDRAM_DEVICE_ADDR + SDRAM_DEVICE_SIZE,
+    "SDRAM is 8 MB");
 
 // References for use by interrupt handlers.
 static app::Application *volatile global_app = nullptr;
@@ -29,13 +42,23 @@ static Serial serial(USBTX, USBRX);
 static app::debug::Debug dbg(serial);
 static DigitalOut led(LED1);
 static DigitalIn button(USER_BUTTON);
-static volatile app::structs::Complex<int16_t> audio_buffer_alloc[2 * 512];
+static volatile app::structs::Complex<int16_t>
+    audio_out_buffer_alloc[2 * app::hw::player_block_samples];
 static app::debug::Counter ltdc_underrun_counter(dbg, "ltdc_underrun");
 static app::debug::Counter missed_audio_counter(dbg, "missed_audio");
 static app::debug::Counter late_audio_read_counter(dbg, "late_audio_read");
 static app::hw::PerfTimer perf_timer;
-static app::hw::CopyDMA copy_dma;
-static app::hw::ZeroDMA zero_dma;
+static app::debug::Profile profile(dbg, perf_timer);
+static app::hw::DmaManager dma_manager(dbg, perf_timer);
+// The waterfall copy is waited for before each flip, clears are not. Both
+// without bursts until test_dma_throughput shows them to pay off.
+static const app::hw::DmaOptions copy_dma_options = {
+    app::hw::DmaPriority::High,
+    app::hw::DmaBurst::Single,
+    app::hw::DmaFifoThreshold::Full,
+};
+static app::hw::CopyDMA copy_dma(dma_manager, copy_dma_options);
+static app::hw::ZeroDMA zero_dma(dma_manager, app::hw::dma_default_options);
 static app::hw::VolatileBuffer<uint8_t> buf0(
     dbg, zero_dma, fb_addr + 0 * fb_size, fb_size);
 static app::hw::VolatileBuffer<uint8_t> buf1(
@@ -50,8 +73,15 @@ static app::hw::VolatileBuffer<uint32_t> buf5(
     dbg, zero_dma, fb_addr + 5 * fb_size, fb_size);
 static app::hw::VolatileBuffer<uint8_t> wf_buf(
     dbg, zero_dma, fb_addr + 6 * fb_size, fb_size);
+static app::hw::VolatileBuffer<app::structs::Complex<float32_t>> zoom_buf(
+    dbg, zero_dma, zoom_addr, zoom_size);
 static app::hw::VolatileBuffer<app::structs::Complex<int16_t>> audio_buf(
-    dbg, zero_dma, (uint32_t)&audio_buffer_alloc, sizeof(audio_buffer_alloc));
+    dbg, zero_dma, audio_addr, audio_size);
+static app::hw::VolatileBuffer<app::structs::Complex<int16_t>> audio_out_buf(
+    dbg,
+    zero_dma,
+    (uint32_t)&audio_out_buffer_alloc,
+    sizeof(audio_out_buffer_alloc));
 static app::hw::VolatileTripleBuffer<uint8_t> layer0(dbg, buf0, buf1, buf2);
 static app::hw::VolatileTripleBuffer<uint32_t> layer1(dbg, buf3, buf4, buf5);
 static app::ui::Waterfall waterfall(wf_buf, copy_dma, 480, 272);
@@ -59,8 +89,18 @@ static app::hw::Display display(
     dbg, layer0, layer1, copy_dma, ltdc_underrun_counter);
 static app::hw::Recorder recorder(
     dbg, audio_buf, missed_audio_counter, late_audio_read_counter);
+static app::hw::Player player(dbg, audio_out_buf);
 static app::ui::Canvas canvas(480, 272);
-static app::Application application(dbg, display, canvas, recorder, waterfall);
+static app::Application application(
+    dbg,
+    profile,
+    display,
+    canvas,
+    recorder,
+    player,
+    waterfall,
+    zoom_buf,
+    dma_manager);
 
 int main() {
   HAL_Init();
@@ -72,8 +112,7 @@ int main() {
   dbg.printf("Speed: %d Hz.\n", SystemCoreClock);
 
   crash_if(dbg, SDRAM_OK != BSP_SDRAM_Init());
-  crash_if(dbg, 0 != copy_dma.Init());
-  crash_if(dbg, 0 != zero_dma.Init());
+  crash_if(dbg, 0 != dma_manager.Init());
   crash_if(dbg, 0 != buf0.Init());
   crash_if(dbg, 0 != buf1.Init());
   crash_if(dbg, 0 != buf2.Init());
@@ -81,13 +120,16 @@ int main() {
   crash_if(dbg, 0 != buf4.Init());
   crash_if(dbg, 0 != buf5.Init());
   crash_if(dbg, 0 != wf_buf.Init());
+  crash_if(dbg, 0 != zoom_buf.Init());
+  crash_if(dbg, 0 != waterfall.Init());
   crash_if(dbg, 0 != audio_buf.Init());
+  crash_if(dbg, 0 != audio_out_buf.Init());
   crash_if(dbg, 0 != layer0.Init());
   crash_if(dbg, 0 != layer1.Init());
   crash_if(dbg, 0 != display.Init());
+  crash_if(dbg, 0 != player.Init());
   crash_if(dbg, 0 != recorder.Init());
-  crash_if(dbg, 0 != display.Init());
-  crash_if(dbg, 0 != recorder.Init());
+  crash_if(dbg, 0 != player.Start());
   crash_if(dbg, 0 != application.Init());
 
   dbg.printf("Init complete.\n");
@@ -126,6 +168,18 @@ void BSP_AUDIO_IN_TransferComplete_CallBack(void) {
   }
 }
 
+void BSP_AUDIO_OUT_HalfTransfer_CallBack(void) {
+  if (global_app) {
+    global_app->HandleAudioOutHalfTransferComplete();
+  }
+}
+
+void BSP_AUDIO_OUT_TransferComplete_CallBack(void) {
+  if (global_app) {
+    global_app->HandleAudioOutTransferComplete();
+  }
+}
+
 void HAL_LTDC_ErrorCallback(LTDC_HandleTypeDef *hltdc) {
   if (HAL_LTDC_GetError(hltdc) & HAL_LTDC_ERROR_FU) {
     hltdc->ErrorCode &= ~HAL_LTDC_ERROR_FU;
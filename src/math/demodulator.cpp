@@ -0,0 +1,185 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <arm_math.h>
+
+#include "math/fft.h"
+#include "structs/complex.h"
+
+#include "math/demodulator.h"
+
+namespace app::math {
+
+// Passbands relative to the carrier, in Hz
+struct Passband {
+  int32_t low;
+  int32_t high;
+};
+
+// AM carrier (DC after detection) follows within about 85 ms at 48 kHz
+static const float32_t demod_am_dc_alpha = 1.0f / 4096;
+
+const char *demod_mode_name(DemodMode mode) {
+  switch (mode) {
+    case DemodMode::Off:
+      return "off";
+    case DemodMode::USB:
+      return "usb";
+    case DemodMode::LSB:
+      return "lsb";
+    case DemodMode::AM:
+      return "am";
+    case DemodMode::CW:
+      return "cw";
+  }
+  return "?";
+}
+
+int Demodulator::Configure(
+    DemodMode new_mode, int32_t offset_hz, unsigned int sample_rate) {
+  const int32_t max_offset = sample_rate / 2;
+  if (offset_hz < -max_offset || offset_hz > max_offset) {
+    return 1;
+  }
+
+  Passband passband;
+  int32_t mix_hz = offset_hz;
+  switch (new_mode) {
+    case DemodMode::USB:
+      passband = {300, 2700};
+      break;
+    case DemodMode::LSB:
+      passband = {-2700, -300};
+      break;
+    case DemodMode::AM:
+      passband = {-4500, 4500};
+      break;
+    case DemodMode::CW:
+      passband = {-250, 250};
+      mix_hz -= demod_cw_pitch_hz;  // Carrier ends up at the pitch
+      break;
+    case DemodMode::Off:
+      mode = new_mode;
+      Reset();
+      return 0;
+    default:
+      return 1;
+  }
+  mode = new_mode;
+
+  // Windowed sinc (Blackman) low pass of half the passband, normalized to
+  // unity gain, then shifted to the passband's centre. Centred on the
+  // middle tap, so that the passband has zero phase there. Not time
+  // critical, so use double precision.
+  const double fc = (passband.high - passband.low) / 2.0 / sample_rate;
+  const double shift =
+      (offset_hz + (passband.low + passband.high) / 2.0) / sample_rate;
+  auto lowpass = [fc](unsigned int n) {
+    double m = n - (demod_num_taps - 1) / 2.0;  // Integer, num_taps is odd
+    double sinc = m == 0 ? 2 * fc : sin(2 * M_PI * fc * m) / (M_PI * m);
+    double x = 2 * M_PI * n / (demod_num_taps - 1);
+    return sinc * (0.42 - 0.5 * cos(x) + 0.08 * cos(2 * x));
+  };
+  double sum = 0;
+  for (unsigned int n = 0; n < demod_num_taps; n++) {
+    sum += lowpass(n);
+  }
+  for (unsigned int n = 0; n < demod_num_taps; n++) {
+    double m = n - (demod_num_taps - 1) / 2.0;
+    double h = lowpass(n) / sum;
+    taps[n].real = h * cos(2 * M_PI * shift * m);
+    taps[n].imag = h * sin(2 * M_PI * shift * m);
+  }
+
+  // Frequency response at the FFT length. The inverse FFT scales by
+  // 1 / demod_fft_len, so the response needs no scaling.
+  const arm_cfft_instance_f32 *fft_instance = cfft_instance_f32(demod_fft_len);
+  memset(response, 0, sizeof(response));
+  memcpy(response, taps, sizeof(taps));
+  arm_cfft_f32(fft_instance, (float32_t *)response, 0, 1);
+
+  // Mix down, i.e. the NCO runs at -mix_hz
+  const double turns_per_sample = -(double)mix_hz / sample_rate;
+  phase_step = (uint32_t)(int64_t)llround(turns_per_sample * 4294967296.0);
+
+  Reset();
+  return 0;
+}
+
+DemodMode Demodulator::GetMode() {
+  return mode;
+}
+
+void Demodulator::Reset() {
+  memset(history, 0, sizeof(history));
+  phase = 0;
+  am_dc = 0;
+}
+
+void Demodulator::Process(
+    const app::structs::Complex<float32_t> *src, float32_t *dst) {
+  if (mode == DemodMode::Off) {
+    memset(dst, 0, demod_block_len * sizeof(float32_t));
+    return;
+  }
+
+  // Overlap-save: the first demod_num_taps - 1 outputs are circular
+  // convolution garbage, the rest is the linear convolution of the block
+  memcpy(buffer, history, sizeof(history));
+  memcpy(&buffer[demod_block_len], src, sizeof(history));
+  memcpy(history, src, sizeof(history));
+
+  const arm_cfft_instance_f32 *fft_instance = cfft_instance_f32(demod_fft_len);
+  arm_cfft_f32(fft_instance, (float32_t *)buffer, 0, 1);
+  arm_cmplx_mult_cmplx_f32(
+      (float32_t *)buffer,
+      (float32_t *)response,
+      (float32_t *)buffer,
+      demod_fft_len);
+  arm_cfft_f32(fft_instance, (float32_t *)buffer, 1, 1);
+
+  // NCO as in Zoom: rotate a phasor per sample, from the exact phase per
+  // block. Angles are taken within +/- pi, where float32 resolves them best:
+  // the step's rounding error accumulates over the block.
+  const float32_t step = (int32_t)phase_step * (2 * PI / 4294967296.0f);
+  const float32_t rotate_real = cosf(step);
+  const float32_t rotate_imag = sinf(step);
+  const float32_t angle = (int32_t)phase * (2 * PI / 4294967296.0f);
+  float32_t p_real = cosf(angle);
+  float32_t p_imag = sinf(angle);
+  app::structs::Complex<float32_t> *mixed = &buffer[demod_block_len];
+  for (unsigned int i = 0; i < demod_block_len; i++) {
+    float32_t x_real = mixed[i].real;
+    float32_t x_imag = mixed[i].imag;
+    mixed[i].real = x_real * p_real - x_imag * p_imag;
+    mixed[i].imag = x_real * p_imag + x_imag * p_real;
+    float32_t t = p_real * rotate_real - p_imag * rotate_imag;
+    p_imag = p_real * rotate_imag + p_imag * rotate_real;
+    p_real = t;
+  }
+  phase += phase_step * demod_block_len;
+
+  if (mode == DemodMode::AM) {
+    for (unsigned int i = 0; i < demod_block_len; i++) {
+      float32_t envelope = sqrtf(
+          mixed[i].real * mixed[i].real + mixed[i].imag * mixed[i].imag);
+      am_dc += demod_am_dc_alpha * (envelope - am_dc);
+      dst[i] = envelope - am_dc;
+    }
+  } else {
+    for (unsigned int i = 0; i < demod_block_len; i++) {
+      dst[i] = mixed[i].real;
+    }
+  }
+}
+
+const app::structs::Complex<float32_t> *Demodulator::GetMixed() {
+  return &buffer[demod_block_len];
+}
+
+const app::structs::Complex<float32_t> *Demodulator::GetTaps() {
+  return taps;
+}
+
+}  // namespace app::math
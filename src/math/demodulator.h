@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <arm_math.h>
+
+#include "structs/complex.h"
+
+namespace app::math {
+
+enum class DemodMode {
+  Off,
+  USB,  // Upper sideband, 300 to 2700 Hz above the carrier
+  LSB,  // Lower sideband, 300 to 2700 Hz below the carrier
+  AM,   // Envelope of +/- 4.5 kHz around the carrier
+  CW,   // 500 Hz around the carrier, heard at demod_cw_pitch_hz
+};
+
+// Short name for display and command line parsing.
+const char *demod_mode_name(DemodMode mode);
+
+// Overlap-save: each FFT of demod_fft_len takes demod_block_len new samples
+// and yields as many filtered ones, with up to demod_block_len + 1 taps.
+static const unsigned int demod_fft_len = 1024;
+static const unsigned int demod_block_len = demod_fft_len / 2;
+static const unsigned int demod_num_taps = demod_block_len + 1;
+
+static const int32_t demod_cw_pitch_hz = 700;
+
+// Fast convolution filter and demodulator, from I/Q to audio at the same
+// sample rate.
+//
+// The passband is a complex band pass around the carrier, so the filter
+// both selects the signal and rejects the opposite sideband, in one complex
+// multiply per bin. Per block, that's a forward and an inverse FFT of
+// demod_fft_len, instead of demod_num_taps complex MACs per sample for a
+// direct FIR. The filtered signal is then mixed down (to the CW pitch for
+// CW), and demodulated: its real part for SSB and CW, its envelope for AM.
+class Demodulator {
+ private:
+  DemodMode mode = DemodMode::Off;
+
+  // Taps (for reference), and their zero padded FFT
+  app::structs::Complex<float32_t> taps[demod_num_taps];
+  app::structs::Complex<float32_t> response[demod_fft_len];
+
+  // Previous block, then the FFT input and output
+  app::structs::Complex<float32_t> history[demod_block_len];
+  app::structs::Complex<float32_t> buffer[demod_fft_len];
+
+  // Mixer, a full turn is 2^32
+  uint32_t phase = 0;
+  uint32_t phase_step = 0;
+
+  // AM: DC (carrier) level of the envelope, removed from the audio
+  float32_t am_dc = 0;
+
+ public:
+  // Demodulates a carrier at offset_hz (input frequency, within
+  // +/- sample_rate / 2). Resets.
+  int Configure(DemodMode mode, int32_t offset_hz, unsigned int sample_rate);
+  DemodMode GetMode();
+
+  // Drops all history, e.g. after a gap in the input.
+  void Reset();
+
+  // Filters and demodulates demod_block_len samples into as many audio
+  // samples. The filter delays by demod_block_len / 2 samples.
+  void Process(const app::structs::Complex<float32_t> *src, float32_t *dst);
+
+  // Filtered and mixed output of the last Process(), before demodulation.
+  const app::structs::Complex<float32_t> *GetMixed();
+
+  // demod_num_taps filter taps, e.g. for testing against a direct FIR.
+  const app::structs::Complex<float32_t> *GetTaps();
+};
+
+}  // namespace app::math
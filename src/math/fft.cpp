@@ -0,0 +1,63 @@
+#include <arm_const_structs.h>
+#include <arm_math.h>
+
+#include "math/fft.h"
+
+namespace app::math {
+
+bool is_valid_fft_len(unsigned int len) {
+  return len >= min_fft_len && len <= max_fft_len && (len & (len - 1)) == 0;
+}
+
+const arm_cfft_instance_f32 *cfft_instance_f32(unsigned int len) {
+  switch (len) {
+    case 256:
+      return &arm_cfft_sR_f32_len256;
+    case 512:
+      return &arm_cfft_sR_f32_len512;
+    case 1024:
+      return &arm_cfft_sR_f32_len1024;
+    case 2048:
+      return &arm_cfft_sR_f32_len2048;
+    case 4096:
+      return &arm_cfft_sR_f32_len4096;
+    default:
+      return nullptr;
+  }
+}
+
+const arm_cfft_instance_q15 *cfft_instance_q15(unsigned int len) {
+  switch (len) {
+    case 256:
+      return &arm_cfft_sR_q15_len256;
+    case 512:
+      return &arm_cfft_sR_q15_len512;
+    case 1024:
+      return &arm_cfft_sR_q15_len1024;
+    case 2048:
+      return &arm_cfft_sR_q15_len2048;
+    case 4096:
+      return &arm_cfft_sR_q15_len4096;
+    default:
+      return nullptr;
+  }
+}
+
+const arm_cfft_instance_q31 *cfft_instance_q31(unsigned int len) {
+  switch (len) {
+    case 256:
+      return &arm_cfft_sR_q31_len256;
+    case 512:
+      return &arm_cfft_sR_q31_len512;
+    case 1024:
+      return &arm_cfft_sR_q31_len1024;
+    case 2048:
+      return &arm_cfft_sR_q31_len2048;
+    case 4096:
+      return &arm_cfft_sR_q31_len4096;
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace app::math
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <arm_math.h>
+
+namespace app::math {
+
+static const unsigned int min_fft_len = 256;
+static const unsigned int max_fft_len = 4096;
+
+// Supported FFT lengths are the powers of two from min to max.
+bool is_valid_fft_len(unsigned int len);
+
+// CMSIS complex FFT instance for a length, or nullptr if not supported.
+const arm_cfft_instance_f32 *cfft_instance_f32(unsigned int len);
+const arm_cfft_instance_q15 *cfft_instance_q15(unsigned int len);
+const arm_cfft_instance_q31 *cfft_instance_q31(unsigned int len);
+
+}  // namespace app::math
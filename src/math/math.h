@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 
 #include <arm_math.h>
 
@@ -31,6 +32,52 @@ inline float32_t fast_log2(float32_t val) {
   return int_log2 + u.f;
 }
 
+// Batched, branchless log2 approximation: dst[i] = log2(src[i]) + offset.
+//
+// The exponent is taken from the float's bits, log2 of the mantissa
+// m = 1 + t in [1, 2) from a polynomial of the given order:
+//   p(t) = t + t (1 - t) r(t)
+// which is exact at both ends of the octave (so continuous across octaves),
+// with r(t) minimax fitted. Max error over all positive normal floats, in
+// log2 units (see tests/test_log2.cpp):
+//   order 1: 0.086, 2: 0.0077, 3: 0.00089, 4: 0.00012, 5: 0.000023
+// (order 5 is limited by float rounding of the sum for large exponents).
+// Zero and denormals give about -127, the sign is ignored.
+//
+// No branches or lookups, so compilers can vectorise it where there's SIMD.
+static const unsigned int fast_log2_max_order = 5;
+
+static const float32_t fast_log2_coeffs[fast_log2_max_order + 1][4] = {
+    {},
+    {},
+    {0.346555249f},
+    {0.422865316f, -0.159220103f},
+    {0.43872573f, -0.239058196f, 0.0821306608f},
+    {0.441917036f, -0.267179386f, 0.148426613f, -0.045149026f},
+};
+
+template <unsigned int order>
+inline void fast_log2_array(
+    const float32_t *src, float32_t *dst, unsigned int n, float32_t offset) {
+  static_assert(order >= 1 && order <= fast_log2_max_order, "No such order");
+  const float32_t *c = fast_log2_coeffs[order];
+  for (unsigned int i = 0; i < n; i++) {
+    uint32_t bits;
+    memcpy(&bits, &src[i], sizeof(bits));
+    float32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127;
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float32_t t;
+    memcpy(&t, &bits, sizeof(t));
+    t -= 1;
+
+    float32_t r = 0;
+    for (int k = (int)order - 2; k >= 0; k--) {
+      r = r * t + c[k];
+    }
+    dst[i] = exponent + offset + t + (t - t * t) * r;
+  }
+}
+
 // Returns a value clipped to a lower and upper bound.
 template <typename T, T min, T max>
 inline T limit(T x) {
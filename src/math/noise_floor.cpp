@@ -0,0 +1,36 @@
+#include <math.h>
+
+#include <arm_math.h>
+
+#include "math/noise_floor.h"
+
+namespace app::math {
+
+NoiseFloor::NoiseFloor(float32_t percentile, float32_t level_log2)
+    : percentile(percentile) {
+  Reset(level_log2);
+}
+
+void NoiseFloor::Reset(float32_t new_level_log2) {
+  level_log2 = new_level_log2;
+  threshold = exp2f(level_log2);
+}
+
+void NoiseFloor::Update(
+    const float32_t *powers, unsigned int n, float32_t gain) {
+  if (n == 0) {
+    return;
+  }
+  unsigned int below = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    below += powers[i] < threshold;
+  }
+  level_log2 += gain * (percentile - (float32_t)below / n);
+  threshold = exp2f(level_log2);
+}
+
+float32_t NoiseFloor::Get() {
+  return level_log2;
+}
+
+}  // namespace app::math
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <arm_math.h>
+
+namespace app::math {
+
+// Streaming percentile tracker for the noise floor of a power spectrum.
+//
+// Instead of sorting or building a histogram, the level is nudged every
+// update by how far the fraction of powers below it is from the target
+// percentile (a stochastic approximation of the quantile). Per update, that
+// is one compare per power plus one exp2f, and no state beyond the level.
+//
+// With a low percentile, signals covering up to 1 - percentile of the span
+// don't move the estimate.
+class NoiseFloor {
+ private:
+  float32_t percentile;
+  float32_t level_log2;
+  float32_t threshold;  // 2^level_log2
+
+ public:
+  NoiseFloor(float32_t percentile, float32_t level_log2);
+
+  // Restarts from a level, e.g. after the scale of the powers changed.
+  void Reset(float32_t level_log2);
+
+  // Moves the level by at most gain * max(percentile, 1 - percentile)
+  // (log2 units) towards the percentile of the n linear powers.
+  void Update(const float32_t *powers, unsigned int n, float32_t gain);
+
+  // log2 of the current estimate
+  float32_t Get();
+};
+
+}  // namespace app::math
@@ -0,0 +1,75 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <arm_math.h>
+
+#include "math/resampler.h"
+
+namespace app::math {
+
+int Resampler::Configure(
+    unsigned int new_num_bins,
+    unsigned int new_num_columns,
+    double origin,
+    double step,
+    bool new_wrap) {
+  const double width = fabs(step);
+  if (new_num_bins < resampler_padding || new_num_bins > UINT16_MAX ||
+      new_num_columns > resampler_max_columns || width == 0 ||
+      width >= resampler_padding - 1) {
+    return 1;
+  }
+  num_bins = new_num_bins;
+  num_columns = new_num_columns;
+  interpolate = width < 1;
+  wrap = new_wrap;
+
+  for (unsigned int c = 0; c < num_columns; c++) {
+    double position = fmod(origin + c * step, num_bins);
+    position += position < 0 ? num_bins : 0;
+
+    if (interpolate) {
+      const double lower = floor(position);
+      first[c] = (uint16_t)lower % num_bins;
+      count[c] = 2;
+      weight[c] = (float32_t)(position - lower);
+    } else {
+      // Bins with centres in [lower, upper), at least one as width >= 1.
+      // Starting from a wrapped lower bound keeps columns adjacent.
+      const double lower = ceil(position - width / 2);
+      const double upper = ceil(position + width / 2);
+      const int32_t lower_bin = (int32_t)lower;
+      first[c] = lower_bin < 0 ? lower_bin + num_bins : lower_bin % num_bins;
+      count[c] = (uint8_t)(upper - lower);
+      weight[c] = 0;
+    }
+  }
+  return 0;
+}
+
+void Resampler::Process(float32_t *src, float32_t *dst) {
+  // Segments that wrap around continue into the padding
+  if (wrap) {
+    memcpy(&src[num_bins], src, resampler_padding * sizeof(float32_t));
+  }
+
+  if (interpolate) {
+    for (unsigned int c = 0; c < num_columns; c++) {
+      const float32_t *p = &src[first[c]];
+      dst[c] = p[0] + weight[c] * (p[1] - p[0]);
+    }
+    return;
+  }
+
+  for (unsigned int c = 0; c < num_columns; c++) {
+    const float32_t *p = &src[first[c]];
+    float32_t max = p[0];
+    for (unsigned int i = 1; i < count[c]; i++) {
+      max = p[i] > max ? p[i] : max;
+    }
+    dst[c] = max;
+  }
+}
+
+}  // namespace app::math
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <arm_math.h>
+
+namespace app::math {
+
+static const unsigned int resampler_max_columns = 480;
+
+// Extra entries the input needs past its num_bins values, for wrapping
+// around without a branch per bin. Also the maximum bins per column.
+static const unsigned int resampler_padding = 16;
+
+// Maps num_bins values (e.g. FFT bin powers) onto num_columns pixel columns.
+//
+// Column c is centred on the (fractional, wrapping) bin position
+// origin + c * step, and step may be negative. Where a column spans more
+// than one bin, it shows the maximum of the bins whose centres fall in
+// [position - |step| / 2, position + |step| / 2), so narrow carriers are
+// never dropped and every bin lands in exactly one column. Where columns are
+// narrower than bins, adjacent bins are interpolated linearly.
+//
+// Positions wrap around num_bins, as for the bins of a complex FFT. Without
+// wrap (e.g. for the positive half of a real FFT), the columns must stay
+// within the bins, and interpolation may read the value at num_bins.
+//
+// The segments are precomputed by Configure(), so Process() is a single
+// pass over the input.
+class Resampler {
+ private:
+  unsigned int num_bins = 0;
+  unsigned int num_columns = 0;
+  bool interpolate = false;
+  bool wrap = true;
+
+  // Reduction: first bin and number of bins per column. Interpolation: the
+  // lower bin, and the weight of the upper one.
+  uint16_t first[resampler_max_columns];
+  uint8_t count[resampler_max_columns];
+  float32_t weight[resampler_max_columns];
+
+ public:
+  int Configure(
+      unsigned int num_bins,
+      unsigned int num_columns,
+      double origin,
+      double step,
+      bool wrap);
+
+  // Reads num_bins values from src, which must have room for
+  // resampler_padding more (overwritten if wrapping), and writes num_columns
+  // values.
+  void Process(float32_t *src, float32_t *dst);
+};
+
+}  // namespace app::math
@@ -0,0 +1,102 @@
+#include <math.h>
+
+#include <arm_math.h>
+
+#include "math/window.h"
+
+namespace app::math {
+
+// Generalized cosine window coefficients (a0, a1, ...).
+static const float32_t rectangular_coeffs[] = {1.0f};
+static const float32_t hann_coeffs[] = {0.5f, 0.5f};
+static const float32_t blackman_harris_coeffs[] = {
+    0.35875f, 0.48829f, 0.14128f, 0.01168f};
+static const float32_t flat_top_coeffs[] = {
+    0.21557895f, 0.41663158f, 0.277263158f, 0.083578947f, 0.006947368f};
+
+void make_window(Window window, float32_t *table, unsigned int len) {
+  const float32_t *coeffs;
+  unsigned int num_coeffs;
+  switch (window) {
+    case Window::Hann:
+      coeffs = hann_coeffs;
+      num_coeffs = sizeof(hann_coeffs) / sizeof(float32_t);
+      break;
+    case Window::BlackmanHarris:
+      coeffs = blackman_harris_coeffs;
+      num_coeffs = sizeof(blackman_harris_coeffs) / sizeof(float32_t);
+      break;
+    case Window::FlatTop:
+      coeffs = flat_top_coeffs;
+      num_coeffs = sizeof(flat_top_coeffs) / sizeof(float32_t);
+      break;
+    case Window::Rectangular:
+    default:
+      coeffs = rectangular_coeffs;
+      num_coeffs = sizeof(rectangular_coeffs) / sizeof(float32_t);
+      break;
+  }
+
+  // Not time critical, so use double precision for a clean table.
+  double sum = 0;
+  for (unsigned int n = 0; n < len; n++) {
+    double w = 0;
+    double sign = 1;
+    for (unsigned int k = 0; k < num_coeffs; k++) {
+      w += sign * coeffs[k] * cos(2 * M_PI * k * n / len);
+      sign = -sign;
+    }
+    table[n] = w;
+    sum += w;
+  }
+
+  // Normalize coherent gain (mean of window) to 1
+  const double scale = len / sum;
+  for (unsigned int n = 0; n < len; n++) {
+    table[n] *= scale;
+  }
+}
+
+// Passband of the prototype, in bins. A sinc exactly one bin wide dips by
+// half (-6 dB) between bins, the taper narrows it further. At 4 taps with
+// Blackman-Harris, 1.7 bins scallop by 0.9 dB (like the plain window) while
+// a bin 2 away is down by more than 120 dB (14 dB for the plain window).
+static const double polyphase_bandwidth = 1.7;
+
+void make_polyphase_window(
+    Window window, float32_t *table, unsigned int len, unsigned int taps) {
+  const unsigned int total_len = taps * len;
+  make_window(window, table, total_len);
+
+  // Sinc centred like the periodic window
+  double sum = 0;
+  for (unsigned int n = 0; n < total_len; n++) {
+    const double x =
+        ((double)n - total_len / 2) / len * polyphase_bandwidth;
+    const double sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+    table[n] *= sinc;
+    sum += table[n];
+  }
+
+  // Folded, the coherent gain is sum / len
+  const double scale = len / sum;
+  for (unsigned int n = 0; n < total_len; n++) {
+    table[n] *= scale;
+  }
+}
+
+const char *window_name(Window window) {
+  switch (window) {
+    case Window::Rectangular:
+      return "rect";
+    case Window::Hann:
+      return "hann";
+    case Window::BlackmanHarris:
+      return "blackman-harris";
+    case Window::FlatTop:
+      return "flattop";
+  }
+  return "?";
+}
+
+}  // namespace app::math
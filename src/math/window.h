@@ -0,0 +1,35 @@
+#pragma once
+
+#include <arm_math.h>
+
+namespace app::math {
+
+enum class Window {
+  Rectangular,
+  Hann,
+  BlackmanHarris,  // 4-term, -92 dB sidelobes
+  FlatTop,         // 5-term, for amplitude accuracy
+};
+
+// Fills a table with the periodic (DFT-even) form of a window.
+//
+// Normalized to unity coherent gain, so a carrier in the bin center keeps its
+// magnitude regardless of the window chosen.
+void make_window(Window window, float32_t *table, unsigned int len);
+
+// Fills a table of taps * len entries with the prototype filter of a
+// polyphase filter bank (weighted overlap-add): a sinc low pass a bit wider
+// than a bin (of an FFT of len), tapered by the window over its whole length.
+//
+// A frame of taps * len samples, multiplied by the table and folded into
+// len by summing the taps, replaces a windowed frame of len. Each bin then
+// responds about as flat within its own width as with the window alone, and
+// falls off much more steeply past it, i.e. leaks far less into bins a few
+// away. Normalized like the windows, to unity coherent gain after folding.
+void make_polyphase_window(
+    Window window, float32_t *table, unsigned int len, unsigned int taps);
+
+// Short name for display and command line parsing.
+const char *window_name(Window window);
+
+}  // namespace app::math
@@ -0,0 +1,190 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <arm_math.h>
+
+#include "hw/volatile_buffer.h"
+#include "math/fft.h"
+#include "structs/complex.h"
+
+#include "math/zoom.h"
+
+namespace app::math {
+
+// Cutoff relative to the decimated sample rate. Slightly below Nyquist, so
+// that only the outermost bins see (attenuated) aliases from the transition
+// band.
+static const double zoom_cutoff = 0.45;
+
+Zoom::Zoom(
+    app::hw::VolatileBuffer<app::structs::Complex<float32_t>> &history)
+    : history(history) {
+}
+
+int Zoom::Init() {
+  if (history.size < max_fft_len * sizeof(app::structs::Complex<float32_t>)) {
+    return 1;
+  }
+  return 0;
+}
+
+int Zoom::Configure(
+    unsigned int new_factor,
+    int32_t offset_hz,
+    unsigned int sample_rate,
+    unsigned int new_frame_len,
+    unsigned int overlap) {
+  if (new_factor < 2 || new_factor > zoom_max_factor ||
+      (new_factor & (new_factor - 1)) != 0) {
+    return 1;
+  }
+  if (!is_valid_fft_len(new_frame_len) || overlap == 0 ||
+      new_frame_len % overlap != 0) {
+    return 1;
+  }
+  const int32_t max_offset = sample_rate / 2;
+  if (offset_hz < -max_offset || offset_hz > max_offset) {
+    return 1;
+  }
+
+  factor = new_factor;
+  frame_len = new_frame_len;
+  hop_len = frame_len / overlap;
+
+  // Mix down, i.e. the NCO runs at -offset
+  const double turns_per_sample = -(double)offset_hz / sample_rate;
+  phase_step = (uint32_t)(int64_t)llround(turns_per_sample * 4294967296.0);
+
+  // Windowed sinc (Blackman), normalized to unity gain at DC so carriers
+  // keep their power. Not time critical, so use double precision.
+  const unsigned int num_taps = factor * zoom_taps_per_factor;
+  const double fc = zoom_cutoff / factor;
+  double sum = 0;
+  for (unsigned int n = 0; n < num_taps; n++) {
+    double m = n - (num_taps - 1) / 2.0;  // Never 0, num_taps is even
+    double sinc = sin(2 * M_PI * fc * m) / (M_PI * m);
+    double x = 2 * M_PI * n / (num_taps - 1);
+    double w = 0.42 - 0.5 * cos(x) + 0.08 * cos(2 * x);
+    coeffs[n] = sinc * w;
+    sum += coeffs[n];
+  }
+  for (unsigned int n = 0; n < num_taps; n++) {
+    coeffs[n] /= sum;
+  }
+
+  if (ARM_MATH_SUCCESS != arm_fir_decimate_init_f32(
+                              &fir_real,
+                              num_taps,
+                              factor,
+                              coeffs,
+                              state_real,
+                              zoom_block_len)) {
+    return 1;
+  }
+  if (ARM_MATH_SUCCESS != arm_fir_decimate_init_f32(
+                              &fir_imag,
+                              num_taps,
+                              factor,
+                              coeffs,
+                              state_imag,
+                              zoom_block_len)) {
+    return 1;
+  }
+
+  Reset();
+  return 0;
+}
+
+void Zoom::Reset() {
+  memset(state_real, 0, sizeof(state_real));
+  memset(state_imag, 0, sizeof(state_imag));
+  mixed_len = 0;
+  history_pos = 0;
+  history_fill = 0;
+  history_new = 0;
+}
+
+void Zoom::Process(
+    const app::structs::Complex<int16_t> *src, unsigned int len) {
+  const float32_t step = phase_step * (2 * PI / 4294967296.0f);
+  const float32_t rotate_real = cosf(step);
+  const float32_t rotate_imag = sinf(step);
+
+  while (len > 0) {
+    unsigned int n = zoom_block_len - mixed_len;
+    n = n < len ? n : len;
+
+    // NCO: rotate a phasor per sample, restarting from the exact phase once
+    // per block so that rounding errors don't accumulate
+    const float32_t angle = phase * (2 * PI / 4294967296.0f);
+    float32_t p_real = cosf(angle);
+    float32_t p_imag = sinf(angle);
+    float32_t *dst_real = &mixed_real[mixed_len];
+    float32_t *dst_imag = &mixed_imag[mixed_len];
+    for (unsigned int i = 0; i < n; i++) {
+      float32_t x_real = src[i].real;
+      float32_t x_imag = src[i].imag;
+      dst_real[i] = x_real * p_real - x_imag * p_imag;
+      dst_imag[i] = x_real * p_imag + x_imag * p_real;
+      float32_t t = p_real * rotate_real - p_imag * rotate_imag;
+      p_imag = p_real * rotate_imag + p_imag * rotate_real;
+      p_real = t;
+    }
+    phase += phase_step * n;
+
+    mixed_len += n;
+    src += n;
+    len -= n;
+    Filter();
+  }
+}
+
+void Zoom::Filter() {
+  const unsigned int num_in = mixed_len - mixed_len % factor;
+  if (num_in == 0) {
+    return;
+  }
+
+  arm_fir_decimate_f32(&fir_real, mixed_real, decimated_real, num_in);
+  arm_fir_decimate_f32(&fir_imag, mixed_imag, decimated_imag, num_in);
+
+  const unsigned int num_out = num_in / factor;
+  volatile app::structs::Complex<float32_t> *ring = history.Data();
+  for (unsigned int i = 0; i < num_out; i++) {
+    ring[history_pos].real = decimated_real[i];
+    ring[history_pos].imag = decimated_imag[i];
+    if (++history_pos == frame_len) {
+      history_pos = 0;
+    }
+  }
+  history_fill += num_out;
+  history_fill = history_fill < frame_len ? history_fill : frame_len;
+  history_new += num_out;
+
+  // Keep the rest for the next call
+  mixed_len -= num_in;
+  memmove(mixed_real, &mixed_real[num_in], mixed_len * sizeof(float32_t));
+  memmove(mixed_imag, &mixed_imag[num_in], mixed_len * sizeof(float32_t));
+}
+
+app::structs::Complex<float32_t> *Zoom::Frame(
+    const float32_t *window, app::structs::Complex<float32_t> *dst) {
+  if (history_fill < frame_len || history_new < hop_len) {
+    return nullptr;
+  }
+  history_new -= hop_len;
+
+  // Oldest sample is at history_pos
+  const volatile app::structs::Complex<float32_t> *ring = history.Data();
+  for (unsigned int i = 0; i < frame_len; i++) {
+    unsigned int j = history_pos + i;
+    j = j < frame_len ? j : j - frame_len;
+    dst[i].real = ring[j].real * window[i];
+    dst[i].imag = ring[j].imag * window[i];
+  }
+
+  return dst;
+}
+
+}  // namespace app::math
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <arm_math.h>
+
+#include "hw/volatile_buffer.h"
+#include "math/fft.h"
+#include "structs/complex.h"
+
+namespace app::math {
+
+static const unsigned int zoom_max_factor = 64;
+
+// FIR length per unit of decimation factor. The cost per input sample is
+// this many MACs for I and Q each, regardless of the factor.
+static const unsigned int zoom_taps_per_factor = 32;
+static const unsigned int zoom_max_taps =
+    zoom_taps_per_factor * zoom_max_factor;
+
+// Input samples per FIR call, a multiple of all factors. The FIR state
+// grows with it, so it's kept small.
+static const unsigned int zoom_block_len = 64;
+static_assert(zoom_block_len % zoom_max_factor == 0, "Whole FIR outputs");
+
+// Zoom FFT front end (digital down-conversion).
+//
+// Shifts the centre frequency of interest to DC with an NCO, low pass
+// filters and decimates with arm_fir_decimate_f32, and cuts the decimated
+// stream into (overlapping) windowed frames for the FFT. The FFT then spans
+// sample_rate / factor around the centre, with factor times the resolution.
+//
+// Only the FIR runs in internal RAM, as it reads its taps and state for
+// every input sample. The decimated history is kept in the buffer given
+// (e.g. SDRAM), and frames are built in the caller's buffer.
+class Zoom {
+ private:
+  unsigned int factor = 1;
+  unsigned int frame_len = 0;
+  unsigned int hop_len = 0;  // Decimated samples between frames
+
+  // NCO, a full turn is 2^32
+  uint32_t phase = 0;
+  uint32_t phase_step = 0;
+
+  // Windowed sinc low pass, factor * zoom_taps_per_factor taps
+  float32_t coeffs[zoom_max_taps];
+
+  // I and Q are filtered separately
+  arm_fir_decimate_instance_f32 fir_real;
+  arm_fir_decimate_instance_f32 fir_imag;
+  float32_t state_real[zoom_max_taps + zoom_block_len - 1];
+  float32_t state_imag[zoom_max_taps + zoom_block_len - 1];
+
+  // Mixed input not yet filtered (less than factor samples between calls)
+  float32_t mixed_real[zoom_block_len];
+  float32_t mixed_imag[zoom_block_len];
+  unsigned int mixed_len = 0;
+
+  float32_t decimated_real[zoom_block_len / 2];
+  float32_t decimated_imag[zoom_block_len / 2];
+
+  // Ring of the last frame_len decimated samples, max_fft_len at most
+  app::hw::VolatileBuffer<app::structs::Complex<float32_t>> history;
+  unsigned int history_pos = 0;  // Oldest sample
+  unsigned int history_fill = 0;
+  unsigned int history_new = 0;  // Samples since the last frame
+
+  void Filter();
+
+ public:
+  Zoom(app::hw::VolatileBuffer<app::structs::Complex<float32_t>> &history);
+
+  // Checks that the history buffer holds max_fft_len samples.
+  int Init();
+
+  // Zooms in by factor (a power of two from 2 to zoom_max_factor) around
+  // offset_hz (within +/- sample_rate / 2), producing frame_len samples
+  // every frame_len / overlap decimated samples. Resets.
+  int Configure(
+      unsigned int factor,
+      int32_t offset_hz,
+      unsigned int sample_rate,
+      unsigned int frame_len,
+      unsigned int overlap);
+
+  // Drops all history, e.g. after a gap in the input.
+  void Reset();
+
+  // Mixes, filters and decimates input samples.
+  void Process(const app::structs::Complex<int16_t> *src, unsigned int len);
+
+  // Writes the next frame, windowed, to dst (frame_len samples, transformed
+  // in place by the caller) and returns it, or returns nullptr if not
+  // enough decimated samples arrived since the last one. Window has
+  // frame_len entries.
+  app::structs::Complex<float32_t> *Frame(
+      const float32_t *window, app::structs::Complex<float32_t> *dst);
+};
+
+}  // namespace app::math
@@ -0,0 +1,209 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mbed.h>
+
+#include <arm_math.h>
+
+#include "debug/class.h"
+#include "debug/macros.h"
+#include "hw/perf_timer.h"
+#include "math/demodulator.h"
+#include "structs/complex.h"
+
+#include "test_demod.h"
+
+const unsigned int demod_sample_rate = 48000;
+const unsigned int demod_test_blocks = 16;
+const unsigned int demod_test_len =
+    demod_test_blocks * app::math::demod_block_len;
+
+// Tone amplitude, at int16 scale like the recorder's blocks
+const double demod_tone_amplitude = 8000;
+
+// Tones are measured over whole periods at the end of the output, after the
+// filter (and the AM carrier tracking) settled
+const unsigned int demod_measure_len = 4800;
+
+// Overlap-save against a direct FIR, relative to the output's RMS. Bounded
+// by float32 FFT rounding.
+const double demod_max_fir_error = 1e-4;
+
+const double demod_max_gain_error_db = 0.2;
+const double demod_min_rejection_db = 60;
+
+const unsigned int demod_bench_repeats = 200;
+
+static app::math::Demodulator demod;
+static app::structs::Complex<float32_t> input[demod_test_len];
+static float32_t output[demod_test_len];
+static app::structs::Complex<float32_t> mixed[demod_test_len];
+
+static void run(unsigned int num_blocks) {
+  const unsigned int n = app::math::demod_block_len;
+  for (unsigned int b = 0; b < num_blocks; b++) {
+    demod.Process(&input[b * n], &output[b * n]);
+    memcpy(&mixed[b * n], demod.GetMixed(), n * sizeof(mixed[0]));
+  }
+}
+
+// Amplitude of a real tone, over whole periods of it
+static double tone_amplitude(const float32_t *x, unsigned int n, double hz) {
+  double real = 0, imag = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    const double phase = 2 * M_PI * hz * i / demod_sample_rate;
+    real += x[i] * cos(phase);
+    imag -= x[i] * sin(phase);
+  }
+  return 2 * sqrt(real * real + imag * imag) / n;
+}
+
+static double rms(const float32_t *x, unsigned int n) {
+  double sum = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    sum += (double)x[i] * x[i];
+  }
+  return sqrt(sum / n);
+}
+
+// Filtered and mixed output against a direct FIR of the same taps, and an
+// exact mixer, on noise.
+void test_demod_fir(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  struct Case {
+    app::math::DemodMode mode;
+    int32_t offset_hz;
+    int32_t mix_hz;
+  };
+  const Case cases[] = {
+      {app::math::DemodMode::USB, 6000, 6000},
+      {app::math::DemodMode::LSB, -12000, -12000},
+      {app::math::DemodMode::AM, 0, 0},
+      {app::math::DemodMode::CW, 3000, 3000 - app::math::demod_cw_pitch_hz},
+  };
+
+  uint32_t seed = 1;
+  for (unsigned int i = 0; i < demod_test_len; i++) {
+    seed = seed * 1664525 + 1013904223;
+    input[i].real = (int32_t)(seed >> 16) - 32768;
+    seed = seed * 1664525 + 1013904223;
+    input[i].imag = (int32_t)(seed >> 16) - 32768;
+  }
+
+  for (const Case &c : cases) {
+    crash_if(
+        dbg, 0 != demod.Configure(c.mode, c.offset_hz, demod_sample_rate));
+    run(demod_test_blocks);
+
+    const app::structs::Complex<float32_t> *taps = demod.GetTaps();
+    double sum_error = 0, sum_power = 0;
+    for (unsigned int n = 0; n < demod_test_len; n++) {
+      double real = 0, imag = 0;
+      for (unsigned int k = 0; k < app::math::demod_num_taps && k <= n; k++) {
+        const app::structs::Complex<float32_t> &x = input[n - k];
+        real += (double)taps[k].real * x.real - (double)taps[k].imag * x.imag;
+        imag += (double)taps[k].real * x.imag + (double)taps[k].imag * x.real;
+      }
+      const double phase = -2 * M_PI * c.mix_hz * (double)n / demod_sample_rate;
+      const double mixed_real = real * cos(phase) - imag * sin(phase);
+      const double mixed_imag = real * sin(phase) + imag * cos(phase);
+      const double error_real = mixed[n].real - mixed_real;
+      const double error_imag = mixed[n].imag - mixed_imag;
+      sum_error += error_real * error_real + error_imag * error_imag;
+      sum_power += mixed_real * mixed_real + mixed_imag * mixed_imag;
+    }
+    const double error = sqrt(sum_error / sum_power);
+    dbg.printf(
+        "  %-4s %+6ld Hz: rms error %.2e\n",
+        app::math::demod_mode_name(c.mode),
+        (long)c.offset_hz,
+        error);
+    crash_if(dbg, !(error < demod_max_fir_error));
+  }
+}
+
+// Tones in the passband come out at the expected audio frequency and level,
+// tones in the opposite sideband (or outside the CW filter) don't.
+void test_demod_tones(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  struct Case {
+    app::math::DemodMode mode;
+    int32_t offset_hz;
+    int32_t tone_hz;   // Relative to the offset
+    double audio_hz;   // Expected, or 0 if rejected
+  };
+  const Case cases[] = {
+      {app::math::DemodMode::USB, 6000, 1000, 1000},
+      {app::math::DemodMode::USB, 6000, -1000, 0},
+      {app::math::DemodMode::LSB, 6000, -1000, 1000},
+      {app::math::DemodMode::LSB, 6000, 1000, 0},
+      {app::math::DemodMode::CW, -3000, 0, app::math::demod_cw_pitch_hz},
+      {app::math::DemodMode::CW, -3000, 1500, 0},
+      {app::math::DemodMode::AM, 10000, 0, 1000},  // Modulated at 1 kHz
+      {app::math::DemodMode::AM, 10000, 8000, 0},
+  };
+
+  for (const Case &c : cases) {
+    // AM: a carrier with 50% modulation, i.e. sidebands at a quarter
+    const bool am = c.mode == app::math::DemodMode::AM && c.audio_hz;
+    for (unsigned int n = 0; n < demod_test_len; n++) {
+      const double t = (double)n / demod_sample_rate;
+      const double phase = 2 * M_PI * (c.offset_hz + c.tone_hz) * t;
+      const double envelope =
+          am ? 1 + 0.5 * cos(2 * M_PI * c.audio_hz * t) : 1;
+      input[n].real = demod_tone_amplitude * envelope * cos(phase);
+      input[n].imag = demod_tone_amplitude * envelope * sin(phase);
+    }
+
+    crash_if(
+        dbg, 0 != demod.Configure(c.mode, c.offset_hz, demod_sample_rate));
+    run(demod_test_blocks);
+
+    const float32_t *x = &output[demod_test_len - demod_measure_len];
+    const double expected = am ? 0.5 : 1;
+    const double level =
+        c.audio_hz ? tone_amplitude(x, demod_measure_len, c.audio_hz)
+                   : rms(x, demod_measure_len) * sqrt(2.0);
+    const double db = 20 * log10(level / demod_tone_amplitude / expected);
+    dbg.printf(
+        "  %-4s %+6ld Hz, tone %+5ld Hz: %8.2f dB%s\n",
+        app::math::demod_mode_name(c.mode),
+        (long)c.offset_hz,
+        (long)c.tone_hz,
+        db,
+        c.audio_hz ? "" : " (rejected)");
+    if (c.audio_hz) {
+      crash_if(dbg, !(fabs(db) < demod_max_gain_error_db));
+    } else {
+      crash_if(dbg, !(db < -demod_min_rejection_db));
+    }
+  }
+}
+
+void test_demod_speed(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+  dbg.printf("  (cycle counter: CPU cycles on target, ns on the host)\n");
+
+  crash_if(
+      dbg,
+      0 != demod.Configure(app::math::DemodMode::USB, 0, demod_sample_rate));
+  app::hw::PerfTimer perf_timer;
+  const uint32_t start = perf_timer.GetCycles();
+  for (unsigned int r = 0; r < demod_bench_repeats; r++) {
+    demod.Process(input, output);
+  }
+  const uint32_t ticks = perf_timer.GetCycles() - start;
+  dbg.printf(
+      "  Process: %lu per block of %u samples\n",
+      (unsigned long)(ticks / demod_bench_repeats),
+      app::math::demod_block_len);
+}
+
+void test_demod(app::debug::Debug &debug) {
+  test_demod_fir(debug);
+  test_demod_tones(debug);
+  test_demod_speed(debug);
+}
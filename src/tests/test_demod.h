@@ -0,0 +1,3 @@
+#pragma once
+
+void test_demod(app::debug::Debug &debug);
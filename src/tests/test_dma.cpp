@@ -47,9 +47,11 @@ void test_copy_dma(app::debug::Debug& dbg) {
     dst_test_area->data_area[i] = 0xAA + i % 2;
   }
 
-  // Zero it
-  app::hw::CopyDMA copy_dma;
-  crash_if(dbg, 0 != copy_dma.Init());
+  // Copy it
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(dbg, perf_timer);
+  crash_if(dbg, 0 != dma_manager.Init());
+  app::hw::CopyDMA copy_dma(dma_manager);
   crash_if(
       dbg,
       0 != copy_dma.CopyWordsUnsafe(
@@ -88,8 +90,10 @@ void test_zero_dma(app::debug::Debug& dbg) {
   }
 
   // Zero it
-  app::hw::ZeroDMA zero_dma;
-  crash_if(dbg, 0 != zero_dma.Init());
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(dbg, perf_timer);
+  crash_if(dbg, 0 != dma_manager.Init());
+  app::hw::ZeroDMA zero_dma(dma_manager);
   crash_if(
       dbg, 0 != zero_dma.ZeroWordsUnsafe(zero_area_addr, dma_test_area_words));
 
@@ -103,7 +107,137 @@ void test_zero_dma(app::debug::Debug& dbg) {
   }
 }
 
+// Completion of a queued transfer, checked against those before it
+struct dma_test_transfer {
+  app::hw::DmaTicket ticket;
+  volatile bool done;
+};
+
+static void dma_test_callback(void* context) {
+  ((struct dma_test_transfer*)context)->done = true;
+}
+
+void test_async_dma(app::debug::Debug& dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  struct dma_test_area* src_test_area =
+      (struct dma_test_area*)LCD_FB_START_ADDRESS;
+  struct dma_test_area* dst_test_area =
+      (struct dma_test_area*)(LCD_FB_START_ADDRESS + 0x400000);
+
+  uint32_t src_area_addr = (uint32_t)src_test_area->data_area;
+  uint32_t dst_area_addr = (uint32_t)dst_test_area->data_area;
+
+  // Initialize memory
+  for (uint32_t i = 0; i < dma_test_area_words; i++) {
+    src_test_area->data_area[i] = i;
+    dst_test_area->data_area[i] = 0xAA + i % 2;
+  }
+
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(dbg, perf_timer);
+  crash_if(dbg, 0 != dma_manager.Init());
+  app::hw::CopyDMA copy_dma(dma_manager);
+
+  // Fill all queues with copies of the whole area (in batches each), or
+  // parts of it, then one more that does not fit
+  const int num_transfers = app::hw::dma_num_streams * app::hw::dma_max_queued;
+  const uint32_t part_words = dma_test_area_words / 4;
+  struct dma_test_transfer transfers[num_transfers];
+  for (int i = 0; i < num_transfers; i++) {
+    const uint32_t num_words =
+        i < app::hw::dma_num_streams ? dma_test_area_words
+                                     : part_words * (1 + i % 4);
+    transfers[i].done = false;
+    transfers[i].ticket = copy_dma.CopyWordsAsync(
+        src_area_addr,
+        dst_area_addr,
+        num_words,
+        dma_test_callback,
+        &transfers[i]);
+    crash_if(dbg, transfers[i].ticket.number == 0);
+  }
+  crash_if(
+      dbg,
+      0 != copy_dma.CopyWordsAsync(src_area_addr, dst_area_addr, 4).number);
+
+  // The first ones took a while
+  crash_if(dbg, dma_manager.IsComplete(transfers[num_transfers - 1].ticket));
+
+  // Each completed after those queued before it on its stream
+  for (int i = 0; i < num_transfers; i++) {
+    dma_manager.Wait(transfers[i].ticket);
+    crash_if(dbg, !transfers[i].done);
+    for (int j = 0; j < i; j++) {
+      crash_if(
+          dbg,
+          transfers[j].ticket.stream == transfers[i].ticket.stream &&
+              !transfers[j].done);
+    }
+  }
+  dma_manager.WaitAll();
+  crash_if(dbg, dma_manager.GetErrors() != 0);
+
+  for (uint32_t i = 0; i < dma_test_area_words; i++) {
+    crash_if(dbg, dst_test_area->data_area[i] != i);
+  }
+}
+
+// A copy and a clear queued together run on separate streams
+void test_parallel_dma(app::debug::Debug& dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  struct dma_test_area* src_test_area =
+      (struct dma_test_area*)LCD_FB_START_ADDRESS;
+  struct dma_test_area* dst_test_area =
+      (struct dma_test_area*)(LCD_FB_START_ADDRESS + 0x400000);
+  struct dma_test_area* zero_test_area =
+      (struct dma_test_area*)(LCD_FB_START_ADDRESS + 0x200000);
+
+  uint32_t src_area_addr = (uint32_t)src_test_area->data_area;
+  uint32_t dst_area_addr = (uint32_t)dst_test_area->data_area;
+  uint32_t zero_area_addr = (uint32_t)zero_test_area->data_area;
+
+  // Initialize memory
+  for (uint32_t i = 0; i < dma_test_area_words; i++) {
+    src_test_area->data_area[i] = i;
+    dst_test_area->data_area[i] = 0xAA + i % 2;
+    zero_test_area->data_area[i] = i;
+  }
+
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(dbg, perf_timer);
+  crash_if(dbg, 0 != dma_manager.Init());
+  app::hw::DmaOptions copy_options = app::hw::dma_default_options;
+  copy_options.priority = app::hw::DmaPriority::High;
+  app::hw::CopyDMA copy_dma(dma_manager, copy_options);
+  app::hw::ZeroDMA zero_dma(dma_manager, app::hw::dma_default_options);
+
+  const app::hw::DmaTicket copy_ticket = copy_dma.CopyWordsAsync(
+      src_area_addr, dst_area_addr, dma_test_area_words);
+  const app::hw::DmaTicket zero_ticket =
+      zero_dma.ZeroWordsAsync(zero_area_addr, dma_test_area_words);
+  crash_if(dbg, copy_ticket.number == 0 || zero_ticket.number == 0);
+  crash_if(dbg, copy_ticket.stream == zero_ticket.stream);
+  dma_manager.Wait(copy_ticket);
+  dma_manager.Wait(zero_ticket);
+  crash_if(dbg, dma_manager.GetErrors() != 0);
+
+  for (uint32_t i = 0; i < dma_test_area_words; i++) {
+    crash_if(dbg, dst_test_area->data_area[i] != i);
+    crash_if(dbg, zero_test_area->data_area[i] != 0x00);
+  }
+  for (int i = 0; i < app::hw::dma_num_streams; i++) {
+    const app::hw::DmaStreamStats stats = dma_manager.GetStats(i);
+    crash_if(dbg, stats.transfers != 1);
+    crash_if(dbg, stats.words != dma_test_area_words);
+  }
+  dma_manager.Report();
+}
+
 void test_dma(app::debug::Debug& debug) {
   test_zero_dma(debug);
   test_copy_dma(debug);
+  test_async_dma(debug);
+  test_parallel_dma(debug);
 }
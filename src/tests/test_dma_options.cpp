@@ -0,0 +1,195 @@
+#include <stdint.h>
+
+#include <mbed.h>
+
+#include "debug/class.h"
+#include "debug/macros.h"
+#include "hw/dma.h"
+#include "hw/perf_timer.h"
+
+#include "test_dma_options.h"
+
+// A multiple of bursts, but smaller than a batch. On target in internal RAM,
+// unlike the frame buffers test_dma uses, so that these run on the host too.
+const uint32_t dma_options_test_words = 1024;
+
+alignas(16) static uint32_t src_words[dma_options_test_words + 4];
+alignas(16) static uint32_t dst_words[dma_options_test_words + 4];
+
+static const app::hw::DmaPriority dma_test_priorities[] = {
+    app::hw::DmaPriority::Low,
+    app::hw::DmaPriority::Medium,
+    app::hw::DmaPriority::High,
+    app::hw::DmaPriority::VeryHigh,
+};
+static const app::hw::DmaBurst dma_test_bursts[] = {
+    app::hw::DmaBurst::Single,
+    app::hw::DmaBurst::Incr4,
+};
+static const app::hw::DmaFifoThreshold dma_test_thresholds[] = {
+    app::hw::DmaFifoThreshold::Quarter,
+    app::hw::DmaFifoThreshold::Half,
+    app::hw::DmaFifoThreshold::ThreeQuarters,
+    app::hw::DmaFifoThreshold::Full,
+};
+
+// Streams as set up by DmaManager::Init()
+static DMA_Stream_TypeDef *const dma_test_streams[] = {
+    DMA2_Stream0,
+    DMA2_Stream1,
+};
+
+static void fill_words(uint32_t *words, uint32_t num_words, uint32_t seed) {
+  for (uint32_t i = 0; i < num_words; i++) {
+    words[i] = seed + i;
+  }
+}
+
+static bool check_words(
+    const uint32_t *words,
+    uint32_t num_words,
+    uint32_t seed,
+    bool fill) {
+  for (uint32_t i = 0; i < num_words; i++) {
+    if (words[i] != (fill ? seed : seed + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Stream registers as the options should have set them up
+static void check_stream(
+    app::debug::Debug &dbg,
+    app::hw::DmaTicket ticket,
+    const app::hw::DmaOptions &options) {
+  const bool incr4 = options.burst == app::hw::DmaBurst::Incr4;
+  const uint32_t cr_mask =
+      DMA_PRIORITY_VERY_HIGH | DMA_MBURST_INC16 | DMA_PBURST_INC16;
+  const uint32_t priorities[] = {
+      DMA_PRIORITY_LOW,
+      DMA_PRIORITY_MEDIUM,
+      DMA_PRIORITY_HIGH,
+      DMA_PRIORITY_VERY_HIGH,
+  };
+  const uint32_t thresholds[] = {
+      DMA_FIFO_THRESHOLD_1QUARTERFULL,
+      DMA_FIFO_THRESHOLD_HALFFULL,
+      DMA_FIFO_THRESHOLD_3QUARTERSFULL,
+      DMA_FIFO_THRESHOLD_FULL,
+  };
+  const uint32_t cr = priorities[(int)options.priority] |
+                      (incr4 ? DMA_MBURST_INC4 | DMA_PBURST_INC4
+                             : DMA_MBURST_SINGLE | DMA_PBURST_SINGLE);
+  DMA_Stream_TypeDef *stream = dma_test_streams[ticket.stream];
+  crash_if(dbg, (stream->CR & cr_mask) != cr);
+  crash_if(
+      dbg,
+      (stream->FCR & DMA_FIFO_THRESHOLD_FULL) !=
+          thresholds[(int)options.fifo_threshold]);
+}
+
+// Every combination of options, as a copy and as a fill: valid ones set the
+// stream up and transfer, invalid ones fail without touching the
+// destination, and the queue goes on either way.
+void test_dma_options_combinations(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(dbg, perf_timer);
+  crash_if(dbg, 0 != dma_manager.Init());
+
+  int num_valid = 0;
+  uint32_t seed = 0;
+  for (app::hw::DmaPriority priority : dma_test_priorities) {
+    for (app::hw::DmaBurst burst : dma_test_bursts) {
+      for (app::hw::DmaFifoThreshold threshold : dma_test_thresholds) {
+        const app::hw::DmaOptions options = {priority, burst, threshold};
+        const bool valid = app::hw::dma_options_valid(options);
+        num_valid += valid ? 1 : 0;
+
+        for (int fill = 0; fill < 2; fill++) {
+          seed += 0x10000;
+          fill_words(src_words, dma_options_test_words, seed);
+          fill_words(dst_words, dma_options_test_words + 4, 0xAA);
+
+          const uint32_t errors = dma_manager.GetErrors();
+          const app::hw::DmaTicket ticket = dma_manager.Submit(
+              (uintptr_t)src_words,
+              (uintptr_t)dst_words,
+              dma_options_test_words,
+              fill,
+              options,
+              nullptr,
+              nullptr);
+          crash_if(dbg, ticket.number == 0);
+          dma_manager.Wait(ticket);
+
+          crash_if(dbg, dma_manager.GetErrors() != errors + (valid ? 0 : 1));
+          if (valid) {
+            crash_if(
+                dbg,
+                !check_words(dst_words, dma_options_test_words, seed, fill));
+            check_stream(dbg, ticket, options);
+          } else {
+            crash_if(
+                dbg,
+                !check_words(dst_words, dma_options_test_words, 0xAA, false));
+          }
+          crash_if(
+              dbg,
+              dst_words[dma_options_test_words] !=
+                  0xAA + dma_options_test_words);
+        }
+      }
+    }
+  }
+
+  // Bursts only with a full FIFO
+  crash_if(dbg, num_valid != 4 * (4 + 1));
+}
+
+// Bursts need burst aligned addresses and lengths, single transfers don't
+void test_dma_options_alignment(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(dbg, perf_timer);
+  crash_if(dbg, 0 != dma_manager.Init());
+
+  app::hw::DmaOptions single = app::hw::dma_default_options;
+  app::hw::DmaOptions incr4 = app::hw::dma_default_options;
+  incr4.burst = app::hw::DmaBurst::Incr4;
+  app::hw::CopyDMA single_copy_dma(dma_manager, single);
+  app::hw::CopyDMA incr4_copy_dma(dma_manager, incr4);
+  app::hw::ZeroDMA incr4_zero_dma(dma_manager, incr4);
+
+  const uintptr_t src_addr = (uintptr_t)src_words;
+  const uintptr_t dst_addr = (uintptr_t)dst_words;
+  const uint32_t n = dma_options_test_words;
+  fill_words(src_words, n + 4, 1);
+
+  // Misaligned source, destination or length
+  crash_if(dbg, 0 == incr4_copy_dma.CopyWordsUnsafe(src_addr + 4, dst_addr, n));
+  crash_if(dbg, 0 == incr4_copy_dma.CopyWordsUnsafe(src_addr, dst_addr + 4, n));
+  crash_if(dbg, 0 == incr4_copy_dma.CopyWordsUnsafe(src_addr, dst_addr, n - 1));
+  crash_if(dbg, 0 == incr4_zero_dma.ZeroWordsUnsafe(dst_addr + 8, n));
+  crash_if(dbg, dma_manager.GetErrors() != 4);
+
+  crash_if(
+      dbg, 0 != single_copy_dma.CopyWordsUnsafe(src_addr + 4, dst_addr, n));
+  crash_if(dbg, !check_words(dst_words, n, 2, false));
+  crash_if(
+      dbg, 0 != single_copy_dma.CopyWordsUnsafe(src_addr, dst_addr + 4, n));
+  crash_if(dbg, !check_words(dst_words + 1, n, 1, false));
+  crash_if(dbg, 0 != incr4_copy_dma.CopyWordsUnsafe(src_addr, dst_addr, n));
+  crash_if(dbg, !check_words(dst_words, n, 1, false));
+  crash_if(dbg, 0 != incr4_zero_dma.ZeroWordsUnsafe(dst_addr + 16, n - 4));
+  crash_if(dbg, !check_words(dst_words + 4, n - 4, 0, true));
+  crash_if(dbg, dma_manager.GetErrors() != 4);
+}
+
+void test_dma_options(app::debug::Debug &debug) {
+  test_dma_options_combinations(debug);
+  test_dma_options_alignment(debug);
+}
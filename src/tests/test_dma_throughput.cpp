@@ -0,0 +1,198 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mbed.h>
+
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_lcd.h"
+#include "Drivers/BSP/STM32746G-Discovery/stm32746g_discovery_ts.h"
+
+#include "debug/class.h"
+#include "debug/counter.h"
+#include "debug/macros.h"
+#include "hw/display.h"
+#include "hw/dma.h"
+#include "hw/perf_timer.h"
+#include "hw/volatile_buffer.h"
+#include "hw/volatile_triple_buffer.h"
+
+#include "test_dma_throughput.h"
+
+// Frame buffers as in main.cpp, so that the display scans out as much as in
+// the application. The transfers use the SDRAM behind them.
+static const uint32_t fb_addr = LCD_FB_START_ADDRESS;
+static const uint32_t fb_size = sizeof(uint32_t) * 272 * 480;
+static const uint32_t dma_bench_src_addr = LCD_FB_START_ADDRESS + 0x400000;
+static const uint32_t dma_bench_dst_addr = LCD_FB_START_ADDRESS + 0x600000;
+
+// 1 MB per transfer, several batches each
+static const uint32_t dma_bench_words = 0x40000;
+static const unsigned int dma_bench_repeats = 8;
+
+// For the interrupt handlers
+static app::hw::Display *volatile bench_display = nullptr;
+
+static uint32_t mb_per_s(uint64_t bytes, uint32_t cycles) {
+  return cycles ? (uint32_t)(bytes * SystemCoreClock / cycles / 1000000) : 0;
+}
+
+// Copies (or fills) dma_bench_words dma_bench_repeats times with the
+// options, queued all at once like the application does.
+static void bench_options(
+    app::debug::Debug &debug,
+    app::hw::DmaManager &dma_manager,
+    app::debug::Counter &ltdc_underrun_counter,
+    const app::hw::DmaOptions &options,
+    bool fill) {
+  app::hw::PerfTimer perf_timer;
+  const uint32_t underruns = ltdc_underrun_counter.GetValue();
+  const uint32_t errors = dma_manager.GetErrors();
+  const uint32_t start = perf_timer.GetCycles();
+  for (unsigned int r = 0; r < dma_bench_repeats; r++) {
+    const app::hw::DmaTicket ticket = dma_manager.Submit(
+        dma_bench_src_addr,
+        dma_bench_dst_addr,
+        dma_bench_words,
+        fill,
+        options,
+        nullptr,
+        nullptr);
+    crash_if(debug, ticket.number == 0);
+  }
+  dma_manager.WaitAll();
+  const uint32_t cycles = perf_timer.GetCycles() - start;
+  crash_if(debug, dma_manager.GetErrors() != errors);
+
+  debug.printf(
+      "  %-4s %-9s %-6s %-4s: %4" PRIu32 " MB/s, %" PRIu32 " underruns\n",
+      fill ? "fill" : "copy",
+      app::hw::dma_priority_name(options.priority),
+      app::hw::dma_burst_name(options.burst),
+      app::hw::dma_fifo_threshold_name(options.fifo_threshold),
+      mb_per_s(
+          (uint64_t)dma_bench_repeats * dma_bench_words * sizeof(uint32_t),
+          cycles),
+      ltdc_underrun_counter.GetValue() - underruns);
+}
+
+// Every valid combination of options. Priority only matters against other
+// streams, so it is measured at its extremes.
+static void bench_all_options(
+    app::debug::Debug &debug,
+    app::hw::DmaManager &dma_manager,
+    app::debug::Counter &ltdc_underrun_counter) {
+  const app::hw::DmaPriority priorities[] = {
+      app::hw::DmaPriority::Low,
+      app::hw::DmaPriority::VeryHigh,
+  };
+  const app::hw::DmaBurst bursts[] = {
+      app::hw::DmaBurst::Single,
+      app::hw::DmaBurst::Incr4,
+  };
+  const app::hw::DmaFifoThreshold thresholds[] = {
+      app::hw::DmaFifoThreshold::Quarter,
+      app::hw::DmaFifoThreshold::Half,
+      app::hw::DmaFifoThreshold::ThreeQuarters,
+      app::hw::DmaFifoThreshold::Full,
+  };
+  for (int fill = 0; fill < 2; fill++) {
+    for (app::hw::DmaPriority priority : priorities) {
+      for (app::hw::DmaBurst burst : bursts) {
+        for (app::hw::DmaFifoThreshold threshold : thresholds) {
+          const app::hw::DmaOptions options = {priority, burst, threshold};
+          if (app::hw::dma_options_valid(options)) {
+            bench_options(
+                debug, dma_manager, ltdc_underrun_counter, options, fill);
+          }
+        }
+      }
+    }
+  }
+
+  // For comparison
+  app::hw::PerfTimer perf_timer;
+  const uint32_t underruns = ltdc_underrun_counter.GetValue();
+  const uint32_t start = perf_timer.GetCycles();
+  for (unsigned int r = 0; r < dma_bench_repeats; r++) {
+    memcpy(
+        (void *)dma_bench_dst_addr,
+        (const void *)dma_bench_src_addr,
+        dma_bench_words * sizeof(uint32_t));
+  }
+  const uint32_t cycles = perf_timer.GetCycles() - start;
+  debug.printf(
+      "  %-26s: %4" PRIu32 " MB/s, %" PRIu32 " underruns\n",
+      "cpu memcpy",
+      mb_per_s(
+          (uint64_t)dma_bench_repeats * dma_bench_words * sizeof(uint32_t),
+          cycles),
+      ltdc_underrun_counter.GetValue() - underruns);
+}
+
+// SDRAM to SDRAM throughput per burst, FIFO threshold and priority, first
+// with the display off, then with it scanning out both layers (the LTDC
+// competes for the SDRAM, and underruns if it loses too often).
+void test_dma_throughput(app::debug::Debug &debug) {
+  debug.printf("- %s\n", __func__);
+
+  app::debug::Counter ltdc_underrun_counter(debug, "ltdc_underrun");
+  app::hw::PerfTimer perf_timer;
+  app::hw::DmaManager dma_manager(debug, perf_timer);
+  crash_if(debug, 0 != dma_manager.Init());
+  app::hw::CopyDMA copy_dma(dma_manager);
+  app::hw::ZeroDMA zero_dma(dma_manager);
+
+  debug.printf("  display idle:\n");
+  bench_all_options(debug, dma_manager, ltdc_underrun_counter);
+
+  app::hw::VolatileBuffer<uint8_t> buf0(
+      debug, zero_dma, fb_addr + 0 * fb_size, fb_size);
+  app::hw::VolatileBuffer<uint8_t> buf1(
+      debug, zero_dma, fb_addr + 1 * fb_size, fb_size);
+  app::hw::VolatileBuffer<uint8_t> buf2(
+      debug, zero_dma, fb_addr + 2 * fb_size, fb_size);
+  app::hw::VolatileBuffer<uint32_t> buf3(
+      debug, zero_dma, fb_addr + 3 * fb_size, fb_size);
+  app::hw::VolatileBuffer<uint32_t> buf4(
+      debug, zero_dma, fb_addr + 4 * fb_size, fb_size);
+  app::hw::VolatileBuffer<uint32_t> buf5(
+      debug, zero_dma, fb_addr + 5 * fb_size, fb_size);
+  app::hw::VolatileTripleBuffer<uint8_t> layer0(debug, buf0, buf1, buf2);
+  app::hw::VolatileTripleBuffer<uint32_t> layer1(debug, buf3, buf4, buf5);
+  app::hw::Display display(
+      debug, layer0, layer1, copy_dma, ltdc_underrun_counter);
+  crash_if(debug, 0 != buf0.Init());
+  crash_if(debug, 0 != buf1.Init());
+  crash_if(debug, 0 != buf2.Init());
+  crash_if(debug, 0 != buf3.Init());
+  crash_if(debug, 0 != buf4.Init());
+  crash_if(debug, 0 != buf5.Init());
+  crash_if(debug, 0 != layer0.Init());
+  crash_if(debug, 0 != layer1.Init());
+  crash_if(debug, 0 != display.Init());
+  bench_display = &display;
+
+  // Touches are not handled here
+  HAL_NVIC_DisableIRQ(TS_INT_EXTI_IRQn);
+
+  debug.printf("  display scanning out:\n");
+  bench_all_options(debug, dma_manager, ltdc_underrun_counter);
+
+  HAL_NVIC_DisableIRQ(LTDC_IRQn);
+  bench_display = nullptr;
+}
+
+extern "C" void LTDC_IRQHandler(void) {
+  if (bench_display) {
+    bench_display->HandleLtdcIRQ();
+  }
+}
+
+void HAL_LTDC_ErrorCallback(LTDC_HandleTypeDef *hltdc) {
+  if (HAL_LTDC_GetError(hltdc) & HAL_LTDC_ERROR_FU) {
+    hltdc->ErrorCode &= ~HAL_LTDC_ERROR_FU;
+    if (bench_display) {
+      bench_display->HandleUnderrun();
+    }
+  }
+}
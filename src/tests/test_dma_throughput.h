@@ -0,0 +1,3 @@
+#pragma once
+
+void test_dma_throughput(app::debug::Debug &debug);
@@ -0,0 +1,78 @@
+#include <stdint.h>
+
+#include <mbed.h>
+
+#include "debug/class.h"
+#include "debug/histogram.h"
+#include "debug/macros.h"
+
+#include "test_histogram.h"
+
+using app::debug::Histogram;
+using app::debug::histogram_num_buckets;
+using app::debug::histogram_steps_per_octave;
+
+// Every 32 bit value is in the bucket whose bounds GetBucketMin() gives.
+// Buckets are in order, so the bucket only changes at the next bucket's
+// minimum, and the last one ends at 2^32. About 10 s on the host, minutes
+// on target, so it only runs in the native env (-H).
+void test_histogram_bounds(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  unsigned int bucket = 0;
+  crash_if(dbg, Histogram::GetBucketMin(0) != 0);
+  for (uint64_t value = 0; value <= UINT32_MAX; value++) {
+    const unsigned int i = Histogram::GetBucketIndex(value);
+    if (i != bucket) {
+      crash_if(dbg, i != bucket + 1);
+      crash_if(dbg, value != Histogram::GetBucketMin(i));
+      bucket = i;
+    }
+  }
+  crash_if(dbg, bucket != histogram_num_buckets - 1);
+  crash_if(
+      dbg, Histogram::GetBucketMin(histogram_num_buckets) != 1ULL << 32);
+}
+
+// Each bucket is within 1 / histogram_steps_per_octave of its minimum, so
+// that reported percentiles are too.
+void test_histogram_resolution(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  for (unsigned int i = histogram_steps_per_octave;
+       i < histogram_num_buckets;
+       i++) {
+    const uint64_t min = Histogram::GetBucketMin(i);
+    const uint64_t width = Histogram::GetBucketMin(i + 1) - min;
+    crash_if(dbg, width * histogram_steps_per_octave > min);
+  }
+}
+
+// Counts, totals and percentiles of values added.
+void test_histogram_add(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  Histogram histogram(dbg, "test");
+  for (uint32_t value = 1; value <= 100; value++) {
+    histogram.Add(value);
+  }
+  histogram.Add(UINT32_MAX);
+  crash_if(dbg, histogram.GetCount() != 101);
+  crash_if(dbg, histogram.GetMax() != UINT32_MAX);
+  crash_if(dbg, histogram.GetTotal() != 5050 + (uint64_t)UINT32_MAX);
+  crash_if(dbg, histogram.GetBucket(histogram_num_buckets - 1) != 1);
+
+  // Half of the values are up to 50, in the bucket [48, 56)
+  crash_if(dbg, histogram.GetPercentile(0.5f) != 56);
+  crash_if(dbg, histogram.GetPercentile(1.0f) != 1ULL << 32);
+
+  histogram.Reset();
+  crash_if(dbg, histogram.GetCount() != 0);
+  crash_if(dbg, histogram.GetPercentile(0.5f) != 0);
+}
+
+void test_histogram(app::debug::Debug &debug) {
+  test_histogram_bounds(debug);
+  test_histogram_resolution(debug);
+  test_histogram_add(debug);
+}
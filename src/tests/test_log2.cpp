@@ -0,0 +1,144 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mbed.h>
+
+#include <arm_math.h>
+
+#include "debug/class.h"
+#include "debug/macros.h"
+#include "hw/perf_timer.h"
+#include "math/math.h"
+
+#include "test_log2.h"
+
+// Accuracy sweep: every n-th bit pattern of the positive normal floats.
+// Odd, so that all mantissa bits vary.
+const uint32_t log2_sweep_stride = 4099;
+const unsigned int log2_block_len = 480;  // One spectrum
+const unsigned int log2_bench_repeats = 1000;
+
+// Max error per order, in log2 units, with some margin over the minimax fit
+// for float rounding.
+const double log2_max_error[app::math::fast_log2_max_order + 1] = {
+    0, 0.087, 0.0077, 0.0009, 0.00013, 0.00003};
+
+static void fast_log2_array(
+    unsigned int order,
+    const float32_t* src,
+    float32_t* dst,
+    unsigned int n) {
+  switch (order) {
+    case 1:
+      app::math::fast_log2_array<1>(src, dst, n, 0);
+      break;
+    case 2:
+      app::math::fast_log2_array<2>(src, dst, n, 0);
+      break;
+    case 3:
+      app::math::fast_log2_array<3>(src, dst, n, 0);
+      break;
+    case 4:
+      app::math::fast_log2_array<4>(src, dst, n, 0);
+      break;
+    case 5:
+      app::math::fast_log2_array<5>(src, dst, n, 0);
+      break;
+  }
+}
+
+static float32_t src[log2_block_len];
+static float32_t dst[log2_block_len];
+static double reference[log2_block_len];
+static volatile float32_t sink;
+
+void test_log2_accuracy(app::debug::Debug& dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  const unsigned int num_orders = app::math::fast_log2_max_order;
+  double max_error[num_orders + 1] = {0};
+  double sum_error[num_orders + 1] = {0};
+  uint32_t count = 0;
+
+  uint32_t bits = 0x00800000;  // Smallest normal
+  while (bits < 0x7F800000) {  // Infinity
+    unsigned int n = 0;
+    for (; n < log2_block_len && bits < 0x7F800000; n++) {
+      memcpy(&src[n], &bits, sizeof(float32_t));
+      reference[n] = log2((double)src[n]);
+      bits += log2_sweep_stride;
+    }
+
+    for (unsigned int order = 1; order <= num_orders; order++) {
+      fast_log2_array(order, src, dst, n);
+      for (unsigned int i = 0; i < n; i++) {
+        double error = fabs(dst[i] - reference[i]);
+        max_error[order] = error > max_error[order] ? error : max_error[order];
+        sum_error[order] += error;
+      }
+    }
+    count += n;
+  }
+
+  dbg.printf("  %lu samples\n", (unsigned long)count);
+  dbg.printf("  %-6s %12s %12s\n", "order", "max error", "mean error");
+  for (unsigned int order = 1; order <= num_orders; order++) {
+    dbg.printf(
+        "  %-6u %12.7f %12.7f\n",
+        order,
+        max_error[order],
+        sum_error[order] / count);
+    crash_if(dbg, max_error[order] > log2_max_error[order]);
+  }
+}
+
+// Times n elements per repeat, returns the counter ticks per element.
+template <typename F>
+static float32_t time_per_element(app::hw::PerfTimer& perf_timer, F f) {
+  uint32_t start = perf_timer.GetCycles();
+  for (unsigned int r = 0; r < log2_bench_repeats; r++) {
+    f();
+    sink = dst[r % log2_block_len];
+  }
+  uint32_t ticks = perf_timer.GetCycles() - start;
+  return (float32_t)ticks / (log2_bench_repeats * log2_block_len);
+}
+
+void test_log2_speed(app::debug::Debug& dbg) {
+  dbg.printf("- %s\n", __func__);
+  dbg.printf("  (cycle counter: CPU cycles on target, ns on the host)\n");
+
+  // Powers as seen in spectra
+  for (unsigned int i = 0; i < log2_block_len; i++) {
+    src[i] = ldexpf(1.0f + (i % 7) / 7.0f, 10 + i % 30);
+  }
+
+  app::hw::PerfTimer perf_timer;
+  for (unsigned int order = 1; order <= app::math::fast_log2_max_order;
+       order++) {
+    float32_t t = time_per_element(perf_timer, [&] {
+      fast_log2_array(order, src, dst, log2_block_len);
+    });
+    dbg.printf("  fast_log2_array order %u: %8.2f per element\n", order, t);
+  }
+
+  float32_t t = time_per_element(perf_timer, [&] {
+    for (unsigned int i = 0; i < log2_block_len; i++) {
+      dst[i] = app::math::fast_log2(src[i]);
+    }
+  });
+  dbg.printf("  fast_log2 (scalar):      %8.2f per element\n", t);
+
+  t = time_per_element(perf_timer, [&] {
+    for (unsigned int i = 0; i < log2_block_len; i++) {
+      dst[i] = log2f(src[i]);
+    }
+  });
+  dbg.printf("  log2f:                   %8.2f per element\n", t);
+}
+
+void test_log2(app::debug::Debug& debug) {
+  test_log2_accuracy(debug);
+  test_log2_speed(debug);
+}
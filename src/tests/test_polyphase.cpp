@@ -0,0 +1,293 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mbed.h>
+
+#include <arm_math.h>
+
+#include "debug/class.h"
+#include "debug/macros.h"
+#include "hw/perf_timer.h"
+#include "hw/recorder.h"
+#include "math/fft.h"
+#include "math/window.h"
+#include "structs/complex.h"
+
+#include "test_polyphase.h"
+
+const unsigned int polyphase_fft_len = 512;
+const unsigned int polyphase_taps = 4;
+const unsigned int polyphase_frame_len = polyphase_taps * polyphase_fft_len;
+
+// Tones are placed between bins in steps of 1 / polyphase_offsets, from the
+// centre of a bin to the middle between two
+const unsigned int polyphase_offsets = 8;
+const unsigned int polyphase_tone_bin = 100;
+const double polyphase_tone_amplitude = 8000;
+
+// Bins at least this far from the tone count as isolated from it
+const double polyphase_isolation_bins = 2;
+
+// Required of the filter bank: about as little scalloping as the window
+// alone, and leakage far below the window's
+const double polyphase_max_scallop_db = 1.0;
+const double polyphase_min_leakage_gain_db = 30;
+
+const unsigned int polyphase_bench_repeats = 1000;
+
+// Frames read from the recorder, as segments wrap around its ring this
+// many times
+const unsigned int polyphase_recorder_wraps = 3;
+
+// Difference of the recorder's frames from fold()'s, relative to the tone's
+// amplitude, for differences in float rounding (e.g. fused multiply-adds)
+const double polyphase_recorder_max_error = 1e-5;
+
+static float32_t window_table[polyphase_frame_len];
+static app::structs::Complex<float32_t> signal[polyphase_frame_len];
+static app::structs::Complex<float32_t> frame[polyphase_fft_len];
+static float32_t powers[polyphase_fft_len];
+
+// Windows (and folds) signal into frame, like Recorder::Read()
+static void fold(unsigned int taps) {
+  const unsigned int n = polyphase_fft_len;
+  for (unsigned int i = 0; i < n; i++) {
+    frame[i].real = signal[i].real * window_table[i];
+    frame[i].imag = signal[i].imag * window_table[i];
+  }
+  for (unsigned int t = 1; t < taps; t++) {
+    for (unsigned int i = 0; i < n; i++) {
+      frame[i].real += signal[t * n + i].real * window_table[t * n + i];
+      frame[i].imag += signal[t * n + i].imag * window_table[t * n + i];
+    }
+  }
+}
+
+static void transform(unsigned int taps) {
+  fold(taps);
+  arm_cfft_f32(
+      app::math::cfft_instance_f32(polyphase_fft_len),
+      (float32_t *)frame,
+      0,
+      1);
+  arm_cmplx_mag_squared_f32((float32_t *)frame, powers, polyphase_fft_len);
+}
+
+static double power_db(float32_t power) {
+  // A tone in the centre of a bin has power (amplitude * fft_len)^2
+  const double full = polyphase_tone_amplitude * polyphase_fft_len;
+  return 10 * log10(power / (full * full) + 1e-30);
+}
+
+// Response of the bins to tones swept across one bin: the loss between bin
+// centres (scalloping) and the leakage into bins further away.
+void test_polyphase_tones(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  const app::math::Window windows[] = {
+      app::math::Window::Hann,
+      app::math::Window::BlackmanHarris,
+  };
+  for (app::math::Window window : windows) {
+    double window_leakage_db = 0;
+    for (unsigned int taps = 1; taps <= polyphase_taps; taps += 3) {
+      if (taps > 1) {
+        app::math::make_polyphase_window(
+            window, window_table, polyphase_fft_len, taps);
+      } else {
+        app::math::make_window(window, window_table, polyphase_fft_len);
+      }
+
+      double min_peak_db = 0;
+      double max_leakage_db = -1000;
+      for (unsigned int o = 0; o <= polyphase_offsets / 2; o++) {
+        const double tone = polyphase_tone_bin + (double)o / polyphase_offsets;
+        for (unsigned int n = 0; n < taps * polyphase_fft_len; n++) {
+          const double phase = 2 * M_PI * tone * n / polyphase_fft_len;
+          signal[n].real = polyphase_tone_amplitude * cos(phase);
+          signal[n].imag = polyphase_tone_amplitude * sin(phase);
+        }
+        transform(taps);
+
+        double peak_db = -1000;
+        for (unsigned int k = 0; k < polyphase_fft_len; k++) {
+          const double db = power_db(powers[k]);
+          if (fabs(k - tone) < 1) {
+            peak_db = db > peak_db ? db : peak_db;
+          } else if (fabs(k - tone) >= polyphase_isolation_bins) {
+            max_leakage_db = db > max_leakage_db ? db : max_leakage_db;
+          }
+        }
+        min_peak_db = peak_db < min_peak_db ? peak_db : min_peak_db;
+      }
+
+      dbg.printf(
+          "  %-15s %u tap(s): scallop %6.2f dB, leakage %8.2f dB\n",
+          app::math::window_name(window),
+          taps,
+          -min_peak_db,
+          max_leakage_db);
+      if (taps > 1) {
+        crash_if(dbg, !(-min_peak_db < polyphase_max_scallop_db));
+        crash_if(
+            dbg,
+            !(max_leakage_db <
+              window_leakage_db - polyphase_min_leakage_gain_db));
+      } else {
+        window_leakage_db = max_leakage_db;
+      }
+    }
+  }
+}
+
+// Two tones three bins apart, one 100 dB weaker: the filter bank measures
+// the weaker one at its level, the window alone buries it in the stronger
+// one's skirt.
+void test_polyphase_isolation(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+
+  const double strong = polyphase_tone_bin + 0.5;
+  const double weak = strong + 3;
+  const double weak_db = -100;
+  const double weak_amplitude = pow(10, weak_db / 20);
+  for (unsigned int n = 0; n < polyphase_frame_len; n++) {
+    const double strong_phase = 2 * M_PI * strong * n / polyphase_fft_len;
+    const double weak_phase = 2 * M_PI * weak * n / polyphase_fft_len;
+    signal[n].real = polyphase_tone_amplitude *
+                     (cos(strong_phase) + weak_amplitude * cos(weak_phase));
+    signal[n].imag = polyphase_tone_amplitude *
+                     (sin(strong_phase) + weak_amplitude * sin(weak_phase));
+  }
+
+  for (unsigned int taps = 1; taps <= polyphase_taps; taps += 3) {
+    if (taps > 1) {
+      app::math::make_polyphase_window(
+          app::math::Window::BlackmanHarris,
+          window_table,
+          polyphase_fft_len,
+          taps);
+    } else {
+      app::math::make_window(
+          app::math::Window::BlackmanHarris, window_table, polyphase_fft_len);
+    }
+    transform(taps);
+
+    // The weak tone is between two bins, like the strong one
+    const unsigned int weak_bin = (unsigned int)weak;
+    const double weak_bin_db =
+        power_db(powers[weak_bin] > powers[weak_bin + 1]
+                     ? powers[weak_bin]
+                     : powers[weak_bin + 1]);
+    dbg.printf(
+        "  %u tap(s): weak tone at %8.2f dB, measured %8.2f dB\n",
+        taps,
+        weak_db,
+        weak_bin_db);
+    if (taps > 1) {
+      crash_if(dbg, !(fabs(weak_bin_db - weak_db) < polyphase_max_scallop_db));
+    }
+  }
+}
+
+// The extra cost is the folding, the FFT is the same
+void test_polyphase_speed(app::debug::Debug &dbg) {
+  dbg.printf("- %s\n", __func__);
+  dbg.printf("  (cycle counter: CPU cycles on target, ns on the host)\n");
+
+  app::hw::PerfTimer perf_timer;
+  for (unsigned int taps = 1; taps <= polyphase_taps; taps++) {
+    const uint32_t start = perf_timer.GetCycles();
+    for (unsigned int r = 0; r < polyphase_bench_repeats; r++) {
+      transform(taps);
+    }
+    const uint32_t ticks = perf_timer.GetCycles() - start;
+    dbg.printf(
+        "  %u tap(s): %lu per frame of %u\n",
+        taps,
+        (unsigned long)(ticks / polyphase_bench_repeats),
+        polyphase_fft_len);
+  }
+}
+
+// The recorder's frames, of a tone fed through the audio DMA, against
+// fold()'s of the same samples. With overlap, frames start within a tap,
+// so that the recorder's runs are split both where taps start and where
+// the ring wraps.
+void test_polyphase_recorder(
+    app::debug::Debug &dbg,
+    app::hw::Recorder &recorder,
+    void (*feed)(const uint16_t *data, uint32_t size)) {
+  dbg.printf("- %s\n", __func__);
+
+  const double tone = polyphase_tone_bin + 0.25;
+  app::math::make_polyphase_window(
+      app::math::Window::BlackmanHarris,
+      window_table,
+      polyphase_fft_len,
+      polyphase_taps);
+  for (unsigned int overlap = 1; overlap <= 8; overlap *= 2) {
+    crash_if(
+        dbg,
+        0 != recorder.Configure(
+                 polyphase_fft_len,
+                 overlap,
+                 app::hw::RecorderInput::IQ,
+                 polyphase_taps));
+    recorder.SetWindow(app::math::Window::BlackmanHarris);
+    const unsigned int hop = polyphase_fft_len / overlap;
+    const unsigned int num_hops =
+        polyphase_recorder_wraps * recorder.GetNumSegments();
+
+    // The samples fed so far, the newest polyphase_frame_len of them
+    static int16_t fed[2 * polyphase_frame_len];
+    unsigned int frames = 0;
+    double max_error = 0;
+    for (unsigned int h = 0; h < num_hops; h++) {
+      memmove(fed, &fed[2 * hop], sizeof(fed) - 2 * hop * sizeof(fed[0]));
+      int16_t *dst = &fed[2 * (polyphase_frame_len - hop)];
+      for (unsigned int i = 0; i < hop; i++) {
+        const double phase =
+            2 * M_PI * tone * (h * hop + i) / polyphase_fft_len;
+        dst[2 * i] = lrint(polyphase_tone_amplitude * cos(phase));
+        dst[2 * i + 1] = lrint(polyphase_tone_amplitude * sin(phase));
+      }
+      feed((const uint16_t *)dst, 2 * hop);
+
+      const app::structs::Complex<float32_t> *result = recorder.Read();
+      if (!result) {
+        // Until a whole frame was recorded
+        crash_if(dbg, (h + 1) * hop >= polyphase_frame_len);
+        continue;
+      }
+      for (unsigned int n = 0; n < polyphase_frame_len; n++) {
+        signal[n].real = fed[2 * n];
+        signal[n].imag = fed[2 * n + 1];
+      }
+      fold(polyphase_taps);
+      for (unsigned int i = 0; i < polyphase_fft_len; i++) {
+        const double error_real = fabs(result[i].real - frame[i].real);
+        const double error_imag = fabs(result[i].imag - frame[i].imag);
+        max_error = error_real > max_error ? error_real : max_error;
+        max_error = error_imag > max_error ? error_imag : max_error;
+      }
+      frames++;
+    }
+
+    max_error /= polyphase_tone_amplitude;
+    dbg.printf(
+        "  overlap %u: %u frames, ring of %d, max error %.2e\n",
+        overlap,
+        frames,
+        recorder.GetNumSegments(),
+        max_error);
+    crash_if(dbg, frames != num_hops - (polyphase_frame_len / hop - 1));
+    crash_if(dbg, !(max_error < polyphase_recorder_max_error));
+  }
+}
+
+void test_polyphase(app::debug::Debug &debug) {
+  test_polyphase_tones(debug);
+  test_polyphase_isolation(debug);
+  test_polyphase_speed(debug);
+}
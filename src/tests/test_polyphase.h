@@ -0,0 +1,10 @@
+#pragma once
+
+void test_polyphase(app::debug::Debug &debug);
+
+// Host only: feeds the recorder as the audio DMA would, with
+// BSP_AUDIO_IN_HostFeed(). Leaves it configured for polyphase frames.
+void test_polyphase_recorder(
+    app::debug::Debug &debug,
+    app::hw::Recorder &recorder,
+    void (*feed)(const uint16_t *data, uint32_t size));
@@ -6,7 +6,12 @@
 #include "debug/class.h"
 #include "debug/funcs.h"
 
+#include "test_demod.h"
 #include "test_dma.h"
+#include "test_dma_options.h"
+#include "test_dma_throughput.h"
+#include "test_log2.h"
+#include "test_polyphase.h"
 
 // Singleton called by interrupt handlers - stays null in tests
 app::Application* volatile global_app;
@@ -25,6 +30,11 @@ int main() {
   dbg.printf("\nBegin tests...\n");
 
   test_dma(dbg);
+  test_log2(dbg);
+  test_demod(dbg);
+  test_polyphase(dbg);
+  test_dma_options(dbg);
+  test_dma_throughput(dbg);
 
   dbg.printf("Tests complete.\n");
 }
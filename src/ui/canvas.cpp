@@ -21,6 +21,15 @@ void Canvas::SetBuffer(app::hw::VolatileBuffer<uint32_t> &new_buffer) {
   buffer_data = new_buffer.Data();
 }
 
+void Canvas::FillRect(const Rect &rect, uint32_t color) {
+  for (int y = rect.y0; y < rect.y1; y++) {
+    volatile uint32_t *row = &buffer_data[y * size_x];
+    for (int x = rect.x0; x < rect.x1; x++) {
+      row[x] = color;
+    }
+  }
+}
+
 void Canvas::DrawText(
     int x, int y, uint32_t fg, uint32_t bg, const char *text) {
   while (*text) {
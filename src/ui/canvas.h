@@ -2,6 +2,7 @@
 
 #include "hw/display.h"
 #include "hw/volatile_buffer.h"
+#include "ui/dirty_region.h"
 
 namespace app::ui {
 
@@ -18,6 +19,7 @@ class Canvas {
   void SetBuffer(app::hw::VolatileBuffer<uint32_t> &buffer);
 
   inline void DrawPixel(int x, int y, uint32_t color);
+  void FillRect(const Rect &rect, uint32_t color);
   void DrawText(int x, int y, uint32_t fg, uint32_t bg, const char *text);
   void DrawChar(int x0, int y0, uint32_t fg, uint32_t bg, const char c);
   inline unsigned int SizeX();
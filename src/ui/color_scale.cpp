@@ -0,0 +1,48 @@
+#include <math.h>
+#include <stdint.h>
+
+#include <arm_math.h>
+
+#include "math/math.h"
+
+#include "color_scale.h"
+
+namespace app::ui {
+
+ColorScale::ColorScale(float32_t min_log2, float32_t max_log2) {
+  const unsigned int steps = 1 << color_scale_mantissa_bits;
+  for (unsigned int j = 0; j < steps; j++) {
+    mantissa_log2[j] = log2f(1 + (j + 0.5f) / steps);
+  }
+  Set(min_log2, max_log2);
+}
+
+int ColorScale::Set(float32_t new_min_log2, float32_t new_max_log2) {
+  if (!(new_max_log2 > new_min_log2)) {
+    return 1;
+  }
+  min_log2 = new_min_log2;
+  max_log2 = new_max_log2;
+
+  // Same rounding as the log path it replaces: truncate, then clip
+  const float32_t scale = 256 / (max_log2 - min_log2);
+  const unsigned int steps = 1 << color_scale_mantissa_bits;
+  for (unsigned int e = 0; e < 256; e++) {
+    const float32_t exponent = (int32_t)e - 127;
+    for (unsigned int j = 0; j < steps; j++) {
+      float32_t color = (exponent + mantissa_log2[j] - min_log2) * scale;
+      table[e * steps + j] = app::math::limit<int32_t, 0, 255>(color);
+    }
+  }
+  return 0;
+}
+
+float32_t ColorScale::GetMin() {
+  return min_log2;
+}
+
+float32_t ColorScale::GetMax() {
+  return max_log2;
+}
+
+}  // namespace app::ui
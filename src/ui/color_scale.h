@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <arm_math.h>
+
+namespace app::ui {
+
+// Mantissa bits used as table index, i.e. 32 steps per octave (one step is
+// about 0.7 colors at the default scale of 22 colors per octave).
+static const unsigned int color_scale_mantissa_bits = 5;
+static const unsigned int color_scale_table_len =
+    256 << color_scale_mantissa_bits;
+
+// Maps linear power to a color index (0 to 255), with colors evenly spaced
+// in log2 power between min_log2 and max_log2, and clipped outside.
+//
+// The log is folded into a table indexed by the float's exponent and top
+// mantissa bits, so mapping is a shift, a mask and a load per value. The
+// table is rebuilt by Set(), which takes well below a millisecond.
+class ColorScale {
+ private:
+  float32_t min_log2 = 0;
+  float32_t max_log2 = 0;
+
+  // log2 of the centre of each mantissa step, in [0, 1)
+  float32_t mantissa_log2[1 << color_scale_mantissa_bits];
+
+  uint8_t table[color_scale_table_len];
+
+ public:
+  ColorScale(float32_t min_log2, float32_t max_log2);
+
+  int Set(float32_t min_log2, float32_t max_log2);
+  float32_t GetMin();
+  float32_t GetMax();
+
+  inline uint8_t Map(float32_t power);
+  inline void Map(const float32_t *powers, uint8_t *colors, unsigned int n);
+};
+
+// The sign is ignored, zero and denormals give 0, inf and NaN give 255.
+inline uint8_t ColorScale::Map(float32_t power) {
+  uint32_t bits;
+  memcpy(&bits, &power, sizeof(bits));
+  return table[(bits >> (23 - color_scale_mantissa_bits)) &
+               (color_scale_table_len - 1)];
+}
+
+inline void ColorScale::Map(
+    const float32_t *powers, uint8_t *colors, unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    colors[i] = Map(powers[i]);
+  }
+}
+
+}  // namespace app::ui
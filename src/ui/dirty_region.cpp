@@ -0,0 +1,37 @@
+#include "dirty_region.h"
+
+namespace app::ui {
+
+void DirtyRegion::Add(const Rect &rect) {
+  if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) {
+    return;
+  }
+  if (num_rects < dirty_region_max_rects) {
+    rects[num_rects++] = rect;
+    return;
+  }
+
+  Rect box = rect;
+  for (int i = 0; i < num_rects; i++) {
+    box.x0 = rects[i].x0 < box.x0 ? rects[i].x0 : box.x0;
+    box.y0 = rects[i].y0 < box.y0 ? rects[i].y0 : box.y0;
+    box.x1 = rects[i].x1 > box.x1 ? rects[i].x1 : box.x1;
+    box.y1 = rects[i].y1 > box.y1 ? rects[i].y1 : box.y1;
+  }
+  rects[0] = box;
+  num_rects = 1;
+}
+
+void DirtyRegion::Clear() {
+  num_rects = 0;
+}
+
+int DirtyRegion::Size() {
+  return num_rects;
+}
+
+const Rect &DirtyRegion::Get(int i) {
+  return rects[i];
+}
+
+}  // namespace app::ui
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace app::ui {
+
+// Rectangle of pixels, from x0, y0 up to (excluding) x1, y1.
+struct Rect {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+};
+
+static const int dirty_region_max_rects = 32;
+
+// Set of rectangles that need redrawing, e.g. in one of several frame
+// buffers. Overlapping rectangles are kept as they are (redrawing twice is
+// cheap compared to merging them). When full, the region collapses into the
+// bounding box of all rectangles.
+class DirtyRegion {
+ private:
+  Rect rects[dirty_region_max_rects];
+  int num_rects = 0;
+
+ public:
+  void Add(const Rect &rect);
+  void Clear();
+
+  int Size();
+  const Rect &Get(int i);
+};
+
+}  // namespace app::ui
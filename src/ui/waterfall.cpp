@@ -1,3 +1,5 @@
+#include <limits.h>
+
 #include "waterfall.h"
 
 namespace app::ui {
@@ -7,19 +9,52 @@ Waterfall::Waterfall(
     app::hw::CopyDMA &copy_dma,
     unsigned int size_x,
     unsigned int size_y)
-    : buffer(buffer), copy_dma(copy_dma), size_x(size_x), size_y(size_y) {
+    : size_x(size_x),
+      size_y(size_y),
+      num_lines(size_y + waterfall_spare_lines),
+      copy_dma(copy_dma),
+      buffer(buffer) {
 }
 
-int Waterfall::Render(app::hw::VolatileBuffer<uint8_t> &output) {
-  if (0 != CopyLines(output, 0, size_y - line, line)) {
+int Waterfall::Init() {
+  if (buffer.size < 2 * num_lines * size_x) {
     return 1;
   }
-  if (0 != CopyLines(output, line, 0, size_y - line)) {
+  return 0;
+}
+
+int Waterfall::Render(app::hw::VolatileBuffer<uint8_t> &output) {
+  return CopyLines(output, line, 0, size_y);
+}
+
+int Waterfall::WaitRendered() {
+  app::hw::DmaManager &manager = copy_dma.GetManager();
+  manager.Wait(render_ticket);
+  if (manager.GetErrors() != render_errors) {
+    render_errors = manager.GetErrors();
     return 1;
   }
   return 0;
 }
 
+volatile uint8_t *Waterfall::GetView() {
+  return &buffer.Data()[line * size_x];
+}
+
+unsigned int Waterfall::GetFreeLines(const volatile uint8_t *view) {
+  if (!view) {
+    return UINT_MAX;
+  }
+  const unsigned int view_line =
+      (unsigned int)((view - buffer.Data()) / size_x) % num_lines;
+  const unsigned int added = (view_line + num_lines - line) % num_lines;
+  return added < waterfall_spare_lines ? waterfall_spare_lines - added : 0;
+}
+
+const volatile uint8_t *Waterfall::GetRow(unsigned int age) {
+  return &buffer.Data()[(line + age) % num_lines * size_x];
+}
+
 int Waterfall::CopyLines(
     app::hw::VolatileBuffer<uint8_t> &output,
     int src_line,
@@ -27,24 +62,27 @@ int Waterfall::CopyLines(
     int num_lines) {
   if (num_lines <= 0) return 0;
 
-  uint32_t src_buf_addr = (uint32_t)buffer.Data();
-  uint32_t dst_buf_addr = (uint32_t)output.Data();
+  uintptr_t src_buf_addr = (uintptr_t)buffer.Data();
+  uintptr_t dst_buf_addr = (uintptr_t)output.Data();
   uint32_t src_offset = src_line * size_x;
   uint32_t dst_offset = dst_line * size_x;
-  uint32_t src_addr = src_buf_addr + src_offset;
-  uint32_t dst_addr = dst_buf_addr + dst_offset;
+  uintptr_t src_addr = src_buf_addr + src_offset;
+  uintptr_t dst_addr = dst_buf_addr + dst_offset;
   uint32_t num_words = num_lines * size_x / sizeof(uint32_t);
 
-  if (0 != copy_dma.CopyWordsUnsafe(src_addr, dst_addr, num_words)) {
+  const app::hw::DmaTicket ticket =
+      copy_dma.CopyWordsAsync(src_addr, dst_addr, num_words);
+  if (ticket.number == 0) {
     return 1;
   }
 
+  render_ticket = ticket;
   return 0;
 }
 
 void Waterfall::Shift() {
   if (line <= 0) {
-    line = size_y;
+    line = num_lines;
   }
   line--;
 }
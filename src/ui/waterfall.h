@@ -1,22 +1,43 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 
 #include "hw/dma.h"
 #include "hw/volatile_buffer.h"
 
 namespace app::ui {
 
+// Lines kept beyond the visible ones. Rows added while an older view is
+// still shown (until the display reloads at the next vertical blanking) go
+// there, instead of over the shown lines. A view can be shown for up to two
+// refreshes after it was taken, i.e. 50 rows at the fastest rate (1500 rows
+// per second at 60 Hz), plus a gap row. More than that, e.g. when catching
+// up, has to wait for a newer view to be shown (see GetFreeLines()).
+static const unsigned int waterfall_spare_lines = 64;
+
+// History of rows, newest at the top.
+//
+// The rows are kept in a ring of num_lines lines, which is stored twice in
+// a row (each line is written to both copies), so that the size_y lines
+// from any line on are contiguous. The view starting at the newest line can
+// then be copied in one go, or shown directly by pointing the display at it
+// (see GetView()), which scrolls by just changing the address.
 class Waterfall {
  private:
   unsigned int size_x;
   unsigned int size_y;
+  unsigned int num_lines;  // Ring, size_y + waterfall_spare_lines
 
-  unsigned int line = 0;
+  unsigned int line = 0;  // Newest row
 
   app::hw::CopyDMA &copy_dma;
   app::hw::VolatileBuffer<uint8_t> buffer;
 
+  // The last copy queued, and the DMA errors when last checked
+  app::hw::DmaTicket render_ticket = {0, 0};
+  uint32_t render_errors = 0;
+
   int CopyLines(app::hw::VolatileBuffer<uint8_t> &output,
                 int src_line,
                 int dst_line,
@@ -28,14 +49,51 @@ class Waterfall {
             unsigned int size_x,
             unsigned int size_y);
 
+  // Checks that the buffer holds both copies of the ring.
+  int Init();
+
   void Shift();
   inline void Set(unsigned int x, uint8_t color);
+  inline void SetLine(const uint8_t *colors);  // size_x colors
 
+  // Queues copying the view into a frame buffer of size_y lines. The copy
+  // runs in the background, see WaitRendered().
   int Render(app::hw::VolatileBuffer<uint8_t> &output);
+
+  // Waits until the copies queued by Render() completed. Returns 1 if any
+  // of them failed.
+  int WaitRendered();
+
+  // The view's first line within the buffer, followed by the other size_y -
+  // 1 lines, size_x apart. Stays valid (and unchanged) until
+  // waterfall_spare_lines more rows were added, see GetFreeLines().
+  volatile uint8_t *GetView();
+
+  // Rows that can be added before they overwrite lines of a view returned
+  // by GetView() earlier. Unlimited for nullptr, i.e. no view.
+  unsigned int GetFreeLines(const volatile uint8_t *view);
+
+  // Row added age rows before the newest one, from the ring itself rather
+  // than the view. For checking the view, e.g. as shown by the display.
+  const volatile uint8_t *GetRow(unsigned int age);
 };
 
 inline void Waterfall::Set(unsigned int i, uint8_t color) {
   buffer.Data()[line * size_x + i] = color;
+  buffer.Data()[(line + num_lines) * size_x + i] = color;
+}
+
+// Writes whole words, lines are word aligned (see CopyLines).
+inline void Waterfall::SetLine(const uint8_t *colors) {
+  volatile uint32_t *dst = (volatile uint32_t *)&buffer.Data()[line * size_x];
+  volatile uint32_t *mirror =
+      (volatile uint32_t *)&buffer.Data()[(line + num_lines) * size_x];
+  for (unsigned int i = 0; i < size_x / sizeof(uint32_t); i++) {
+    uint32_t word;
+    memcpy(&word, &colors[i * sizeof(uint32_t)], sizeof(word));
+    dst[i] = word;
+    mirror[i] = word;
+  }
 }
 
 }  // namespace app::ui